@@ -0,0 +1,98 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "LAsyncCanvas.h"
+#include "scene.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Throughput benchmark for LAsyncRenderer on a batch of independent thumbnails: one thread
+// records every thumbnail and flushes it, and the workers draw them. Compared against drawing
+// the batch in order on one thread, checking that the pixels match.
+//
+//   async_bench [thumbnails] [size] [density] [max threads]
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int count = argc > 1 ? atoi(argv[1]) : 256;
+  int size = argc > 2 ? atoi(argv[2]) : 192;
+  float density = argc > 3 ? atof(argv[3]) : 8;
+  int maxThreads = argc > 4 ? atoi(argv[4]) : std::max(4u, std::thread::hardware_concurrency());
+  const int reps = 3;
+
+  // Every thumbnail is a different scene, with shaders of its own.
+  std::vector<std::unique_ptr<Scene>> scenes;
+  std::vector<GBitmap> reference(count);
+  std::vector<GBitmap> thumbnails(count);
+  for (int i = 0; i < count; ++i)
+  {
+    scenes.emplace_back(new Scene(size, density, 16, i + 1));
+    reference[i].alloc(size, size);
+    thumbnails[i].alloc(size, size);
+  }
+
+  double best = 1e30;
+  for (int rep = 0; rep < reps; ++rep)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+      scenes[i]->draw(GCreateCanvas(reference[i]).get());
+    }
+    best = std::min(best, elapsedMs(start));
+  }
+  printf("%d thumbnails, size %d, density %g\n", count, size, density);
+  printf("in order          %8.2f ms  %8.1f thumbnails/s\n", best, count * 1000.0 / best);
+
+  bool allMatch = true;
+  double single = 0;
+  for (int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    LAsyncRenderer renderer(threads);
+    double asyncBest = 1e30;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+      std::vector<std::shared_future<void>> done;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < count; ++i)
+      {
+        LAsyncCanvas canvas(&renderer, thumbnails[i]);
+        scenes[i]->draw(&canvas);
+        done.push_back(canvas.flush());
+      }
+      for (auto &future : done)
+      {
+        future.wait();
+      }
+      asyncBest = std::min(asyncBest, elapsedMs(start));
+    }
+    if (threads == 1)
+    {
+      single = asyncBest;
+    }
+    bool match = true;
+    for (int i = 0; i < count; ++i)
+    {
+      match = match && 0 == memcmp(reference[i].pixels(), thumbnails[i].pixels(), size * reference[i].rowBytes());
+    }
+    allMatch = allMatch && match;
+    printf("async %2d threads  %8.2f ms  %8.1f thumbnails/s  speedup %5.2fx  %s\n", threads, asyncBest,
+           count * 1000.0 / asyncBest, single / asyncBest, match ? "match" : "MISMATCH");
+  }
+  for (int i = 0; i < count; ++i)
+  {
+    free(reference[i].pixels());
+    free(thumbnails[i].pixels());
+  }
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GPath.h"
+#include "LDamage.h"
+#include "LPicture.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Animated dashboard: a grid of panels where only a few gauges move each frame. Compares a
+// full repaint per frame against LIncrementalRenderer and checks the two stay identical.
+//
+//   damage_bench [size] [frames] [panels per side]
+
+static void drawDashboard(GCanvas *canvas, int size, int panels, int frame)
+{
+  canvas->clear({0.1f, 0.1f, 0.12f, 1});
+  float cell = (float)size / panels;
+  for (int j = 0; j < panels; ++j)
+  {
+    for (int i = 0; i < panels; ++i)
+    {
+      float x = i * cell;
+      float y = j * cell;
+      canvas->fillRect(GRect::MakeXYWH(x + 4, y + 4, cell - 8, cell - 8), {0.2f, 0.25f, 0.3f, 1});
+
+      // Only one gauge in seven animates.
+      int index = j * panels + i;
+      float t = index % 7 == 0 ? frame * 0.1f + index : index;
+      GPath needle;
+      GPoint c = {x + cell / 2, y + cell / 2};
+      float r = cell * 0.35f;
+      needle.moveTo(c.x() + r * cosf(t), c.y() + r * sinf(t));
+      needle.lineTo(c.x() + 3 * cosf(t + 1.57f), c.y() + 3 * sinf(t + 1.57f));
+      needle.lineTo(c.x() - 3 * cosf(t + 1.57f), c.y() - 3 * sinf(t + 1.57f));
+      canvas->drawPath(needle, GPaint({1, 0.6f, 0.1f, 0.9f}));
+    }
+  }
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int size = argc > 1 ? atoi(argv[1]) : 1024;
+  int frames = argc > 2 ? atoi(argv[2]) : 60;
+  int panels = argc > 3 ? atoi(argv[3]) : 12;
+
+  GBitmap full;
+  full.alloc(size, size);
+  GBitmap incremental;
+  incremental.alloc(size, size);
+  auto fullCanvas = GCreateCanvas(full);
+  LDamageCanvas damageCanvas(incremental);
+
+  double fullMs = 0;
+  double incrementalMs = 0;
+  long long damagedPixels = 0;
+  bool match = true;
+  for (int frame = 0; frame < frames; ++frame)
+  {
+    auto start = std::chrono::steady_clock::now();
+    drawDashboard(fullCanvas.get(), size, panels, frame);
+    fullMs += elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    drawDashboard(&damageCanvas, size, panels, frame);
+    const std::vector<GIRect> &damage = damageCanvas.flush();
+    incrementalMs += elapsedMs(start);
+
+    for (const GIRect &rect : damage)
+    {
+      damagedPixels += (long long)rect.width() * rect.height();
+    }
+    match = match && 0 == memcmp(full.pixels(), incremental.pixels(), size * full.rowBytes());
+  }
+
+  printf("size %d, frames %d, panels %d\n", size, frames, panels * panels);
+  printf("full repaint   %8.3f ms/frame\n", fullMs / frames);
+  printf("incremental    %8.3f ms/frame  %5.1f%% of pixels damaged  %s\n", incrementalMs / frames,
+         100.0 * damagedPixels / ((double)size * size * frames), match ? "match" : "MISMATCH");
+  return match ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "LEncode.h"
+#include "scene.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Throughput benchmark for the image encoders on a batch of rendered tiles, against the time
+// drawing them took, so it shows whether encoding would hold back a headless export.
+//
+//   encode_bench [tiles] [size] [density]
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int count = argc > 1 ? atoi(argv[1]) : 64;
+  int size = argc > 2 ? atoi(argv[2]) : 256;
+  float density = argc > 3 ? atof(argv[3]) : 8;
+  const int reps = 3;
+
+  std::vector<GBitmap> tiles(count);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i)
+  {
+    tiles[i].alloc(size, size);
+    Scene(size, density, 16, i + 1).draw(GCreateCanvas(tiles[i]).get());
+  }
+  double drawMs = elapsedMs(start);
+  const double megabytes = (double)count * size * size * sizeof(GPixel) / 1048576.0;
+  printf("%d tiles, size %d, density %g\n", count, size, density);
+  printf("draw        %8.2f ms  %8.1f tiles/s\n", drawMs, count * 1000.0 / drawMs);
+
+  struct Format
+  {
+    const char *name;
+    LImageFormat format;
+  };
+  const Format formats[] = {{"ppm", LImageFormat::kPPM}, {"pam", LImageFormat::kPAM}, {"qoi", LImageFormat::kQOI}, {"png-store", LImageFormat::kPNGStore}, {"png-fast", LImageFormat::kPNGFast}};
+  for (const Format &format : formats)
+  {
+    double best = 1e30;
+    size_t bytes = 0;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+      bytes = 0;
+      auto sink = [&bytes](const uint8_t *, size_t size)
+      { bytes += size; };
+      start = std::chrono::steady_clock::now();
+      for (const GBitmap &tile : tiles)
+      {
+        std::unique_ptr<LImageEncoder> encoder = LCreateImageEncoder(format.format, size, size, sink);
+        encoder->writeRows(tile);
+        encoder->finish();
+      }
+      best = std::min(best, elapsedMs(start));
+    }
+    printf("%-10s  %8.2f ms  %8.1f tiles/s  %7.1f MB/s  %5.1f%% of raw\n", format.name, best, count * 1000.0 / best,
+           megabytes * 1000.0 / best, 100.0 * bytes / (megabytes * 1048576.0));
+  }
+  for (GBitmap &tile : tiles)
+  {
+    free(tile.pixels());
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Hairline benchmark: short chart-style segments drawn with drawLines, as one drawPolyline,
+// and the way they had to be drawn before, as a one-pixel-wide quad per segment through
+// drawConvexPolygon (two long edges sorted into every row they cross).
+//
+//   hairline_bench [segments] [device size] [segment length]
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int count = argc > 1 ? atoi(argv[1]) : 1000000;
+  int size = argc > 2 ? atoi(argv[2]) : 1024;
+  float length = argc > 3 ? atof(argv[3]) : 8;
+  const int reps = 3;
+
+  // A random walk, so consecutive segments join up as a series would.
+  std::mt19937 random(11);
+  std::uniform_real_distribution<float> angle(0, 6.2831853f);
+  std::vector<GPoint> walk(count + 1);
+  walk[0] = {size * 0.5f, size * 0.5f};
+  for (int i = 1; i <= count; ++i)
+  {
+    float a = angle(random);
+    float x = walk[i - 1].x() + length * std::cos(a);
+    float y = walk[i - 1].y() + length * std::sin(a);
+    walk[i] = {x < 0 || x >= size ? walk[i - 1].x() - length * std::cos(a) : x,
+               y < 0 || y >= size ? walk[i - 1].y() - length * std::sin(a) : y};
+  }
+  std::vector<GPoint> pairs;
+  for (int i = 0; i < count; ++i)
+  {
+    pairs.push_back(walk[i]);
+    pairs.push_back(walk[i + 1]);
+  }
+
+  GBitmap device;
+  device.alloc(size, size);
+  const GPaint paint({0.1f, 0.3f, 0.8f, 0.6f});
+  auto time = [&](auto &&draw)
+  {
+    double best = 1e30;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+      auto canvas = GCreateCanvas(device);
+      canvas->clear({1, 1, 1, 1});
+      auto start = std::chrono::steady_clock::now();
+      draw(canvas.get());
+      best = std::min(best, elapsedMs(start));
+    }
+    return best;
+  };
+
+  double polygons = time([&](GCanvas *canvas)
+                         {
+    for (int i = 0; i < count; ++i)
+    {
+      GPoint a = walk[i];
+      GPoint b = walk[i + 1];
+      float dx = b.x() - a.x();
+      float dy = b.y() - a.y();
+      float scale = 0.5f / std::sqrt(dx * dx + dy * dy);
+      GPoint n = {-dy * scale, dx * scale};
+      GPoint quad[] = {a + n, b + n, b - n, a - n};
+      canvas->drawConvexPolygon(quad, 4, paint);
+    } });
+  double lines = time([&](GCanvas *canvas)
+                      { canvas->drawLines(pairs.data(), pairs.size(), paint); });
+  double polyline = time([&](GCanvas *canvas)
+                         { canvas->drawPolyline(walk.data(), walk.size(), paint); });
+
+  printf("%d segments of length %g, %d x %d device\n", count, length, size, size);
+  printf("polygons    %9.2f ms  %7.1f ns/segment\n", polygons, polygons * 1e6 / count);
+  printf("drawLines   %9.2f ms  %7.1f ns/segment  speedup %6.2fx\n", lines, lines * 1e6 / count, polygons / lines);
+  printf("drawPolyline%9.2f ms  %7.1f ns/segment  speedup %6.2fx\n", polyline, polyline * 1e6 / count, polygons / polyline);
+  free(device.pixels());
+  return 0;
+}
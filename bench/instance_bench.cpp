@@ -0,0 +1,105 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GPath.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Instanced path benchmark: a scatter-plot marker (a circle with a cross cut out of it) drawn
+// at many places, once as a save/concat/drawPath per marker and once as one drawPathInstances.
+// Markers on whole pixels share a handful of stamps; subpixel and rotated markers mostly do
+// not, so those runs show what flattening once and skipping the path copy alone are worth.
+// Instanced curves are flattened in the marker's own space, so a few edge pixels may round
+// differently from drawPath; the count is printed.
+//
+//   instance_bench [markers] [device size]
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int count = argc > 1 ? atoi(argv[1]) : 50000;
+  int size = argc > 2 ? atoi(argv[2]) : 1024;
+  const int reps = 5;
+
+  GPath marker;
+  marker.addCircle({0, 0}, 5);
+  marker.addRect(GRect::MakeLTRB(-1, -4, 1, 4), GPath::kCCW_Direction);
+  marker.addRect(GRect::MakeLTRB(-4, -1, 4, 1), GPath::kCCW_Direction);
+
+  GBitmap expected;
+  GBitmap actual;
+  expected.alloc(size, size);
+  actual.alloc(size, size);
+  printf("%d markers, %d x %d device\n", count, size, size);
+
+  struct Layout
+  {
+    const char *name;
+    bool subpixel;
+    bool rotated;
+  };
+  const Layout layouts[] = {{"whole pixels", false, false}, {"subpixel", true, false}, {"rotated", true, true}};
+  for (const Layout &layout : layouts)
+  {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> position(0, (float)size);
+    std::vector<GMatrix> matrices;
+    std::vector<GColor> colors;
+    for (int i = 0; i < count; ++i)
+    {
+      float x = position(random);
+      float y = position(random);
+      float scale = 1 + (i % 3) * 0.5f;
+      GMatrix m = GMatrix::Translate(layout.subpixel ? x : std::floor(x), layout.subpixel ? y : std::floor(y)) * GMatrix::Scale(scale, scale);
+      matrices.push_back(layout.rotated ? m * GMatrix::Rotate(x) : m);
+      colors.push_back({(i % 5) / 4.0f, (i % 7) / 6.0f, (i % 11) / 10.0f, 0.7f});
+    }
+
+    double paths = 1e30;
+    double instances = 1e30;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+      auto canvas = GCreateCanvas(expected);
+      canvas->clear({1, 1, 1, 1});
+      auto start = std::chrono::steady_clock::now();
+      GPaint paint;
+      for (int i = 0; i < count; ++i)
+      {
+        paint.setColor(colors[i]);
+        canvas->save();
+        canvas->concat(matrices[i]);
+        canvas->drawPath(marker, paint);
+        canvas->restore();
+      }
+      paths = std::min(paths, elapsedMs(start));
+
+      canvas = GCreateCanvas(actual);
+      canvas->clear({1, 1, 1, 1});
+      start = std::chrono::steady_clock::now();
+      canvas->drawPathInstances(marker, matrices.data(), colors.data(), count, GPaint());
+      instances = std::min(instances, elapsedMs(start));
+    }
+
+    long long differ = 0;
+    for (int y = 0; y < size; ++y)
+    {
+      for (int x = 0; x < size; ++x)
+      {
+        differ += *expected.getAddr(x, y) != *actual.getAddr(x, y);
+      }
+    }
+    printf("%-13s drawPath %8.2f ms  %6.1f ns/marker   instances %8.2f ms  %6.1f ns/marker  speedup %5.2fx  %lld px differ\n",
+           layout.name, paths, paths * 1e6 / count, instances, instances * 1e6 / count, paths / instances, differ);
+  }
+  free(expected.pixels());
+  free(actual.pixels());
+  return 0;
+}
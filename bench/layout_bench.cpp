@@ -0,0 +1,86 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GShader.h"
+#include "LTexture.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+// Texture layout benchmark: a texture larger than the cache filled across the device at 0, 45
+// and 90 degrees through each LTextureLayout. Row-major walks memory in order at 0 degrees and
+// strides a whole row per pixel at 90; the blocked and Morton layouts keep neighbours close at
+// every angle. Each layout's pixels are checked against row-major.
+//
+//   layout_bench [texture size] [device size]
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int size = argc > 1 ? atoi(argv[1]) : 2048;
+  int deviceSize = argc > 2 ? atoi(argv[2]) : 1024;
+  const int reps = 5;
+
+  GBitmap texture;
+  texture.alloc(size, size);
+  for (int y = 0; y < size; ++y)
+  {
+    for (int x = 0; x < size; ++x)
+    {
+      *texture.getAddr(x, y) = GPixel_PackARGB(255, x & 0xFF, y & 0xFF, (x * 3 ^ y * 5) & 0xFF);
+    }
+  }
+  GBitmap expected;
+  GBitmap actual;
+  expected.alloc(deviceSize, deviceSize);
+  actual.alloc(deviceSize, deviceSize);
+
+  struct Layout
+  {
+    const char *name;
+    LTextureLayout layout;
+  };
+  const Layout layouts[] = {{"row-major", LTextureLayout::kRowMajor}, {"blocked 4x4", LTextureLayout::kBlocked4x4}, {"blocked 8x8", LTextureLayout::kBlocked8x8}, {"morton", LTextureLayout::kMorton}};
+  printf("%d x %d texture, %d x %d device\n", size, size, deviceSize, deviceSize);
+  bool allMatch = true;
+  for (int degrees : {0, 45, 90})
+  {
+    // Rotated about the device center, sampling the texture at 1:1.
+    const float half = deviceSize * 0.5f;
+    GMatrix local = GMatrix::Translate(half, half) * GMatrix::Rotate(degrees * 3.14159265f / 180) * GMatrix::Translate(-half, -half);
+    double rowMajor = 0;
+    for (const Layout &layout : layouts)
+    {
+      std::unique_ptr<GShader> shader = LCreateBitmapShader(texture, local, GShader::kRepeat, layout.layout);
+      GPaint paint;
+      paint.setShader(shader.get());
+      GBitmap &device = layout.layout == LTextureLayout::kRowMajor ? expected : actual;
+      std::unique_ptr<GCanvas> canvas = GCreateCanvas(device);
+      double best = 1e30;
+      for (int rep = 0; rep < reps; ++rep)
+      {
+        auto start = std::chrono::steady_clock::now();
+        canvas->drawPaint(paint);
+        best = std::min(best, elapsedMs(start));
+      }
+      if (layout.layout == LTextureLayout::kRowMajor)
+      {
+        rowMajor = best;
+        printf("%3d deg  %-12s %8.2f ms\n", degrees, layout.name, best);
+        continue;
+      }
+      bool match = 0 == memcmp(expected.pixels(), actual.pixels(), deviceSize * expected.rowBytes());
+      allMatch = allMatch && match;
+      printf("%3d deg  %-12s %8.2f ms  speedup %5.2fx  %s\n", degrees, layout.name, best, rowMajor / best, match ? "match" : "MISMATCH");
+    }
+  }
+  free(texture.pixels());
+  free(expected.pixels());
+  free(actual.pixels());
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,341 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GMatrix.h"
+#include "GPath.h"
+#include "GShader.h"
+#include "LBitmapPool.h"
+#include "LCanvas.h"
+#include "LDot.h"
+#include "LPainter.h"
+#include "LStats.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks for the rasterizer's hot paths. Prints a JSON array with one object per
+// benchmark: ns per op, and the work done per op in its unit (pixels, rows or points) with the
+// resulting rate, so runs from different versions can be diffed.
+//
+//   micro_bench [filter]    only run benchmarks whose name contains filter
+
+static const int kSize = 1024;
+static const double kMinBatchMs = 20;
+static const int kRepeats = 5;
+
+static const char *filter = nullptr;
+static bool first = true;
+// Results are folded into this so the compiler cannot drop the work being timed.
+static volatile uint32_t sink;
+
+static double elapsedNs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Time op(), reporting the best of kRepeats batches, each long enough to swamp timer overhead.
+template <typename Op>
+static void bench(const std::string &name, const char *unit, double perOp, Op &&op)
+{
+  if (filter && name.find(filter) == std::string::npos)
+    return;
+
+  long long iterations = 1;
+  for (;;)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < iterations; ++i)
+      op();
+    if (elapsedNs(start) >= kMinBatchMs * 1e6)
+      break;
+    iterations *= 2;
+  }
+
+  double best = 1e300;
+  for (int r = 0; r < kRepeats; ++r)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < iterations; ++i)
+      op();
+    best = std::min(best, elapsedNs(start) / iterations);
+  }
+
+  printf("%s\n  {\"name\": \"%s\", \"ns_per_op\": %.1f, \"unit\": \"%s\", \"per_op\": %.0f, \"per_s\": %.4g}",
+         first ? "" : ",", name.c_str(), best, unit, perOp, perOp * 1e9 / best);
+  first = false;
+  fflush(stdout);
+}
+
+static GPath makeCircle()
+{
+  GPath path;
+  path.addCircle({kSize / 2.0f, kSize / 2.0f}, kSize * 0.45f);
+  return path;
+}
+
+static GPath makeStar(int points)
+{
+  GPath path;
+  for (int i = 0; i < points; ++i)
+  {
+    float t = i * 2 * 3.14159265f * (points / 2) / points;
+    GPoint p = {kSize / 2.0f + kSize * 0.45f * cosf(t), kSize / 2.0f + kSize * 0.45f * sinf(t)};
+    i == 0 ? path.moveTo(p) : path.lineTo(p);
+  }
+  return path;
+}
+
+static void clearRows(std::vector<std::vector<LDot>> &dots)
+{
+  for (std::vector<LDot> &row : dots)
+    row.clear();
+}
+
+static void benchScanConversion()
+{
+  GIRect bounds = GIRect::MakeWH(kSize, kSize);
+  std::vector<std::vector<LDot>> dots(kSize);
+
+  bench("LEdgeToDots/steep", "rows", kSize, [&]
+        {
+          clearRows(dots);
+          LEdgeToDots(dots, {10, 0}, {kSize - 10.0f, (float)kSize}, bounds);
+          sink = sink + dots[kSize / 2][0].x; });
+
+  GPath circle = makeCircle();
+  GPath star = makeStar(31);
+  bench("LPathToDots/circle", "rows", circle.bounds().height(), [&]
+        {
+          clearRows(dots);
+          LPathToDots(dots, circle, bounds);
+          sink = sink + dots[kSize / 2].size(); });
+  bench("LPathToDots/star31", "rows", star.bounds().height(), [&]
+        {
+          clearRows(dots);
+          LPathToDots(dots, star, bounds);
+          sink = sink + dots[kSize / 2].size(); });
+
+  // The per-row sort and winding walk paintBuffer does after scan conversion.
+  clearRows(dots);
+  LPathToDots(dots, star, bounds);
+  std::vector<std::vector<LDot>> unsorted = dots;
+  long long starPixels = 0;
+  for (std::vector<LDot> &row : dots)
+  {
+    LSortRow(row.data(), row.size());
+    LWalkRow(row.data(), row.size(), [&](int x0, int x1)
+             { starPixels += x1 - x0; });
+  }
+  bench("paintBuffer/sort+walk/star31", "pixels", starPixels, [&]
+        {
+          uint32_t covered = 0;
+          for (int y = 0; y < kSize; ++y)
+          {
+            dots[y] = unsorted[y];
+            LSortRow(dots[y].data(), dots[y].size());
+            LWalkRow(dots[y].data(), dots[y].size(), [&](int x0, int x1)
+                     { covered += x1 - x0; });
+          }
+          sink = sink + covered; });
+}
+
+static void benchBlendModes()
+{
+  std::vector<GPixel> src(kSize);
+  std::vector<GPixel> dst(kSize);
+  std::vector<GPixel> start(kSize);
+  for (int i = 0; i < kSize; ++i)
+  {
+    unsigned a = i & 0xFF;
+    src[i] = GPixel_PackARGB(a, a / 2, a / 3, a / 4);
+    start[i] = GPixel_PackARGB(255 - a / 2, 100, (i * 7) & 0x7F, 20);
+  }
+  for (int mode = 0; mode < 12; ++mode)
+  {
+    RowPainter painter = modeToRowPainter((GBlendMode)mode);
+    bench(std::string("paintRow/") + LBlendModeName(mode), "pixels", kSize, [&]
+          {
+            memcpy(dst.data(), start.data(), kSize * sizeof(GPixel));
+            painter(src.data(), dst.data(), kSize);
+            sink = sink + dst[kSize - 1]; });
+  }
+}
+
+static void benchShaders()
+{
+  GBitmap texture;
+  texture.alloc(256, 256);
+  for (int y = 0; y < 256; ++y)
+    for (int x = 0; x < 256; ++x)
+      *texture.getAddr(x, y) = GPixel_PackARGB(255, x, y, (x ^ y) & 0xFF);
+  texture.setIsOpaque(GBitmap::kYes_IsOpaque);
+
+  std::vector<GPixel> row(kSize);
+  GMatrix rotate = GMatrix::Rotate(0.3f);
+  struct Case
+  {
+    const char *name;
+    std::unique_ptr<GShader> shader;
+    GMatrix ctm;
+  };
+  GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 0.5f}};
+  Case cases[] = {
+      {"LShader/clamp", GCreateBitmapShader(texture, GMatrix::Scale(3, 3)), GMatrix()},
+      {"LShader/repeat/rotated", GCreateBitmapShader(texture, GMatrix(), GShader::kRepeat), rotate},
+      {"LGradient/2", GCreateLinearGradient({0, 0}, {kSize, kSize / 2.0f}, colors[0], colors[1]), GMatrix()},
+      {"LGradient/3/mirror", GCreateLinearGradient({100, 0}, {300, 0}, colors, 3, GShader::kMirror), rotate},
+  };
+  for (Case &c : cases)
+  {
+    LShaderContext context(c.shader.get(), c.ctm);
+    int y = 0;
+    bench(std::string(c.name) + "/shadeRow", "pixels", kSize, [&]
+          {
+            context.get()->shadeRow(0, y, kSize, row.data());
+            y = (y + 1) & (kSize - 1);
+            sink = sink + row[kSize / 2]; });
+  }
+}
+
+static void benchMatrix()
+{
+  const int count = 4096;
+  std::vector<GPoint> src(count);
+  std::vector<GPoint> dst(count);
+  for (int i = 0; i < count; ++i)
+    src[i] = {(float)(i % 97), (float)(i / 97)};
+  GMatrix affine = GMatrix::Concat(GMatrix::Translate(10, 20), GMatrix::Rotate(0.7f));
+  bench("GMatrix/mapPoints", "points", count, [&]
+        {
+          affine.mapPoints(dst.data(), src.data(), count);
+          sink = sink + (uint32_t)dst[count - 1].x(); });
+}
+
+// An offscreen that lives for one draw, as layers and tiles do.
+static void benchOffscreens()
+{
+  const int size = 256;
+  bench("GBitmap/alloc+free/256", "pixels", size * size, [&]
+        {
+          GBitmap bitmap;
+          bitmap.alloc(size, size);
+          *bitmap.getAddr(size / 2, size / 2) = sink;
+          sink = sink + *bitmap.getAddr(0, size - 1);
+          free(bitmap.pixels()); });
+  LBitmapPool pool;
+  bench("LBitmapPool/zeroed/256", "pixels", size * size, [&]
+        {
+          LPooledBitmap bitmap = pool.acquire(size, size);
+          *bitmap.bitmap().getAddr(size / 2, size / 2) = sink;
+          sink = sink + *bitmap.bitmap().getAddr(0, size - 1); });
+  bench("LBitmapPool/uninitialized/256", "pixels", size * size, [&]
+        {
+          LPooledBitmap bitmap = pool.acquire(size, size, LBitmapPool::kUninitialized);
+          *bitmap.bitmap().getAddr(size / 2, size / 2) = sink;
+          sink = sink + *bitmap.bitmap().getAddr(0, size - 1); });
+}
+
+static void benchCanvas()
+{
+  GBitmap device;
+  device.alloc(kSize, kSize);
+  std::unique_ptr<LCanvas> canvas = LCreateCanvas(device);
+  GBitmap texture;
+  texture.alloc(64, 64);
+  for (int y = 0; y < 64; ++y)
+    for (int x = 0; x < 64; ++x)
+      *texture.getAddr(x, y) = GPixel_PackARGB(255, x * 4, y * 4, 128);
+  texture.setIsOpaque(GBitmap::kYes_IsOpaque);
+  std::unique_ptr<GShader> textureShader = GCreateBitmapShader(texture, GMatrix());
+
+  // A 32x32 grid of triangles covering the device.
+  const int grid = 32;
+  std::vector<GPoint> verts;
+  std::vector<GColor> colors;
+  std::vector<GPoint> texs;
+  std::vector<int> indices;
+  for (int j = 0; j <= grid; ++j)
+  {
+    for (int i = 0; i <= grid; ++i)
+    {
+      verts.push_back({(float)i * kSize / grid, (float)j * kSize / grid});
+      colors.push_back({1, i / (float)grid, j / (float)grid, 0.5f});
+      texs.push_back({(float)(i % 2) * 64, (float)(j % 2) * 64});
+    }
+  }
+  for (int j = 0; j < grid; ++j)
+  {
+    for (int i = 0; i < grid; ++i)
+    {
+      int v = j * (grid + 1) + i;
+      indices.insert(indices.end(), {v, v + 1, v + grid + 1, v + 1, v + grid + 2, v + grid + 1});
+    }
+  }
+  int triangles = grid * grid * 2;
+  double pixels = (double)kSize * kSize;
+
+  GPaint plain;
+  GPaint textured(textureShader.get());
+  bench("drawMesh/colors", "pixels", pixels, [&]
+        { canvas->drawMesh(verts.data(), colors.data(), nullptr, triangles, indices.data(), plain); });
+  bench("drawMesh/texs", "pixels", pixels, [&]
+        { canvas->drawMesh(verts.data(), nullptr, texs.data(), triangles, indices.data(), textured); });
+  bench("drawMesh/colors+texs", "pixels", pixels, [&]
+        { canvas->drawMesh(verts.data(), colors.data(), texs.data(), triangles, indices.data(), textured); });
+
+  GPoint quad[4] = {{0, 0}, {kSize, 0}, {kSize, kSize}, {0, kSize}};
+  GColor quadColors[4] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}, {1, 1, 1, 1}};
+  GPoint quadTexs[4] = {{0, 0}, {64, 0}, {64, 64}, {0, 64}};
+  for (int level : {0, 8})
+  {
+    bench("drawQuad/colors/level" + std::to_string(level), "pixels", pixels, [&]
+          { canvas->drawQuad(quad, quadColors, nullptr, level, plain); });
+    bench("drawQuad/texs/level" + std::to_string(level), "pixels", pixels, [&]
+          { canvas->drawQuad(quad, nullptr, quadTexs, level, textured); });
+  }
+  sink = sink + *device.getAddr(kSize / 2, kSize / 2);
+}
+
+// Blending onto pixels the canvas knows are clear or opaque, with and without it tracking that.
+static void benchOpacity()
+{
+  GBitmap device;
+  device.alloc(kSize, kSize);
+  std::unique_ptr<LCanvas> canvas = LCreateCanvas(device);
+  GPaint translucent({0.2f, 0.5f, 0.9f, 0.6f});
+  GPaint under({0.9f, 0.5f, 0.2f, 0.6f});
+  under.setBlendMode(GBlendMode::kDstOver);
+  double pixels = (double)kSize * kSize;
+  for (bool tracked : {true, false})
+  {
+    canvas->setOpacityTracking(tracked);
+    const std::string suffix = tracked ? "/tracked" : "/untracked";
+    bench("opacity/srcOver-onto-clear" + suffix, "pixels", pixels, [&]
+          {
+            canvas->clear({0, 0, 0, 0});
+            canvas->drawPaint(translucent); });
+    bench("opacity/dstOver-onto-opaque" + suffix, "pixels", pixels, [&]
+          {
+            canvas->clear({1, 1, 1, 1});
+            canvas->drawPaint(under); });
+  }
+  sink = sink + *device.getAddr(kSize / 2, kSize / 2);
+}
+
+int main(int argc, char **argv)
+{
+  filter = argc > 1 ? argv[1] : nullptr;
+  printf("[");
+  benchScanConversion();
+  benchBlendModes();
+  benchShaders();
+  benchMatrix();
+  benchOffscreens();
+  benchCanvas();
+  benchOpacity();
+  printf("\n]\n");
+  return 0;
+}
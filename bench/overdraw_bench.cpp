@@ -0,0 +1,94 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GPath.h"
+#include "GShader.h"
+#include "LCanvas.h"
+#include "LCoverage.h"
+#include "LPicture.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Deeply layered scene: stacks of opaque gradient circles and rects with a few translucent
+// overlays. Compares in-order playback against LDrawFrontToBack, which shades each opaque
+// pixel once, and checks the two produce identical pixels.
+//
+//   overdraw_bench [size] [layers] [iterations]
+
+static void drawLayers(GCanvas *canvas, int size, int layers, std::vector<std::unique_ptr<GShader>> &shaders)
+{
+  canvas->clear({1, 1, 1, 1});
+  srand(7);
+  for (int i = 0; i < layers; ++i)
+  {
+    float x = rand() % size;
+    float y = rand() % size;
+    float r = size * (0.1f + (rand() % 100) / 400.0f);
+    GColor c0 = {(rand() % 100) / 100.0f, (rand() % 100) / 100.0f, 0.5f, 1};
+    GColor c1 = {0.2f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f, 1};
+    shaders.push_back(GCreateLinearGradient({x - r, y - r}, {x + r, y + r}, c0, c1));
+    GPaint paint(shaders.back().get());
+    if (i % 3 == 0)
+    {
+      canvas->drawRect(GRect::MakeXYWH(x - r, y - r * 0.5f, 2 * r, r), paint);
+    }
+    else
+    {
+      GPath circle;
+      circle.addCircle({x, y}, r);
+      canvas->drawPath(circle, paint);
+    }
+    if (i % 16 == 15)
+    {
+      canvas->fillRect(GRect::MakeXYWH(x - r, y - r, r, r), {0, 0, 0, 0.3f});
+    }
+  }
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int size = argc > 1 ? atoi(argv[1]) : 1024;
+  int layers = argc > 2 ? atoi(argv[2]) : 200;
+  int iterations = argc > 3 ? atoi(argv[3]) : 10;
+
+  std::vector<std::unique_ptr<GShader>> shaders;
+  LPicture picture;
+  LRecorder recorder(&picture);
+  drawLayers(&recorder, size, layers, shaders);
+
+  GBitmap inOrder;
+  inOrder.alloc(size, size);
+  GBitmap frontToBack;
+  frontToBack.alloc(size, size);
+  auto inOrderCanvas = LCreateCanvas(inOrder);
+  auto frontToBackCanvas = LCreateCanvas(frontToBack);
+  LCoverage coverage;
+
+  double inOrderMs = 0;
+  double frontToBackMs = 0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    auto start = std::chrono::steady_clock::now();
+    picture.playback(inOrderCanvas.get());
+    inOrderMs += elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    LDrawFrontToBack(picture, frontToBackCanvas.get(), &coverage, size);
+    frontToBackMs += elapsedMs(start);
+  }
+  bool match = 0 == memcmp(inOrder.pixels(), frontToBack.pixels(), size * inOrder.rowBytes());
+
+  printf("size %d, layers %d, ops %zu\n", size, layers, picture.ops.size());
+  printf("in order       %8.3f ms\n", inOrderMs / iterations);
+  printf("front to back  %8.3f ms  %s\n", frontToBackMs / iterations, match ? "match" : "MISMATCH");
+  return match ? 0 : 1;
+}
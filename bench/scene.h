@@ -0,0 +1,121 @@
+#ifndef SCENEDEF
+#define SCENEDEF
+
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GPath.h"
+#include "GShader.h"
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/**
+ *  Deterministic scene for benchmarks and tests: N-edge star paths, gradient-filled rotated
+ *  rects, bitmap-shaded rects, meshes and quads, spread over the canvas. density is the number
+ *  of objects per 256x256 cell and object sizes are fixed in device pixels, so the work per
+ *  pixel stays the same as the canvas grows. The same seed always draws the same frame.
+ */
+class Scene
+{
+public:
+  Scene(int size, float density, int pathEdges, unsigned seed = 1)
+      : size(size), pathEdges(pathEdges), seed(seed)
+  {
+    objects = std::max(1, (int)(density * size * size / (256.0f * 256.0f)));
+
+    texture.alloc(64, 64);
+    for (int y = 0; y < 64; ++y)
+      for (int x = 0; x < 64; ++x)
+        *texture.getAddr(x, y) = ((x / 8 + y / 8) & 1) ? GPixel_PackARGB(255, 240, 200, 40) : GPixel_PackARGB(255, 30, 60, 160);
+    texture.setIsOpaque(GBitmap::kYes_IsOpaque);
+    bitmapShader = GCreateBitmapShader(texture, GMatrix::Scale(0.5f, 0.5f), GShader::kRepeat);
+    GColor stops[] = {{1, 0.2f, 0.2f, 1}, {0.2f, 1, 0.2f, 1}, {0.2f, 0.2f, 1, 0.6f}};
+    gradient = GCreateLinearGradient({-40, 0}, {40, 0}, stops, 3, GShader::kMirror);
+  }
+
+  ~Scene() { free(texture.pixels()); }
+
+  int objectCount() const { return objects; }
+
+  void draw(GCanvas *canvas) const
+  {
+    unsigned s = seed;
+    canvas->clear({0.95f, 0.95f, 0.95f, 1});
+    for (int i = 0; i < objects; ++i)
+    {
+      float x = rnd(s, -16, size);
+      float y = rnd(s, -16, size);
+      float r = rnd(s, 8, 48);
+      GPaint paint({rnd(s, 0, 1), rnd(s, 0, 1), rnd(s, 0, 1), rnd(s, 0.3f, 1)});
+      switch (i % 5)
+      {
+      case 0:
+        canvas->drawPath(star(x, y, r, rnd(s, 0, 6.28f)), paint);
+        break;
+      case 1:
+        canvas->save();
+        canvas->translate(x, y);
+        canvas->rotate(rnd(s, 0, 3.14f));
+        paint.setShader(gradient.get());
+        canvas->drawRect(GRect::MakeXYWH(-r, -r / 2, 2 * r, r), paint);
+        canvas->restore();
+        break;
+      case 2:
+        paint.setShader(bitmapShader.get());
+        canvas->drawRect(GRect::MakeXYWH(x, y, 2 * r, r), paint);
+        break;
+      case 3:
+      {
+        GPoint verts[] = {{x, y}, {x + r, y}, {x + r / 2, y + r}, {x + 1.5f * r, y + r}};
+        GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 0.5f}, {1, 1, 0, 1}};
+        GPoint texs[] = {{0, 0}, {64, 0}, {0, 64}, {64, 64}};
+        int indices[] = {0, 1, 2, 1, 3, 2};
+        paint.setShader(i % 2 ? bitmapShader.get() : nullptr);
+        canvas->drawMesh(verts, colors, texs, 2, indices, paint);
+        break;
+      }
+      default:
+      {
+        GPoint verts[] = {{x, y}, {x + r, y + r * 0.25f}, {x + r * 0.75f, y + r}, {x - r * 0.25f, y + r * 0.75f}};
+        GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {1, 1, 0, 1}, {1, 0, 1, 0.5f}};
+        GPoint texs[] = {{0, 0}, {64, 0}, {64, 64}, {0, 64}};
+        paint.setShader(i % 2 ? bitmapShader.get() : nullptr);
+        canvas->drawQuad(verts, i % 4 == 0 ? colors : nullptr, texs, 2, paint);
+        break;
+      }
+      }
+    }
+  }
+
+private:
+  const int size;
+  const int pathEdges;
+  const unsigned seed;
+  int objects;
+  GBitmap texture;
+  std::unique_ptr<GShader> bitmapShader;
+  std::unique_ptr<GShader> gradient;
+
+  static float rnd(unsigned &s, float lo, float hi)
+  {
+    s = s * 1664525u + 1013904223u;
+    return lo + (hi - lo) * ((s >> 8) / 16777216.0f);
+  }
+
+  // A self-intersecting star with pathEdges edges, to exercise winding and long dot rows.
+  GPath star(float x, float y, float r, float angle) const
+  {
+    GPath path;
+    int step = pathEdges / 2 - (pathEdges % 2 == 0);
+    for (int i = 0; i < pathEdges; ++i)
+    {
+      float t = angle + 6.2831853f * i * std::max(1, step) / pathEdges;
+      GPoint p = {x + r * cosf(t), y + r * sinf(t)};
+      i == 0 ? path.moveTo(p) : path.lineTo(p);
+    }
+    return path;
+  }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "LThreadPool.h"
+#include "LTileRenderer.h"
+#include "LTrace.h"
+#include "scene.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+#include <thread>
+
+// Macro benchmark: renders the same scene density through GCreateCanvas at canvas sizes from
+// 256 up to max size, and at 1..N threads through LTileRenderer and through one canvas drawing
+// in parallel bands, reporting frames/s, pixels/s
+// and peak resident memory for each run as a JSON array. Given a trace path, one tiled frame
+// at the largest size and thread count is also written there as a Chrome trace.
+//
+//   scene_bench [max size] [density] [path edges] [max threads] [trace.json]
+
+static const double kMinSeconds = 0.5;
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Linux lets the peak RSS be reset by writing 5 to clear_refs, so each run reports its own
+// peak. Elsewhere this does nothing and the peak is cumulative.
+static void resetPeakMemory()
+{
+  if (FILE *f = fopen("/proc/self/clear_refs", "w"))
+  {
+    fputs("5", f);
+    fclose(f);
+  }
+}
+
+static long peakMemoryKB()
+{
+  if (FILE *f = fopen("/proc/self/status", "r"))
+  {
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), f))
+    {
+      if (sscanf(line, "VmHWM: %ld kB", &kb) == 1)
+        break;
+    }
+    fclose(f);
+    if (kb >= 0)
+      return kb;
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static bool first = true;
+
+// Draw frames until kMinSeconds have passed (at least two), then report.
+template <typename Frame>
+static void run(const char *renderer, int size, int threads, const Scene &scene, Frame &&frame)
+{
+  resetPeakMemory();
+  frame();
+  int frames = 0;
+  auto start = std::chrono::steady_clock::now();
+  do
+  {
+    frame();
+    ++frames;
+  } while (frames < 2 || elapsedSeconds(start) < kMinSeconds);
+  double seconds = elapsedSeconds(start);
+
+  printf("%s\n  {\"renderer\": \"%s\", \"size\": %d, \"threads\": %d, \"objects\": %d, \"frames_per_s\": %.3f, "
+         "\"pixels_per_s\": %.4g, \"peak_rss_kb\": %ld}",
+         first ? "" : ",", renderer, size, threads, scene.objectCount(), frames / seconds,
+         (double)size * size * frames / seconds, peakMemoryKB());
+  first = false;
+  fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+  int maxSize = argc > 1 ? atoi(argv[1]) : 8192;
+  float density = argc > 2 ? atof(argv[2]) : 8;
+  int pathEdges = argc > 3 ? atoi(argv[3]) : 16;
+  int maxThreads = argc > 4 ? atoi(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+  const char *tracePath = argc > 5 ? argv[5] : nullptr;
+
+  printf("[");
+  for (int size = 256; size <= maxSize; size *= 2)
+  {
+    Scene scene(size, density, pathEdges);
+    GBitmap device;
+    device.alloc(size, size);
+
+    {
+      auto canvas = GCreateCanvas(device);
+      run("canvas", size, 1, scene, [&]
+          { scene.draw(canvas.get()); });
+    }
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+      LTileCanvas canvas(device, 64, threads);
+      run("tiled", size, threads, scene, [&]
+          {
+            scene.draw(&canvas);
+            canvas.flush(); });
+    }
+    for (int threads = 2; threads <= maxThreads; threads *= 2)
+    {
+      LThreadPool pool(threads);
+      auto canvas = LCreateCanvas(device);
+      canvas->setThreadPool(&pool);
+      run("banded", size, threads, scene, [&]
+          { scene.draw(canvas.get()); });
+    }
+
+    if (tracePath && size * 2 > maxSize)
+    {
+      LTileCanvas canvas(device, 64, maxThreads);
+      LTraceStart();
+      scene.draw(&canvas);
+      canvas.flush();
+      LTraceStop();
+      if (!LTraceWrite(tracePath))
+      {
+        fprintf(stderr, "could not write %s\n", tracePath);
+      }
+    }
+
+    free(device.pixels());
+  }
+  printf("\n]\n");
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "LPicture.h"
+#include "LStripRenderer.h"
+#include "scene.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Streaming benchmark for LStripRenderer: a scene drawn into a whole device, then streamed in
+// strips of several heights, comparing time and the memory each holds. The pixels are checked
+// by hashing the rows in device order, which is all a streaming sink sees.
+//
+//   strip_bench [size] [density]
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// FNV-1a over rows, so padded row bytes do not count.
+static void hashRows(const GBitmap &rows, uint64_t *hash)
+{
+  for (int y = 0; y < rows.height(); ++y)
+  {
+    const unsigned char *bytes = (const unsigned char *)rows.getAddr(0, y);
+    for (size_t i = 0; i < rows.width() * sizeof(GPixel); ++i)
+    {
+      *hash = (*hash ^ bytes[i]) * 1099511628211ull;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int size = argc > 1 ? atoi(argv[1]) : 4096;
+  float density = argc > 2 ? atof(argv[2]) : 4;
+  const int reps = 3;
+
+  Scene scene(size, density, 16);
+  LPicture picture;
+  LRecorder recorder(&picture);
+  scene.draw(&recorder);
+
+  GBitmap device;
+  device.alloc(size, size);
+  double best = 1e30;
+  for (int rep = 0; rep < reps; ++rep)
+  {
+    auto start = std::chrono::steady_clock::now();
+    picture.playback(GCreateCanvas(device).get());
+    best = std::min(best, elapsedMs(start));
+  }
+  uint64_t expected = 14695981039346656037ull;
+  hashRows(device, &expected);
+  free(device.pixels());
+  printf("%d x %d, %zu ops\n", size, size, picture.ops.size());
+  printf("whole device      %8.2f ms  %8.1f MB held\n", best, size * device.rowBytes() / 1048576.0);
+
+  bool allMatch = true;
+  for (int stripHeight : {16, 64, 256})
+  {
+    LStripRenderer renderer(size, size, stripHeight);
+    double stripBest = 1e30;
+    size_t held = 0;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+      auto start = std::chrono::steady_clock::now();
+      renderer.render(picture, [&](const GBitmap &rows, int)
+                      { held = std::max(held, rows.height() * rows.rowBytes() + renderer.memoryUsage().total()); });
+      stripBest = std::min(stripBest, elapsedMs(start));
+    }
+    // Hashed in a pass of its own, so the timing is the drawing alone.
+    uint64_t hash = 14695981039346656037ull;
+    renderer.render(picture, [&](const GBitmap &rows, int)
+                    { hashRows(rows, &hash); });
+    bool match = hash == expected;
+    allMatch = allMatch && match;
+    printf("strips of %4d    %8.2f ms  %8.1f MB held  %s\n", stripHeight, stripBest, held / 1048576.0, match ? "match" : "MISMATCH");
+  }
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GShader.h"
+#include "LTexture.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Startup benchmark for a texture library: each texture file is opened and one thumbnail
+// drawn from a corner of it, either after reading the whole file into a bitmap or straight
+// from a mapping. Only the pages the draw touches are read in the mapped case. The files stay
+// in the page cache between runs, so this measures the copies and scans, not the disk.
+//
+//   texture_bench [textures] [size] [directory]
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Read a texture container the way callers did before LMapTexture: whole, into a new bitmap.
+static bool readTexture(const char *path, GBitmap *bitmap)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+  LTextureHeader header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1;
+  if (ok)
+  {
+    bitmap->alloc(header.width, header.height, header.rowBytes);
+    fseek(file, header.pixelOffset, SEEK_SET);
+    ok = fread(bitmap->pixels(), header.rowBytes, header.height, file) == header.height;
+  }
+  fclose(file);
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  int count = argc > 1 ? atoi(argv[1]) : 8;
+  int size = argc > 2 ? atoi(argv[2]) : 2048;
+  std::string directory = argc > 3 ? argv[3] : "/tmp";
+  const int thumbnail = 128;
+  const int reps = 3;
+
+  std::vector<std::string> paths;
+  for (int i = 0; i < count; ++i)
+  {
+    GBitmap texture;
+    texture.alloc(size, size);
+    for (int y = 0; y < size; ++y)
+    {
+      for (int x = 0; x < size; ++x)
+      {
+        *texture.getAddr(x, y) = GPixel_PackARGB(255, (x + i) & 0xFF, y & 0xFF, (x ^ y) & 0xFF);
+      }
+    }
+    paths.push_back(directory + "/texture_bench_" + std::to_string(i) + ".ltex");
+    if (!LWriteTexture(paths.back().c_str(), texture))
+    {
+      fprintf(stderr, "cannot write %s\n", paths.back().c_str());
+      return 1;
+    }
+    free(texture.pixels());
+  }
+
+  // Each thumbnail shows the texture's top-left corner at 1:1, rotated a little.
+  const GMatrix local = GMatrix::Rotate(0.3f);
+  std::vector<GBitmap> expected(count);
+  std::vector<GBitmap> actual(count);
+  for (int i = 0; i < count; ++i)
+  {
+    expected[i].alloc(thumbnail, thumbnail);
+    actual[i].alloc(thumbnail, thumbnail);
+  }
+
+  double readBest = 1e30;
+  for (int rep = 0; rep < reps; ++rep)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+      GBitmap texture;
+      if (!readTexture(paths[i].c_str(), &texture))
+        return 1;
+      std::unique_ptr<GShader> shader = GCreateBitmapShader(texture, local);
+      GPaint paint;
+      paint.setShader(shader.get());
+      GCreateCanvas(expected[i])->drawPaint(paint);
+      free(texture.pixels());
+    }
+    readBest = std::min(readBest, elapsedMs(start));
+  }
+
+  double mapBest = 1e30;
+  for (int rep = 0; rep < reps; ++rep)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+      std::unique_ptr<LMappedTexture> texture = LMapTexture(paths[i].c_str());
+      if (!texture)
+        return 1;
+      std::unique_ptr<GShader> shader = GCreateBitmapShader(texture->bitmap(), local);
+      GPaint paint;
+      paint.setShader(shader.get());
+      GCreateCanvas(actual[i])->drawPaint(paint);
+    }
+    mapBest = std::min(mapBest, elapsedMs(start));
+  }
+
+  bool match = true;
+  for (int i = 0; i < count; ++i)
+  {
+    match = match && 0 == memcmp(expected[i].pixels(), actual[i].pixels(), thumbnail * expected[i].rowBytes());
+    free(expected[i].pixels());
+    free(actual[i].pixels());
+    remove(paths[i].c_str());
+  }
+  printf("%d textures of %d x %d, one %d x %d thumbnail from each\n", count, size, size, thumbnail, thumbnail);
+  printf("read and copy  %8.2f ms\n", readBest);
+  printf("mapped         %8.2f ms  speedup %5.1fx  %s\n", mapBest, readBest / mapBest, match ? "match" : "MISMATCH");
+  return match ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GPath.h"
+#include "GShader.h"
+#include "LPicture.h"
+#include "LTileRenderer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Scaling benchmark for LTileRenderer: renders a frame of overlapping draws through MyCanvas
+// and through the tiled renderer at 1..N threads, checking that the pixels match.
+//
+//   tile_bench [size] [ops] [max threads] [tile size]
+
+static float rnd(unsigned &seed, float lo, float hi)
+{
+  seed = seed * 1664525u + 1013904223u;
+  return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+}
+
+static void drawScene(GCanvas *canvas, int size, int numOps, GShader *gradient)
+{
+  unsigned seed = 475;
+  canvas->clear({1, 1, 1, 1});
+  canvas->save();
+  for (int i = 0; i < numOps; ++i)
+  {
+    // Every 64 ops, switch between no clip, a rect clip and a path clip.
+    if (i % 64 == 0)
+    {
+      canvas->restore();
+      canvas->save();
+      float cx = rnd(seed, 0, size);
+      float cy = rnd(seed, 0, size);
+      if (i % 192 == 64)
+      {
+        canvas->clipRect(GRect::MakeXYWH(cx - size * 0.3f, cy - size * 0.2f, size * 0.6f, size * 0.4f));
+      }
+      else if (i % 192 == 128)
+      {
+        GPath clip;
+        clip.addCircle({cx, cy}, size * 0.3f);
+        canvas->clipPath(clip);
+      }
+    }
+    GPaint paint({rnd(seed, 0, 1), rnd(seed, 0, 1), rnd(seed, 0, 1), rnd(seed, 0.2f, 1)});
+    float x = rnd(seed, -size * 0.1f, size);
+    float y = rnd(seed, -size * 0.1f, size);
+    float r = rnd(seed, size * 0.02f, size * 0.2f);
+    switch (i % 4)
+    {
+    case 0:
+      canvas->drawRect(GRect::MakeXYWH(x, y, 2 * r, r), paint);
+      break;
+    case 1:
+    {
+      GPath path;
+      path.addCircle({x, y}, r);
+      canvas->drawPath(path, paint);
+      break;
+    }
+    case 2:
+    {
+      canvas->save();
+      canvas->translate(x, y);
+      canvas->rotate(rnd(seed, 0, 3.14f));
+      paint.setShader(gradient);
+      canvas->drawRect(GRect::MakeXYWH(-r, -r, 2 * r, 2 * r), paint);
+      canvas->restore();
+      break;
+    }
+    default:
+    {
+      GPoint verts[] = {{x, y}, {x + r, y + r * 0.25f}, {x + r * 0.75f, y + r}, {x - r * 0.25f, y + r * 0.75f}};
+      GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}, {1, 1, 0, 0.5f}};
+      canvas->drawQuad(verts, colors, nullptr, 2, paint);
+      break;
+    }
+    }
+  }
+  canvas->restore();
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+  int size = argc > 1 ? atoi(argv[1]) : 1024;
+  int numOps = argc > 2 ? atoi(argv[2]) : 2000;
+  int maxThreads = argc > 3 ? atoi(argv[3]) : std::max(4u, std::thread::hardware_concurrency());
+  int tileSize = argc > 4 ? atoi(argv[4]) : 64;
+  const int reps = 5;
+
+  auto gradient = GCreateLinearGradient({0, 0}, {1, 1}, {1, 0, 0, 1}, {0, 0, 1, 1}, GShader::kMirror);
+
+  LPicture picture;
+  LRecorder recorder(&picture);
+  drawScene(&recorder, size, numOps, gradient.get());
+
+  GBitmap reference;
+  reference.alloc(size, size);
+  double best = 1e30;
+  for (int rep = 0; rep < reps; ++rep)
+  {
+    auto canvas = GCreateCanvas(reference);
+    auto start = std::chrono::steady_clock::now();
+    picture.playback(canvas.get());
+    best = std::min(best, elapsedMs(start));
+  }
+  printf("size %d, ops %d, tile %d\n", size, numOps, tileSize);
+  printf("MyCanvas          %8.2f ms\n", best);
+
+  GBitmap tiled;
+  tiled.alloc(size, size);
+  bool allMatch = true;
+  double single = 0;
+  for (int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    LTileRenderer renderer(tiled, tileSize, threads);
+    double tiledBest = 1e30;
+    for (int rep = 0; rep < reps; ++rep)
+    {
+      auto start = std::chrono::steady_clock::now();
+      renderer.render(picture);
+      tiledBest = std::min(tiledBest, elapsedMs(start));
+    }
+    if (threads == 1)
+    {
+      single = tiledBest;
+    }
+    bool match = 0 == memcmp(reference.pixels(), tiled.pixels(), size * reference.rowBytes());
+    allMatch = allMatch && match;
+    printf("tiled %2d threads  %8.2f ms  speedup %5.2fx  %s\n", threads, tiledBest, single / tiledBest, match ? "match" : "MISMATCH");
+  }
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+// Runs micro_bench from the scalar and the SIMD128 build and prints, per benchmark, both rates
+// and the SIMD build's speedup as a JSON array. Either build may also be a native micro_bench
+// binary (e.g. one built with make SCALAR=1).
+//
+//   node bench/wasm_simd.js <scalar.js> <simd.js> [filter]
+
+const { execFileSync } = require('child_process');
+const { simdSupported } = require('../web/loader.js');
+
+const [scalar, simd, filter] = process.argv.slice(2);
+if (!scalar || !simd) {
+  console.error('usage: node bench/wasm_simd.js <scalar.js> <simd.js> [filter]');
+  process.exit(1);
+}
+if (!simdSupported()) {
+  console.error('this Node does not support WebAssembly SIMD');
+  process.exit(1);
+}
+
+function runBench(path) {
+  const args = filter ? [filter] : [];
+  const output = path.endsWith('.js')
+    ? execFileSync(process.execPath, [path, ...args], { encoding: 'utf8' })
+    : execFileSync(path, args, { encoding: 'utf8' });
+  return JSON.parse(output);
+}
+
+const scalarRuns = new Map(runBench(scalar).map((run) => [run.name, run]));
+const results = [];
+for (const run of runBench(simd)) {
+  const base = scalarRuns.get(run.name);
+  if (!base) continue;
+  results.push({
+    name: run.name,
+    unit: run.unit,
+    scalar_per_s: base.per_s,
+    simd_per_s: run.per_s,
+    speedup: Number((base.ns_per_op / run.ns_per_op).toFixed(3)),
+  });
+}
+console.log(JSON.stringify(results, null, 2));
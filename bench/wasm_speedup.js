@@ -0,0 +1,40 @@
+// Runs scene_bench from the single-threaded and the pthread build on the same scenes and prints,
+// per scene size, the single-threaded canvas against the fastest threaded renderer as a JSON
+// array. Either build may also be a native scene_bench binary.
+//
+//   node bench/wasm_speedup.js <single.js> <threaded.js> [max size] [density] [path edges] [max threads]
+
+const { execFileSync } = require('child_process');
+const os = require('os');
+
+const [single, threaded, maxSize = '1024', density = '8', pathEdges = '16', maxThreads = String(os.cpus().length)] =
+  process.argv.slice(2);
+if (!single || !threaded) {
+  console.error('usage: node bench/wasm_speedup.js <single.js> <threaded.js> [max size] [density] [path edges] [max threads]');
+  process.exit(1);
+}
+
+function runBench(path, threads) {
+  const args = [maxSize, density, pathEdges, String(threads)];
+  const output = path.endsWith('.js')
+    ? execFileSync(process.execPath, [path, ...args], { encoding: 'utf8' })
+    : execFileSync(path, args, { encoding: 'utf8' });
+  return JSON.parse(output);
+}
+
+const baseline = runBench(single, 1);
+const runs = runBench(threaded, maxThreads);
+
+const results = [];
+for (const base of baseline.filter((run) => run.renderer === 'canvas')) {
+  const sameSize = runs.filter((run) => run.size === base.size);
+  const best = sameSize.reduce((a, b) => (b.frames_per_s > a.frames_per_s ? b : a));
+  results.push({
+    size: base.size,
+    single_frames_per_s: base.frames_per_s,
+    best: `${best.renderer}/${best.threads}`,
+    best_frames_per_s: best.frames_per_s,
+    speedup: Number((best.frames_per_s / base.frames_per_s).toFixed(3)),
+  });
+}
+console.log(JSON.stringify(results, null, 2));
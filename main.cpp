@@ -1,9 +1,21 @@
+#include <emscripten.h>
+#include <emscripten/bind.h>
 #include <emscripten/val.h>
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <vector>
 #include "GBitmap.h"
 #include "GCanvas.h"
+#include "GShader.h"
+#include "LCanvas.h"
+#include "LCommands.h"
+#include "LEncode.h"
+#include "LFrameLoop.h"
+#include "LStats.h"
+#include "LThreadPool.h"
+#include "LTrace.h"
 
 #define WIDTH 256
 #define HEIGHT 256
@@ -15,57 +27,274 @@ thread_local const val document = val::global("document");
 
 // …
 
-void convertToBuffer(const GPixel src[], int width, uint8_t dst[])
+// Draws the page's frames, the next one (on a worker in the pthread build) while the browser
+// shows the last.
+static std::unique_ptr<LFrameLoop> frameLoop;
+
+// Started once at init and reused by every frame. In the pthread build (make wasm-mt) it has one
+// worker per hardware thread; otherwise it is a pool of 1 that draws inline.
+static std::unique_ptr<LThreadPool> renderPool;
+
+// Convert just the pixels of rect into dst, an RGBA buffer covering the whole bitmap. The page's
+// scene turns every frame, so presentFrame converts the whole frame.
+void convertRect(const GBitmap &bitmap, const GIRect &rect, uint8_t dst[])
 {
-  for (int i = 0; i < width; i++)
+  for (int y = rect.top(); y < rect.bottom(); ++y)
   {
-    GPixel c = *src++;
-    int a = GPixel_GetA(c);
-    int r = GPixel_GetR(c);
-    int g = GPixel_GetG(c);
-    int b = GPixel_GetB(c);
-
-    // PNG requires unpremultiplied, but GPixel is premultiplied
-    if (0 != a && 255 != a)
-    {
-      r = (r * 255 + a / 2) / a;
-      g = (g * 255 + a / 2) / a;
-      b = (b * 255 + a / 2) / a;
-    }
-    *dst++ = r;
-    *dst++ = g;
-    *dst++ = b;
-    *dst++ = a;
+    LUnpremulToRGBA(bitmap.getAddr(rect.left(), y), rect.width(), dst + (y * bitmap.width() + rect.left()) * 4);
   }
 }
 
-int main()
+// Counters as a plain JS object. They are doubles on the JS side, which is exact well past any
+// frame's counts.
+val statsToJS(const LStats &stats)
 {
-  val canvas = document.call<val>("getElementById", val("canvas"));
+  val draws = val::object();
+  for (int i = 0; i < LStats::kDrawCount; ++i)
+  {
+    draws.set(LDrawName(i), (double)stats.draws[i]);
+  }
+  val pixels = val::object();
+  for (int i = 0; i < LStats::kBlendModeCount; ++i)
+  {
+    pixels.set(LBlendModeName(i), (double)stats.pixels[i]);
+  }
+  val phaseMs = val::object();
+  for (int i = 0; i < LStats::kPhaseCount; ++i)
+  {
+    phaseMs.set(LPhaseName(i), stats.phaseNs[i] / 1e6);
+  }
 
-  canvas.set("width", WIDTH);
-  canvas.set("height", HEIGHT);
+  val result = val::object();
+#ifdef LSTATS
+  result.set("enabled", true);
+#else
+  result.set("enabled", false);
+#endif
+  result.set("draws", draws);
+  result.set("edges", (double)stats.edges);
+  result.set("dots", (double)stats.dots);
+  result.set("rowsVisited", (double)stats.rowsVisited);
+  result.set("rowsNonEmpty", (double)stats.rowsNonEmpty);
+  result.set("pixels", pixels);
+  result.set("shaderRows", (double)stats.shaderRows);
+  result.set("shaderPixels", (double)stats.shaderPixels);
+  result.set("sorts", (double)stats.sorts);
+  result.set("sortedDots", (double)stats.sortedDots);
+  result.set("maxSortSize", stats.maxSortSize);
+  result.set("phaseMs", phaseMs);
+  return result;
+}
+
+val canvasStats()
+{
+  return statsToJS(frameLoop ? frameLoop->stats() : LStats());
+}
+
+void resetCanvasStats()
+{
+  if (frameLoop)
+  {
+    frameLoop->resetStats();
+  }
+}
+
+// 1 in the single-threaded build, so the page can tell which build it loaded.
+int renderThreads()
+{
+  return renderPool ? renderPool->count() : 1;
+}
+
+EMSCRIPTEN_BINDINGS(canvas_stats)
+{
+  emscripten::function("renderThreads", &renderThreads);
+  emscripten::function("canvasStats", &canvasStats);
+  emscripten::function("resetCanvasStats", &resetCanvasStats);
+}
+
+// Bytes the canvas holds per subsystem, so long-running pages can watch for growth.
+val canvasMemory()
+{
+  LMemoryUsage usage = frameLoop ? frameLoop->frontCanvas()->memoryUsage() : LMemoryUsage();
+  val result = val::object();
+  result.set("columnBuffer", (double)usage.columnBuffer);
+  result.set("rowBuffer", (double)usage.rowBuffer);
+  result.set("geometry", (double)usage.geometry);
+  result.set("clip", (double)usage.clip);
+  result.set("other", (double)usage.other);
+  result.set("total", (double)usage.total());
+  return result;
+}
+
+// Call after a frame to bring the canvas scratch back within budget. Each buffer of the frame
+// loop has its own canvas and this trims the one whose frame is on screen, so calling it every
+// frame trims both in turn.
+void trimCanvas(double budgetBytes)
+{
+  if (frameLoop)
+  {
+    frameLoop->frontCanvas()->setScratchBudget(budgetBytes);
+    frameLoop->frontCanvas()->trim();
+  }
+}
+
+EMSCRIPTEN_BINDINGS(canvas_memory)
+{
+  emscripten::function("canvasMemory", &canvasMemory);
+  emscripten::function("trimCanvas", &trimCanvas);
+}
+
+// Command batches from JS (web/commands.js): the page writes its commands into the buffer
+// commandBuffer returns and hands them all over with one runCommands call, instead of one embind
+// call per draw. A batch is drawn on top of the scene in every frame from the next one on, until
+// the page sends another.
+static std::vector<uint32_t> commandWords;
+static std::vector<std::unique_ptr<GShader>> commandShaders;
+static std::vector<GShader *> shaderTable;
+
+// Only swapped in between frames, while nothing is drawing, and only read by frame draws.
+static LCommandRunner commandRunner;
+static std::vector<uint32_t> queuedWords;
+static std::vector<uint32_t> frameWords;
+static bool batchQueued = false;
+// Written by the frame's draw on the render thread, read from JS on the main thread.
+static std::atomic<int> batchIssued{0};
+
+// The address of room for at least words commands in wasm memory. It moves when it grows, and
+// growing memory detaches the JS views of it, so callers take it again after asking for more.
+uintptr_t commandBuffer(int words)
+{
+  if ((int)commandWords.size() < words)
+  {
+    commandWords.resize(words);
+  }
+  return (uintptr_t)commandWords.data();
+}
+
+// Queue the first count words of the buffer for the coming frames.
+void runCommands(int count)
+{
+  count = std::max(0, std::min(count, (int)commandWords.size()));
+  queuedWords.assign(commandWords.begin(), commandWords.begin() + count);
+  batchQueued = true;
+}
+
+// How far the last frame got through its batch: the batch size, or the index of the first
+// malformed command (see LCommands.h).
+int commandsIssued()
+{
+  return batchIssued.load(std::memory_order_relaxed);
+}
+
+// Adds a two-color clamped gradient to the table kCmdSetShader indexes, and returns its index.
+int addLinearGradient(float x0, float y0, float x1, float y1, uint32_t argb0, uint32_t argb1)
+{
+  auto color = [](uint32_t argb)
+  {
+    return GColor::RGBA(((argb >> 16) & 0xFF) / 255.0f, ((argb >> 8) & 0xFF) / 255.0f, (argb & 0xFF) / 255.0f,
+                        (argb >> 24) / 255.0f);
+  };
+  commandShaders.push_back(GCreateLinearGradient({x0, y0}, {x1, y1}, color(argb0), color(argb1)));
+  shaderTable.push_back(commandShaders.back().get());
+  return (int)shaderTable.size() - 1;
+}
+
+EMSCRIPTEN_BINDINGS(canvas_commands)
+{
+  emscripten::function("commandBuffer", &commandBuffer);
+  emscripten::function("runCommands", &runCommands);
+  emscripten::function("commandsIssued", &commandsIssued);
+  emscripten::function("addLinearGradient", &addLinearGradient);
+}
+
+// Tracing from JS: traceStart(), draw some frames, traceStop(), then save traceJSON() and load
+// it in ui.perfetto.dev.
+EMSCRIPTEN_BINDINGS(canvas_trace)
+{
+  emscripten::function("traceStart", &LTraceStart);
+  emscripten::function("traceStop", &LTraceStop);
+  emscripten::function("traceJSON", &LTraceJSON);
+}
+
+static val frameTimesToJS(const LFrameTimes &times)
+{
+  val result = val::object();
+  result.set("frames", times.frames);
+  result.set("p50", times.p50);
+  result.set("p90", times.p90);
+  result.set("p99", times.p99);
+  result.set("max", times.max);
+  return result;
+}
 
-  GBitmap bitmap;
-  bitmap.alloc(WIDTH, HEIGHT);
-  auto cv = GCreateCanvas(bitmap);
-  std::string title = GDrawSomething(cv.get(), {256, 256});
+// Percentiles in milliseconds over the last few seconds: draw is the time spent drawing a frame,
+// frame the time from one presented frame to the next.
+val frameTimes()
+{
+  val result = val::object();
+  result.set("draw", frameTimesToJS(frameLoop ? frameLoop->drawTimes() : LFrameTimes()));
+  result.set("frame", frameTimesToJS(frameLoop ? frameLoop->frameTimes() : LFrameTimes()));
+  return result;
+}
 
-  val ctx = canvas.call<val>("getContext", val("2d"));
+EMSCRIPTEN_BINDINGS(canvas_frames)
+{
+  emscripten::function("frameTimes", &frameTimes);
+}
 
-  const GPixel *src = bitmap.pixels();
-  auto pixels = std::vector<uint8_t>(bitmap.height() * bitmap.width() * 4);
-  auto dst = pixels.data();
+// The page's scene, turning slowly about the middle of the canvas, with the page's command batch
+// on top.
+static void drawFrame(LCanvas *canvas, int frame)
+{
+  canvas->clear({1, 1, 1, 1});
+  canvas->save();
+  canvas->translate(WIDTH / 2, HEIGHT / 2);
+  canvas->rotate(frame * 0.01f);
+  canvas->translate(-WIDTH / 2, -HEIGHT / 2);
+  std::string title = GDrawSomething(canvas, {WIDTH, HEIGHT});
+  canvas->restore();
+  if (frame == 0)
+  {
+    std::cout << title << std::endl;
+  }
+  batchIssued.store(commandRunner.run(frameWords.data(), (int)frameWords.size(), canvas), std::memory_order_relaxed);
+}
 
-  for (int y = 0; y < HEIGHT; ++y)
+static val context2d = val::undefined();
+static std::vector<uint8_t> framePixels(WIDTH * HEIGHT * 4);
+
+// One browser frame: take the frame drawn since the last one, set the next one drawing, and
+// show this one while it does.
+static void presentFrame()
+{
+  const GBitmap &frame = frameLoop->nextFrame();
+  if (batchQueued)
   {
-    convertToBuffer(src, WIDTH, dst);
-    src += bitmap.rowBytes() / 4;
-    dst += WIDTH * 4;
+    frameWords.swap(queuedWords);
+    batchQueued = false;
   }
-  
+  commandRunner.shaders = shaderTable;
+  frameLoop->startFrame();
 
-  std::cout << title << std::endl;
+  convertRect(frame, GIRect::MakeWH(WIDTH, HEIGHT), framePixels.data());
+  val clamped = val::global("Uint8ClampedArray").new_(emscripten::typed_memory_view(framePixels.size(), framePixels.data()));
+  context2d.call<void>("putImageData", val::global("ImageData").new_(clamped, WIDTH, HEIGHT), 0, 0);
+}
+
+int main()
+{
+  val canvas = document.call<val>("getElementById", val("canvas"));
 
+  canvas.set("width", WIDTH);
+  canvas.set("height", HEIGHT);
+  context2d = canvas.call<val>("getContext", val("2d"));
+
+  renderPool.reset(new LThreadPool());
+  frameLoop.reset(new LFrameLoop(WIDTH, HEIGHT, drawFrame));
+  frameLoop->setThreadPool(renderPool.get());
+  frameLoop->startFrame();
+
+  // Keep the runtime alive after main returns and call presentFrame before every repaint.
+  emscripten_set_main_loop(presentFrame, 0, false);
   return 0;
-}
\ No newline at end of file
+}
@@ -1,7 +1,19 @@
 #include "GBitmap.h"
+#include "LBitmapPool.h"
+#include <cstdlib>
+#include <cstring>
 
 void GBitmap::setIsOpaque(IsOpaque io) {
-    
+    switch (io) {
+        case kYes_IsOpaque:
+            fIsOpaque = true;
+            break;
+        case kCompute_IsOpaque:
+            fIsOpaque = ComputeIsOpaque(*this);
+            break;
+        default:
+            fIsOpaque = false;
+    }
 }
 
 void GBitmap::reset(int w, int h, size_t rb, GPixel* pixels, IsOpaque io) {
@@ -29,13 +41,20 @@ void GBitmap::alloc(int w, int h, size_t rb) {
     assert(w >= 0);
     assert(h >= 0);
     if (rb == 0) {
-        rb = w * sizeof(GPixel);
+        rb = LAlignedRowBytes(w);
     }
     fWidth = w;
     fHeight = h;
     fRowBytes = rb;
 
-    this->reset(w, h, rb,
-                (w > 0 && h > 0) ? (GPixel*)calloc(h, rb) : nullptr,
-                kNo_IsOpaque);
+    // aligned_alloc wants a multiple of the alignment; the memory is still released with free().
+    GPixel* pixels = nullptr;
+    if (w > 0 && h > 0) {
+        size_t bytes = (h * rb + kBitmapRowAlign - 1) / kBitmapRowAlign * kBitmapRowAlign;
+        pixels = (GPixel*)aligned_alloc(kBitmapRowAlign, bytes);
+        if (pixels) {
+            memset(pixels, 0, bytes);
+        }
+    }
+    this->reset(w, h, rb, pixels, kNo_IsOpaque);
 }
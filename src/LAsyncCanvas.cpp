@@ -0,0 +1,98 @@
+#include "LAsyncCanvas.h"
+#include "LCanvas.h"
+#include "LTrace.h"
+
+static int resolveWorkers(int threads)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  (void)threads;
+  return 0;
+#else
+  if (threads <= 0)
+  {
+    threads = std::thread::hardware_concurrency();
+  }
+  return threads > 0 ? threads : 1;
+#endif
+}
+
+LAsyncRenderer::LAsyncRenderer(int threads, int queueSize) : queue(queueSize)
+{
+  for (int i = resolveWorkers(threads); i > 0; --i)
+  {
+    workers.emplace_back(&LAsyncRenderer::workerLoop, this);
+  }
+}
+
+LAsyncRenderer::~LAsyncRenderer()
+{
+  {
+    std::lock_guard<std::mutex> guard(sleepLock);
+    quit = true;
+  }
+  wake.notify_all();
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+}
+
+std::future<void> LAsyncRenderer::submit(LPicture &&picture, const GBitmap &target)
+{
+  Job job;
+  job.picture = std::move(picture);
+  job.target = target;
+  std::future<void> done = job.done.get_future();
+  if (workers.empty())
+  {
+    run(job);
+    return done;
+  }
+
+  Job queued;
+  while (!queue.push(job))
+  {
+    if (queue.pop(&queued))
+    {
+      run(queued);
+    }
+  }
+  pushes.fetch_add(1);
+  if (sleepers.load() > 0)
+  {
+    // Taking the lock orders this with a worker between its last look at pushes and its wait.
+    std::lock_guard<std::mutex> guard(sleepLock);
+    wake.notify_one();
+  }
+  return done;
+}
+
+void LAsyncRenderer::workerLoop()
+{
+  Job job;
+  for (;;)
+  {
+    unsigned seen = pushes.load();
+    if (queue.pop(&job))
+    {
+      run(job);
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(sleepLock);
+    sleepers.fetch_add(1);
+    // Exit only once the queue is drained, so every future handed out gets its pixels.
+    wake.wait(guard, [this, seen]
+              { return pushes.load() != seen || quit; });
+    sleepers.fetch_sub(1);
+    if (quit && pushes.load() == seen)
+      return;
+  }
+}
+
+void LAsyncRenderer::run(Job &job)
+{
+  LTRACE("asyncPicture");
+  job.picture.playback(LCreateCanvas(job.target).get());
+  job.picture.reset();
+  job.done.set_value();
+}
@@ -0,0 +1,122 @@
+#include "LBitmapPool.h"
+#include <cstdlib>
+#include <cstring>
+
+static const size_t kMinClassBytes = 4096;
+
+// Round bytes up to one of four evenly spaced sizes between consecutive powers of two.
+static size_t sizeClass(size_t bytes)
+{
+  if (bytes <= kMinClassBytes)
+  {
+    return kMinClassBytes;
+  }
+  size_t power = kMinClassBytes;
+  while (power * 2 < bytes)
+  {
+    power *= 2;
+  }
+  size_t step = power / 4;
+  return (bytes + step - 1) / step * step;
+}
+
+LPooledBitmap &LPooledBitmap::operator=(LPooledBitmap &&other)
+{
+  if (this != &other)
+  {
+    release();
+    fBitmap = other.fBitmap;
+    pool = other.pool;
+    bytes = other.bytes;
+    other.pool = nullptr;
+  }
+  return *this;
+}
+
+void LPooledBitmap::release()
+{
+  if (pool)
+  {
+    pool->recycle(fBitmap.pixels(), bytes);
+    pool = nullptr;
+    fBitmap.reset();
+  }
+}
+
+LBitmapPool::~LBitmapPool()
+{
+  trim();
+}
+
+LPooledBitmap LBitmapPool::acquire(int width, int height, Init init)
+{
+  size_t rowBytes = LAlignedRowBytes(width);
+  size_t bytes = sizeClass(rowBytes * height);
+  void *pixels = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = freeLists.find(bytes);
+    if (found != freeLists.end() && !found->second.empty())
+    {
+      pixels = found->second.back();
+      found->second.pop_back();
+      pooled -= bytes;
+    }
+  }
+  if (!pixels)
+  {
+    pixels = aligned_alloc(kBitmapRowAlign, bytes);
+    if (!pixels)
+    {
+      return LPooledBitmap();
+    }
+  }
+  if (init == kZeroed)
+  {
+    memset(pixels, 0, rowBytes * height);
+  }
+
+  GBitmap bitmap;
+  bitmap.reset(width, height, rowBytes, (GPixel *)pixels, GBitmap::kNo_IsOpaque);
+  return LPooledBitmap(bitmap, this, bytes);
+}
+
+void LBitmapPool::recycle(void *pixels, size_t bytes)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (pooled + bytes <= maxPooledBytes)
+    {
+      freeLists[bytes].push_back(pixels);
+      pooled += bytes;
+      return;
+    }
+  }
+  free(pixels);
+}
+
+void LBitmapPool::trim()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  for (auto &entry : freeLists)
+  {
+    for (void *pixels : entry.second)
+    {
+      free(pixels);
+    }
+  }
+  freeLists.clear();
+  pooled = 0;
+}
+
+size_t LBitmapPool::pooledBytes()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return pooled;
+}
+
+LBitmapPool &LDefaultBitmapPool()
+{
+  static LBitmapPool pool;
+  return pool;
+}
@@ -0,0 +1,532 @@
+#include "LCommands.h"
+#include "LTrace.h"
+#include <algorithm>
+
+// drawQuad allocates (level + 1)^2 vertices, so a corrupt level must not get that far.
+static const uint32_t kMaxQuadLevel = 1024;
+
+// Words of arguments for commands whose size does not depend on their arguments.
+static const int kFixedArgs[kCmdCount] = {
+    0, // kCmdSave
+    0, // kCmdRestore
+    6, // kCmdConcat
+    4, // kCmdClipRect
+    0, // kCmdClipPath
+    4, // kCmdSetColor
+    1, // kCmdSetBlendMode
+    1, // kCmdSetShader
+    0, // kCmdPathReset
+    2, // kCmdMoveTo
+    2, // kCmdLineTo
+    4, // kCmdQuadTo
+    6, // kCmdCubicTo
+    5, // kCmdAddRect
+    4, // kCmdAddCircle
+    0, // kCmdDrawPaint
+    4, // kCmdDrawRect
+    0, // kCmdDrawPath
+    1, // kCmdDrawConvexPolygon, then the points
+    3, // kCmdDrawMesh, then the arrays
+    2, // kCmdDrawQuad, then the arrays
+    2, // kCmdDrawPathInstances, then the arrays
+    1, // kCmdDrawLines, then the points
+    1, // kCmdDrawPolyline, then the points
+};
+
+struct LCommandRunner::Reader
+{
+  const uint32_t *words;
+  int count;
+  int pos;
+
+  long long left() const { return count - pos; }
+
+  uint32_t u() { return words[pos++]; }
+
+  float f()
+  {
+    float value;
+    memcpy(&value, &words[pos++], sizeof(value));
+    return value;
+  }
+
+  GPoint point()
+  {
+    float x = f();
+    float y = f();
+    return {x, y};
+  }
+
+  GColor color()
+  {
+    float r = f();
+    float g = f();
+    float b = f();
+    float a = f();
+    return GColor::RGBA(r, g, b, a);
+  }
+
+  GMatrix matrix()
+  {
+    float m[6];
+    for (float &value : m)
+    {
+      value = f();
+    }
+    return GMatrix(m[0], m[1], m[2], m[3], m[4], m[5]);
+  }
+
+  GRect rect()
+  {
+    float l = f();
+    float t = f();
+    float r = f();
+    float b = f();
+    return GRect::MakeLTRB(l, t, r, b);
+  }
+};
+
+int LCommandRunner::run(const uint32_t words[], int count, GCanvas *canvas)
+{
+  LTRACE("commands");
+  paint = GPaint();
+  path.reset();
+  depth = 0;
+  Reader in = {words, count, 0};
+  int issued = count;
+  while (in.pos < count)
+  {
+    const int start = in.pos;
+    const uint32_t op = in.u();
+    if (op >= kCmdCount || in.left() < kFixedArgs[op] || !issue(op, in, canvas))
+    {
+      issued = start;
+      break;
+    }
+  }
+  // Whatever the batch left saved, concatenated or clipped is not the caller's to inherit.
+  for (; depth > 0; --depth)
+  {
+    canvas->restore();
+  }
+  return issued;
+}
+
+bool LCommandRunner::issue(uint32_t op, Reader &in, GCanvas *canvas)
+{
+  switch (op)
+  {
+  case kCmdSave:
+    canvas->save();
+    ++depth;
+    return true;
+  case kCmdRestore:
+    // A batch may only restore what it saved itself.
+    if (depth == 0)
+      return false;
+    canvas->restore();
+    --depth;
+    return true;
+  case kCmdConcat:
+    canvas->concat(in.matrix());
+    return true;
+  case kCmdClipRect:
+    canvas->clipRect(in.rect());
+    return true;
+  case kCmdClipPath:
+    canvas->clipPath(path);
+    return true;
+  case kCmdSetColor:
+    paint.setColor(in.color());
+    return true;
+  case kCmdSetBlendMode:
+  {
+    uint32_t mode = in.u();
+    if (mode > (uint32_t)GBlendMode::kXor)
+      return false;
+    paint.setBlendMode((GBlendMode)mode);
+    return true;
+  }
+  case kCmdSetShader:
+  {
+    uint32_t index = in.u();
+    if (index != kNoShader && index >= shaders.size())
+      return false;
+    paint.setShader(index == kNoShader ? nullptr : shaders[index]);
+    return true;
+  }
+  case kCmdPathReset:
+    path.reset();
+    return true;
+  case kCmdMoveTo:
+    path.moveTo(in.point());
+    return true;
+  case kCmdLineTo:
+  case kCmdQuadTo:
+  case kCmdCubicTo:
+  {
+    // Segments continue a contour, so there must be a point to start from.
+    if (path.countPoints() == 0)
+      return false;
+    GPoint p0 = in.point();
+    if (op == kCmdLineTo)
+    {
+      path.lineTo(p0);
+      return true;
+    }
+    GPoint p1 = in.point();
+    if (op == kCmdQuadTo)
+    {
+      path.quadTo(p0, p1);
+      return true;
+    }
+    GPoint p2 = in.point();
+    path.cubicTo(p0, p1, p2);
+    return true;
+  }
+  case kCmdAddRect:
+  {
+    GRect rect = in.rect();
+    uint32_t direction = in.u();
+    if (direction > GPath::kCCW_Direction)
+      return false;
+    path.addRect(rect, (GPath::Direction)direction);
+    return true;
+  }
+  case kCmdAddCircle:
+  {
+    GPoint center = in.point();
+    float radius = in.f();
+    uint32_t direction = in.u();
+    if (direction > GPath::kCCW_Direction)
+      return false;
+    path.addCircle(center, radius, (GPath::Direction)direction);
+    return true;
+  }
+  case kCmdDrawPaint:
+    canvas->drawPaint(paint);
+    return true;
+  case kCmdDrawRect:
+    canvas->drawRect(in.rect(), paint);
+    return true;
+  case kCmdDrawPath:
+    canvas->drawPath(path, paint);
+    return true;
+  case kCmdDrawConvexPolygon:
+  case kCmdDrawLines:
+  case kCmdDrawPolyline:
+  {
+    uint32_t n = in.u();
+    if (in.left() < 2LL * n)
+      return false;
+    points.resize(n);
+    for (GPoint &p : points)
+    {
+      p = in.point();
+    }
+    if (op == kCmdDrawConvexPolygon)
+      canvas->drawConvexPolygon(points.data(), n, paint);
+    else if (op == kCmdDrawLines)
+      canvas->drawLines(points.data(), n, paint);
+    else
+      canvas->drawPolyline(points.data(), n, paint);
+    return true;
+  }
+  case kCmdDrawMesh:
+  {
+    uint32_t triangles = in.u();
+    uint32_t vertices = in.u();
+    uint32_t flags = in.u();
+    long long need = 2LL * vertices + 3LL * triangles;
+    need += (flags & kHasColors) ? 4LL * vertices : 0;
+    need += (flags & kHasTexs) ? 2LL * vertices : 0;
+    if (in.left() < need)
+      return false;
+    readVertices(in, vertices, flags);
+    indices.resize(3 * triangles);
+    for (int &index : indices)
+    {
+      uint32_t value = in.u();
+      if (value >= vertices)
+        return false;
+      index = value;
+    }
+    canvas->drawMesh(points.data(), (flags & kHasColors) ? colors.data() : nullptr,
+                     (flags & kHasTexs) ? texs.data() : nullptr, triangles, indices.data(), paint);
+    return true;
+  }
+  case kCmdDrawQuad:
+  {
+    uint32_t level = in.u();
+    uint32_t flags = in.u();
+    long long need = 8 + ((flags & kHasColors) ? 16 : 0) + ((flags & kHasTexs) ? 8 : 0);
+    if (level > kMaxQuadLevel || in.left() < need)
+      return false;
+    readVertices(in, 4, flags);
+    canvas->drawQuad(points.data(), (flags & kHasColors) ? colors.data() : nullptr,
+                     (flags & kHasTexs) ? texs.data() : nullptr, level, paint);
+    return true;
+  }
+  case kCmdDrawPathInstances:
+  {
+    uint32_t count = in.u();
+    uint32_t flags = in.u();
+    long long need = ((flags & kHasColors) ? 10LL : 6LL) * count;
+    if (in.left() < need)
+      return false;
+    matrices.resize(count);
+    for (GMatrix &m : matrices)
+    {
+      m = in.matrix();
+    }
+    colors.resize((flags & kHasColors) ? count : 0);
+    for (GColor &c : colors)
+    {
+      c = in.color();
+    }
+    canvas->drawPathInstances(path, matrices.data(), (flags & kHasColors) ? colors.data() : nullptr, count, paint);
+    return true;
+  }
+  }
+  return false;
+}
+
+void LCommandRunner::readVertices(Reader &in, int count, uint32_t flags)
+{
+  points.resize(count);
+  for (GPoint &p : points)
+  {
+    p = in.point();
+  }
+  colors.resize((flags & kHasColors) ? count : 0);
+  for (GColor &c : colors)
+  {
+    c = in.color();
+  }
+  texs.resize((flags & kHasTexs) ? count : 0);
+  for (GPoint &t : texs)
+  {
+    t = in.point();
+  }
+}
+
+void LCommandWriter::reset()
+{
+  words.clear();
+  current = GPaint();
+}
+
+void LCommandWriter::save()
+{
+  put(kCmdSave);
+}
+
+void LCommandWriter::restore()
+{
+  put(kCmdRestore);
+}
+
+void LCommandWriter::concat(const GMatrix &matrix)
+{
+  put(kCmdConcat);
+  putMatrix(matrix);
+}
+
+void LCommandWriter::clipRect(const GRect &rect)
+{
+  put(kCmdClipRect);
+  putRect(rect);
+}
+
+void LCommandWriter::clipPath(const GPath &path)
+{
+  setPath(path);
+  put(kCmdClipPath);
+}
+
+void LCommandWriter::drawPaint(const GPaint &paint)
+{
+  setPaint(paint);
+  put(kCmdDrawPaint);
+}
+
+void LCommandWriter::drawRect(const GRect &rect, const GPaint &paint)
+{
+  setPaint(paint);
+  put(kCmdDrawRect);
+  putRect(rect);
+}
+
+void LCommandWriter::drawConvexPolygon(const GPoint points[], int count, const GPaint &paint)
+{
+  putPointList(kCmdDrawConvexPolygon, points, count, paint);
+}
+
+void LCommandWriter::drawPath(const GPath &path, const GPaint &paint)
+{
+  setPaint(paint);
+  setPath(path);
+  put(kCmdDrawPath);
+}
+
+void LCommandWriter::drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint &paint)
+{
+  int vertices = count > 0 ? *std::max_element(indices, indices + 3 * count) + 1 : 0;
+  setPaint(paint);
+  put(kCmdDrawMesh);
+  put((uint32_t)count);
+  put((uint32_t)vertices);
+  put((colors ? kHasColors : 0) | (texs ? kHasTexs : 0));
+  putPoints(verts, vertices);
+  if (colors)
+    putColors(colors, vertices);
+  if (texs)
+    putPoints(texs, vertices);
+  for (int i = 0; i < 3 * count; ++i)
+  {
+    put((uint32_t)indices[i]);
+  }
+}
+
+void LCommandWriter::drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint &paint)
+{
+  setPaint(paint);
+  put(kCmdDrawQuad);
+  put((uint32_t)level);
+  put((colors ? kHasColors : 0) | (texs ? kHasTexs : 0));
+  putPoints(verts, 4);
+  if (colors)
+    putColors(colors, 4);
+  if (texs)
+    putPoints(texs, 4);
+}
+
+void LCommandWriter::drawPathInstances(const GPath &path, const GMatrix matrices[], const GColor colors[], int count, const GPaint &paint)
+{
+  setPaint(paint);
+  setPath(path);
+  put(kCmdDrawPathInstances);
+  put((uint32_t)std::max(count, 0));
+  put(colors ? kHasColors : 0);
+  for (int i = 0; i < count; ++i)
+  {
+    putMatrix(matrices[i]);
+  }
+  if (colors)
+    putColors(colors, count);
+}
+
+void LCommandWriter::drawLines(const GPoint points[], int count, const GPaint &paint)
+{
+  putPointList(kCmdDrawLines, points, count, paint);
+}
+
+void LCommandWriter::drawPolyline(const GPoint points[], int count, const GPaint &paint)
+{
+  putPointList(kCmdDrawPolyline, points, count, paint);
+}
+
+void LCommandWriter::putRect(const GRect &rect)
+{
+  put(rect.left());
+  put(rect.top());
+  put(rect.right());
+  put(rect.bottom());
+}
+
+void LCommandWriter::putPoints(const GPoint points[], int count)
+{
+  for (int i = 0; i < count; ++i)
+  {
+    put(points[i].x());
+    put(points[i].y());
+  }
+}
+
+void LCommandWriter::putColors(const GColor colors[], int count)
+{
+  for (int i = 0; i < count; ++i)
+  {
+    put(colors[i].r);
+    put(colors[i].g);
+    put(colors[i].b);
+    put(colors[i].a);
+  }
+}
+
+void LCommandWriter::putMatrix(const GMatrix &matrix)
+{
+  for (int i : {GMatrix::SX, GMatrix::KX, GMatrix::TX, GMatrix::KY, GMatrix::SY, GMatrix::TY})
+  {
+    put(matrix[i]);
+  }
+}
+
+void LCommandWriter::putPointList(LCommand op, const GPoint points[], int count, const GPaint &paint)
+{
+  setPaint(paint);
+  put(op);
+  put((uint32_t)count);
+  putPoints(points, count);
+}
+
+// Only what differs from the paint the runner already has is written.
+void LCommandWriter::setPaint(const GPaint &paint)
+{
+  if (paint.getColor() != current.getColor())
+  {
+    put(kCmdSetColor);
+    putColors(&paint.getColor(), 1);
+  }
+  if (paint.getBlendMode() != current.getBlendMode())
+  {
+    put(kCmdSetBlendMode);
+    put((uint32_t)paint.getBlendMode());
+  }
+  if (paint.getShader() != current.getShader())
+  {
+    uint32_t index = kNoShader;
+    if (paint.getShader())
+    {
+      auto found = std::find(shaders.begin(), shaders.end(), paint.getShader());
+      index = found - shaders.begin();
+      if (found == shaders.end())
+        shaders.push_back(paint.getShader());
+    }
+    put(kCmdSetShader);
+    put(index);
+  }
+  current = paint;
+}
+
+void LCommandWriter::setPath(const GPath &path)
+{
+  put(kCmdPathReset);
+  GPath::Iter iter(path);
+  GPoint pts[GPath::kMaxNextPoints];
+  GPath::Verb verb;
+  while ((verb = iter.next(pts)) != GPath::kDone)
+  {
+    switch (verb)
+    {
+    case GPath::kMove:
+      put(kCmdMoveTo);
+      putPoints(pts, 1);
+      break;
+    case GPath::kLine:
+      put(kCmdLineTo);
+      putPoints(pts + 1, 1);
+      break;
+    case GPath::kQuad:
+      put(kCmdQuadTo);
+      putPoints(pts + 1, 2);
+      break;
+    case GPath::kCubic:
+      put(kCmdCubicTo);
+      putPoints(pts + 1, 3);
+      break;
+    default:
+      break;
+    }
+  }
+}
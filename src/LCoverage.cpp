@@ -0,0 +1,32 @@
+#include "LCoverage.h"
+#include "LCanvas.h"
+
+void LDrawFrontToBack(const LPicture &picture, LCanvas *canvas, LCoverage *coverage, int height)
+{
+  coverage->reset(height);
+  {
+    LPlayer player(canvas);
+    for (int i = (int)picture.ops.size() - 1; i >= 0; --i)
+    {
+      const LOp &op = picture.ops[i];
+      if (LOverwrites(op))
+      {
+        canvas->setCoverage(coverage, i, true);
+        player.draw(op);
+      }
+    }
+  }
+  {
+    LPlayer player(canvas);
+    for (int i = 0; i < (int)picture.ops.size(); ++i)
+    {
+      const LOp &op = picture.ops[i];
+      if (!LOverwrites(op))
+      {
+        canvas->setCoverage(coverage, i, false);
+        player.draw(op);
+      }
+    }
+  }
+  canvas->setCoverage(nullptr, 0, false);
+}
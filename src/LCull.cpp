@@ -0,0 +1,86 @@
+#include "LCull.h"
+#include "LPainter.h"
+
+// Only the largest few occluders are kept; most frames are covered by one or two big fills.
+static const int kMaxOccluders = 8;
+
+static long long area(const GIRect &r)
+{
+  return (long long)r.width() * r.height();
+}
+
+static void addOccluder(std::vector<GIRect> &occluders, const GIRect &rect)
+{
+  for (size_t i = 0; i < occluders.size();)
+  {
+    if (occluders[i].contains(rect))
+    {
+      return;
+    }
+    if (rect.contains(occluders[i]))
+    {
+      occluders.erase(occluders.begin() + i);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+  occluders.push_back(rect);
+  if ((int)occluders.size() > kMaxOccluders)
+  {
+    auto smallest = std::min_element(occluders.begin(), occluders.end(), [](const GIRect &a, const GIRect &b)
+                                     { return area(a) < area(b); });
+    occluders.erase(smallest);
+  }
+}
+
+LCullStats LCullOccluded(LPicture *picture, const GIRect &device)
+{
+  LCullStats stats;
+  std::vector<GIRect> occluders;
+  std::vector<LOp> &ops = picture->ops;
+  std::vector<bool> keep(ops.size(), true);
+
+  for (int i = (int)ops.size() - 1; i >= 0; --i)
+  {
+    const LOp &op = ops[i];
+    GIRect bounds = op.bounds;
+    bool visible = bounds.intersect(device) && !LDrawsNothing(op);
+    for (size_t j = 0; visible && j < occluders.size(); ++j)
+    {
+      visible = !occluders[j].contains(bounds);
+    }
+    if (!visible)
+    {
+      keep[i] = false;
+      stats.opsCulled += 1;
+      stats.pixelsCulled += op.bounds.intersects(device) ? area(bounds) : 0;
+      continue;
+    }
+
+    GIRect covered;
+    if (LOverwrites(op) && LCoveredRect(op, &covered) && covered.intersect(device))
+    {
+      addOccluder(occluders, covered);
+    }
+  }
+
+  if (stats.opsCulled > 0)
+  {
+    size_t kept = 0;
+    for (size_t i = 0; i < ops.size(); ++i)
+    {
+      if (keep[i])
+      {
+        if (kept != i)
+        {
+          ops[kept] = ops[i];
+        }
+        ++kept;
+      }
+    }
+    ops.erase(ops.begin() + kept, ops.end());
+  }
+  return stats;
+}
@@ -0,0 +1,223 @@
+#include "LDamage.h"
+#include <algorithm>
+
+// Past this many rects the bookkeeping costs more than redrawing their union.
+static const int kMaxDamageRects = 32;
+
+static bool sameMatrix(const GMatrix &a, const GMatrix &b)
+{
+  for (int i = 0; i < 6; ++i)
+  {
+    if (a[i] != b[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool samePaint(const GPaint &a, const GPaint &b)
+{
+  return a.getColor() == b.getColor() && a.getShader() == b.getShader() && a.getBlendMode() == b.getBlendMode();
+}
+
+static bool samePath(const GPath &a, const GPath &b)
+{
+  if (a.countPoints() != b.countPoints())
+  {
+    return false;
+  }
+  GPath::Iter iterA(a);
+  GPath::Iter iterB(b);
+  GPoint ptsA[GPath::kMaxNextPoints];
+  GPoint ptsB[GPath::kMaxNextPoints];
+  while (true)
+  {
+    GPath::Verb verb = iterA.next(ptsA);
+    if (verb != iterB.next(ptsB))
+    {
+      return false;
+    }
+    if (verb == GPath::kDone)
+    {
+      return true;
+    }
+    // Iter repeats the previous point as pts[0], so only the new points need comparing.
+    int first = verb == GPath::kMove ? 0 : 1;
+    int last = verb == GPath::kMove ? 0 : (int)verb;
+    for (int i = first; i <= last; ++i)
+    {
+      if (ptsA[i] != ptsB[i])
+      {
+        return false;
+      }
+    }
+  }
+}
+
+static bool sameClip(const LClipOp *a, const LClipOp *b)
+{
+  if (a == b)
+  {
+    return true;
+  }
+  if (!a || !b || a->isRect != b->isRect)
+  {
+    return false;
+  }
+  if (a->isRect ? a->rect != b->rect : !samePath(a->path, b->path))
+  {
+    return false;
+  }
+  return sameClip(a->parent.get(), b->parent.get());
+}
+
+static GIRect unite(const GIRect &a, const GIRect &b)
+{
+  return GIRect::MakeLTRB(std::min(a.left(), b.left()), std::min(a.top(), b.top()),
+                          std::max(a.right(), b.right()), std::max(a.bottom(), b.bottom()));
+}
+
+static long long area(const GIRect &r)
+{
+  return (long long)r.width() * r.height();
+}
+
+bool LSameOp(const LOp &a, const LOp &b)
+{
+  if (a.type != b.type || a.count != b.count || !sameMatrix(a.ctm, b.ctm) || !samePaint(a.paint, b.paint) ||
+      !sameClip(a.clip.get(), b.clip.get()))
+  {
+    return false;
+  }
+  switch (a.type)
+  {
+  case LOp::kPaint:
+    return true;
+  case LOp::kRect:
+    return a.rect == b.rect;
+  case LOp::kPath:
+    return samePath(a.path, b.path);
+  case LOp::kPathInstances:
+    return samePath(a.path, b.path) && a.colors == b.colors && a.matrices.size() == b.matrices.size() &&
+           std::equal(a.matrices.begin(), a.matrices.end(), b.matrices.begin(), sameMatrix);
+  default:
+    return a.verts == b.verts && a.colors == b.colors && a.texs == b.texs && a.indices == b.indices;
+  }
+}
+
+void LIncrementalRenderer::addDamage(GIRect rect)
+{
+  if (!rect.intersect(GIRect::MakeWH(fDevice.width(), fDevice.height())))
+  {
+    return;
+  }
+  // Fold the new rect into any rect it touches, repeating as the result grows.
+  for (size_t i = 0; i < rects.size();)
+  {
+    const GIRect &other = rects[i];
+    if (rect.left() <= other.right() && other.left() <= rect.right() && rect.top() <= other.bottom() && other.top() <= rect.bottom())
+    {
+      rect = unite(rect, other);
+      rects.erase(rects.begin() + i);
+      i = 0;
+    }
+    else
+    {
+      ++i;
+    }
+  }
+  rects.push_back(rect);
+  if ((int)rects.size() > kMaxDamageRects)
+  {
+    // Merge the pair whose union adds the fewest extra pixels.
+    size_t bestI = 0;
+    size_t bestJ = 1;
+    long long bestCost = -1;
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+      for (size_t j = i + 1; j < rects.size(); ++j)
+      {
+        long long cost = area(unite(rects[i], rects[j])) - area(rects[i]) - area(rects[j]);
+        if (bestCost < 0 || cost < bestCost)
+        {
+          bestCost = cost;
+          bestI = i;
+          bestJ = j;
+        }
+      }
+    }
+    GIRect merged = unite(rects[bestI], rects[bestJ]);
+    rects.erase(rects.begin() + bestJ);
+    rects.erase(rects.begin() + bestI);
+    addDamage(merged);
+  }
+}
+
+const std::vector<GIRect> &LIncrementalRenderer::render(const LPicture &frame)
+{
+  rects.clear();
+  const GIRect device = GIRect::MakeWH(fDevice.width(), fDevice.height());
+  // A clipped drawPaint only repaints part of the device, so the frame still depends on what
+  // was there before.
+  bool selfContained = !frame.ops.empty() && frame.ops[0].type == LOp::kPaint && !frame.ops[0].clip &&
+                       LOverwrites(frame.ops[0]);
+
+  if (!valid || !selfContained)
+  {
+    addDamage(device);
+  }
+  else
+  {
+    const std::vector<LOp> &oldOps = previous.ops;
+    const std::vector<LOp> &newOps = frame.ops;
+    size_t prefix = 0;
+    while (prefix < oldOps.size() && prefix < newOps.size() && LSameOp(oldOps[prefix], newOps[prefix]))
+    {
+      ++prefix;
+    }
+    size_t suffix = 0;
+    while (suffix < oldOps.size() - prefix && suffix < newOps.size() - prefix &&
+           LSameOp(oldOps[oldOps.size() - 1 - suffix], newOps[newOps.size() - 1 - suffix]))
+    {
+      ++suffix;
+    }
+    size_t oldEnd = oldOps.size() - suffix;
+    size_t newEnd = newOps.size() - suffix;
+
+    if (oldEnd - prefix == newEnd - prefix)
+    {
+      // Same shape of frame: only the pairs that differ are damaged.
+      for (size_t i = prefix; i < oldEnd; ++i)
+      {
+        if (!LSameOp(oldOps[i], newOps[i]))
+        {
+          addDamage(oldOps[i].bounds);
+          addDamage(newOps[i].bounds);
+        }
+      }
+    }
+    else
+    {
+      for (size_t i = prefix; i < oldEnd; ++i)
+      {
+        addDamage(oldOps[i].bounds);
+      }
+      for (size_t i = prefix; i < newEnd; ++i)
+      {
+        addDamage(newOps[i].bounds);
+      }
+    }
+  }
+
+  for (const GIRect &rect : rects)
+  {
+    canvas->setBounds(rect);
+    frame.playback(canvas.get(), rect);
+  }
+  canvas->setBounds(device);
+
+  previous = frame;
+  valid = selfContained;
+  return rects;
+}
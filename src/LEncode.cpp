@@ -0,0 +1,773 @@
+#include "LEncode.h"
+#include "LSimd.h"
+#include "LTrace.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+const uint32_t kUnpremulScale[256] = {
+  0, 16777216, 8388608, 5592406, 4194304, 3355444, 2796203, 2396746,
+  2097152, 1864136, 1677722, 1525202, 1398102, 1290556, 1198373, 1118482,
+  1048576, 986896, 932068, 883012, 838861, 798916, 762601, 729445,
+  699051, 671089, 645278, 621379, 599187, 578525, 559241, 541201,
+  524288, 508401, 493448, 479350, 466034, 453439, 441506, 430186,
+  419431, 409201, 399458, 390168, 381301, 372828, 364723, 356963,
+  349526, 342393, 335545, 328966, 322639, 316552, 310690, 305041,
+  299594, 294338, 289263, 284360, 279621, 275037, 270601, 266306,
+  262144, 258112, 254201, 250407, 246724, 243149, 239675, 236299,
+  233017, 229825, 226720, 223697, 220753, 217886, 215093, 212370,
+  209716, 207127, 204601, 202136, 199729, 197380, 195084, 192842,
+  190651, 188509, 186414, 184366, 182362, 180401, 178482, 176603,
+  174763, 172961, 171197, 169467, 167773, 166112, 164483, 162886,
+  161320, 159784, 158276, 156797, 155345, 153920, 152521, 151147,
+  149797, 148471, 147169, 145889, 144632, 143396, 142180, 140986,
+  139811, 138655, 137519, 136401, 135301, 134218, 133153, 132105,
+  131072, 130056, 129056, 128071, 127101, 126145, 125204, 124276,
+  123362, 122462, 121575, 120700, 119838, 118988, 118150, 117324,
+  116509, 115705, 114913, 114131, 113360, 112599, 111849, 111108,
+  110377, 109656, 108943, 108241, 107547, 106862, 106185, 105518,
+  104858, 104207, 103564, 102928, 102301, 101681, 101068, 100463,
+  99865, 99274, 98690, 98113, 97542, 96979, 96421, 95870,
+  95326, 94787, 94255, 93728, 93207, 92692, 92183, 91679,
+  91181, 90688, 90201, 89718, 89241, 88769, 88302, 87839,
+  87382, 86929, 86481, 86038, 85599, 85164, 84734, 84308,
+  83887, 83469, 83056, 82647, 82242, 81841, 81443, 81050,
+  80660, 80274, 79892, 79513, 79138, 78767, 78399, 78034,
+  77673, 77315, 76960, 76609, 76261, 75916, 75574, 75235,
+  74899, 74566, 74236, 73909, 73585, 73263, 72945, 72629,
+  72316, 72006, 71698, 71393, 71090, 70790, 70493, 70198,
+  69906, 69616, 69328, 69043, 68760, 68479, 68201, 67924,
+  67651, 67379, 67109, 66842, 66577, 66314, 66053, 65794,
+};
+
+void LUnpremulToRGBA(const GPixel src[], int width, uint8_t dst[])
+{
+  int i = 0;
+#if LSIMD
+  for (; i + 4 <= width; i += 4)
+  {
+    LU32x4 c = LLoadU32x4(src + i);
+    auto opaque = c >= 0xFF000000;
+    // Premultiplied pixels with no alpha are all zero, as is their unpremultiplied RGBA.
+    auto clear = c < 0x01000000;
+    // ARGB words to RGBA bytes.
+    LU32x4 swizzled = ((c >> 16) & 0xFF) | (c & 0xFF00FF00) | ((c & 0xFF) << 16);
+    auto easy = opaque | clear;
+    if (easy[0] & easy[1] & easy[2] & easy[3])
+    {
+      swizzled &= (LU32x4)opaque;
+    }
+    else
+    {
+      LU32x4 a = c >> 24;
+      LU32x4 scale = {kUnpremulScale[a[0]], kUnpremulScale[a[1]], kUnpremulScale[a[2]], kUnpremulScale[a[3]]};
+      LU32x4 half = a >> 1;
+      auto unpremul = [&](LU32x4 v)
+      {
+        v = v < a ? v : a;
+        return ((v * 255 + half) * scale) >> 24;
+      };
+      swizzled = unpremul(swizzled & 0xFF) | (unpremul((swizzled >> 8) & 0xFF) << 8) |
+                 (unpremul((swizzled >> 16) & 0xFF) << 16) | (a << 24);
+    }
+    LStoreU32x4((uint32_t *)(dst + i * 4), swizzled);
+  }
+#endif
+  for (; i < width; ++i)
+  {
+    GPixel c = src[i];
+    unsigned a = GPixel_GetA(c);
+    dst[i * 4 + 0] = LUnpremul(GPixel_GetR(c), a);
+    dst[i * 4 + 1] = LUnpremul(GPixel_GetG(c), a);
+    dst[i * 4 + 2] = LUnpremul(GPixel_GetB(c), a);
+    dst[i * 4 + 3] = a;
+  }
+}
+
+void LImageEncoder::writeRows(const GBitmap &bitmap)
+{
+  assert(bitmap.width() == fWidth);
+  int count = std::min(bitmap.height(), fHeight - rows);
+  for (int y = 0; y < count; ++y)
+  {
+    encodeRow(bitmap.getAddr(0, y));
+  }
+  rows += std::max(count, 0);
+}
+
+bool LImageEncoder::finish()
+{
+  if (rows < fHeight || finished)
+    return false;
+  finished = true;
+  encodeEnd();
+  return true;
+}
+
+static void putBE32(std::vector<uint8_t> &out, uint32_t v)
+{
+  uint8_t bytes[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+  out.insert(out.end(), bytes, bytes + 4);
+}
+
+static std::vector<uint8_t> headerBytes(const char *text)
+{
+  return std::vector<uint8_t>(text, text + strlen(text));
+}
+
+// ---------------------------------------------------------------------------------------------
+// PPM / PAM
+
+class LNetpbmEncoder : public LImageEncoder
+{
+public:
+  LNetpbmEncoder(int width, int height, const Sink &sink, bool alpha) : LImageEncoder(width, height, sink), alpha(alpha), out(width * (alpha ? 4 : 3))
+  {
+    char header[128];
+    if (alpha)
+      snprintf(header, sizeof(header), "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", width, height);
+    else
+      snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    put(headerBytes(header));
+  }
+
+  void encodeRow(const GPixel row[]) override
+  {
+    if (alpha)
+    {
+      LUnpremulToRGBA(row, fWidth, out.data());
+    }
+    else
+    {
+      for (int x = 0; x < fWidth; ++x)
+      {
+        out[x * 3 + 0] = GPixel_GetR(row[x]);
+        out[x * 3 + 1] = GPixel_GetG(row[x]);
+        out[x * 3 + 2] = GPixel_GetB(row[x]);
+      }
+    }
+    put(out);
+  }
+
+  void encodeEnd() override {}
+
+private:
+  const bool alpha;
+  std::vector<uint8_t> out;
+};
+
+// ---------------------------------------------------------------------------------------------
+// QOI, following the specification at qoiformat.org. The encoder state (previous pixel, index,
+// pending run) carries from row to row, as the format sees one stream of pixels.
+
+class LQOIEncoder : public LImageEncoder
+{
+public:
+  LQOIEncoder(int width, int height, const Sink &sink) : LImageEncoder(width, height, sink), rgba(width * 4)
+  {
+    std::vector<uint8_t> header = headerBytes("qoif");
+    putBE32(header, width);
+    putBE32(header, height);
+    header.push_back(4); // RGBA
+    header.push_back(0); // sRGB with linear alpha
+    put(header);
+    out.reserve(width * 5 + 1);
+    const uint8_t black[4] = {0, 0, 0, 255};
+    memcpy(&prev, black, 4);
+  }
+
+  void encodeRow(const GPixel row[]) override
+  {
+    LUnpremulToRGBA(row, fWidth, rgba.data());
+    out.clear();
+    for (int x = 0; x < fWidth; ++x)
+    {
+      uint32_t px;
+      memcpy(&px, &rgba[x * 4], 4);
+      if (px == prev)
+      {
+        if (++run == 62)
+          flushRun();
+        continue;
+      }
+      flushRun();
+      const uint8_t *p = &rgba[x * 4];
+      int slot = (p[0] * 3 + p[1] * 5 + p[2] * 7 + p[3] * 11) % 64;
+      if (index[slot] == px)
+      {
+        out.push_back(0x00 | slot);
+      }
+      else
+      {
+        index[slot] = px;
+        const uint8_t *q = (const uint8_t *)&prev;
+        if (p[3] == q[3])
+        {
+          int dr = (int8_t)(p[0] - q[0]);
+          int dg = (int8_t)(p[1] - q[1]);
+          int db = (int8_t)(p[2] - q[2]);
+          int drg = dr - dg;
+          int dbg = db - dg;
+          if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+          {
+            out.push_back(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+          }
+          else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7)
+          {
+            out.push_back(0x80 | (dg + 32));
+            out.push_back((drg + 8) << 4 | (dbg + 8));
+          }
+          else
+          {
+            out.insert(out.end(), {0xFE, p[0], p[1], p[2]});
+          }
+        }
+        else
+        {
+          out.insert(out.end(), {0xFF, p[0], p[1], p[2], p[3]});
+        }
+      }
+      prev = px;
+    }
+    put(out);
+  }
+
+  void encodeEnd() override
+  {
+    out.clear();
+    flushRun();
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    put(out);
+  }
+
+private:
+  std::vector<uint8_t> rgba;
+  std::vector<uint8_t> out;
+  uint32_t index[64] = {};
+  // Pixels as their four RGBA bytes in memory order.
+  uint32_t prev;
+  int run = 0;
+
+  void flushRun()
+  {
+    if (run > 0)
+    {
+      out.push_back(0xC0 | (run - 1));
+      run = 0;
+    }
+  }
+};
+
+// ---------------------------------------------------------------------------------------------
+// PNG: 8-bit RGBA, one zlib stream split over IDAT chunks as it grows.
+
+// CRC-32 tables for slicing by 16: entries[k][n] is the CRC of byte n followed by k zero
+// bytes.
+static const uint32_t (*crcTables())[256]
+{
+  static const struct Tables
+  {
+    uint32_t entries[16][256];
+    Tables()
+    {
+      for (uint32_t n = 0; n < 256; ++n)
+      {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k)
+        {
+          c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        entries[0][n] = c;
+      }
+      for (int k = 1; k < 16; ++k)
+      {
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+          uint32_t c = entries[k - 1][n];
+          entries[k][n] = entries[0][c & 0xFF] ^ (c >> 8);
+        }
+      }
+    }
+  } tables;
+  return tables.entries;
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *bytes, size_t size)
+{
+  const uint32_t(*t)[256] = crcTables();
+  crc = ~crc;
+  for (; size >= 16; size -= 16, bytes += 16)
+  {
+    uint32_t lo = (bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24) ^ crc;
+    crc = t[15][lo & 0xFF] ^ t[14][(lo >> 8) & 0xFF] ^ t[13][(lo >> 16) & 0xFF] ^ t[12][lo >> 24] ^
+          t[11][bytes[4]] ^ t[10][bytes[5]] ^ t[9][bytes[6]] ^ t[8][bytes[7]] ^
+          t[7][bytes[8]] ^ t[6][bytes[9]] ^ t[5][bytes[10]] ^ t[4][bytes[11]] ^
+          t[3][bytes[12]] ^ t[2][bytes[13]] ^ t[1][bytes[14]] ^ t[0][bytes[15]];
+  }
+  for (; size > 0; --size, ++bytes)
+  {
+    crc = t[0][(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+class LAdler32
+{
+public:
+  void update(const uint8_t *bytes, size_t size)
+  {
+    while (size > 0)
+    {
+      // The most bytes s2 can take before it has to be reduced.
+      size_t n = std::min(size, (size_t)5552);
+      size_t i = 0;
+#if LSIMD
+      // Sixteen bytes at a time in sixteen lanes, one per byte position: sums holds each
+      // position's total and prior the running total before each step, so s2's share is
+      // worked out once per block from the two.
+      LU32x4 sums[4] = {};
+      LU32x4 prior = {};
+      for (; i + 16 <= n; i += 16)
+      {
+        LU32x4 words = LLoadU32x4((const uint32_t *)(bytes + i));
+        prior += sums[0] + sums[1] + sums[2] + sums[3];
+        sums[0] += words & 0xFF;
+        sums[1] += (words >> 8) & 0xFF;
+        sums[2] += (words >> 16) & 0xFF;
+        sums[3] += words >> 24;
+      }
+      if (i > 0)
+      {
+        // Byte b of word l is at position 4 * l + b and is summed into s2 16 - that many times
+        // per step.
+        uint64_t total = 0;
+        uint64_t weighted = 0;
+        uint64_t before = 0;
+        for (int l = 0; l < 4; ++l)
+        {
+          before += prior[l];
+          for (int b = 0; b < 4; ++b)
+          {
+            total += sums[b][l];
+            weighted += (uint64_t)(16 - 4 * l - b) * sums[b][l];
+          }
+        }
+        s2 = (uint32_t)((s2 + (uint64_t)i * s1 + 16 * before + weighted) % 65521);
+        s1 += (uint32_t)total;
+      }
+#endif
+      // Sixteen bytes at a time: s1 gains their sum and s2 gains s1 sixteen times over plus
+      // each byte weighted by how many of the sixteen steps it is summed into.
+      for (; i + 16 <= n; i += 16)
+      {
+        uint32_t sum = 0;
+        uint32_t weighted = 0;
+        for (int k = 0; k < 16; ++k)
+        {
+          sum += bytes[i + k];
+          weighted += (16 - k) * bytes[i + k];
+        }
+        s2 += 16 * s1 + weighted;
+        s1 += sum;
+      }
+      for (; i < n; ++i)
+      {
+        s1 += bytes[i];
+        s2 += s1;
+      }
+      s1 %= 65521;
+      s2 %= 65521;
+      bytes += n;
+      size -= n;
+    }
+  }
+
+  uint32_t value() const { return s2 << 16 | s1; }
+
+private:
+  uint32_t s1 = 1;
+  uint32_t s2 = 0;
+};
+
+// Deflate bits, least significant first. Huffman codes go in already bit-reversed.
+class LBitWriter
+{
+public:
+  explicit LBitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+  void put(uint32_t value, int count)
+  {
+    bits |= (uint64_t)value << used;
+    used += count;
+    if (used >= 32)
+    {
+      uint8_t bytes[4] = {(uint8_t)bits, (uint8_t)(bits >> 8), (uint8_t)(bits >> 16), (uint8_t)(bits >> 24)};
+      out.insert(out.end(), bytes, bytes + 4);
+      bits >>= 32;
+      used -= 32;
+    }
+  }
+
+  // Pad to a byte boundary and write out everything pending.
+  void flush()
+  {
+    for (; used > 0; used -= 8)
+    {
+      out.push_back((uint8_t)bits);
+      bits >>= 8;
+    }
+    used = 0;
+    bits = 0;
+  }
+
+private:
+  std::vector<uint8_t> &out;
+  uint64_t bits = 0;
+  int used = 0;
+};
+
+// The fixed Huffman codes of RFC 1951 3.2.6, with the length and distance symbols' extra bits
+// folded in where it saves work per symbol.
+struct LFixedCodes
+{
+  uint16_t literal[288]; // reversed code
+  uint8_t literalBits[288];
+  // For match lengths 3..258: the length symbol's code followed by its extra bits.
+  uint32_t length[259];
+  uint8_t lengthBits[259];
+  uint8_t distSmall[256]; // distance symbol for distances 1..256, by distance - 1
+  uint8_t distLarge[256]; // and for 257..32768, by (distance - 1) >> 7
+  uint8_t distCode[30];   // each distance symbol's reversed 5-bit code
+
+  static const uint16_t kLengthBase[29];
+  static const uint8_t kLengthExtra[29];
+  static const uint16_t kDistBase[30];
+  static const uint8_t kDistExtra[30];
+
+  static uint32_t reverse(uint32_t code, int bits)
+  {
+    uint32_t r = 0;
+    for (int i = 0; i < bits; ++i, code >>= 1)
+    {
+      r = r << 1 | (code & 1);
+    }
+    return r;
+  }
+
+  LFixedCodes()
+  {
+    for (int v = 0; v < 288; ++v)
+    {
+      uint32_t code;
+      int bits;
+      if (v < 144)
+        code = 0x30 + v, bits = 8;
+      else if (v < 256)
+        code = 0x190 + v - 144, bits = 9;
+      else if (v < 280)
+        code = v - 256, bits = 7;
+      else
+        code = 0xC0 + v - 280, bits = 8;
+      literal[v] = reverse(code, bits);
+      literalBits[v] = bits;
+    }
+    for (int s = 0; s < 29; ++s)
+    {
+      // Symbol 27's extra bits could reach 258, but 258 has a symbol of its own.
+      int end = s == 28 ? 259 : kLengthBase[s + 1];
+      for (int len = kLengthBase[s]; len < end; ++len)
+      {
+        length[len] = literal[257 + s] | (len - kLengthBase[s]) << literalBits[257 + s];
+        lengthBits[len] = literalBits[257 + s] + kLengthExtra[s];
+      }
+    }
+    for (int s = 0; s < 30; ++s)
+    {
+      distCode[s] = reverse(s, 5);
+      int end = s == 29 ? 32769 : kDistBase[s + 1];
+      for (int d = kDistBase[s]; d < end; ++d)
+      {
+        if (d <= 256)
+          distSmall[d - 1] = s;
+        else
+          distLarge[(d - 1) >> 7] = s;
+      }
+    }
+  }
+
+  void putLiteral(LBitWriter &out, int v) const { out.put(literal[v], literalBits[v]); }
+
+  void putMatch(LBitWriter &out, int len, int dist) const
+  {
+    out.put(length[len], lengthBits[len]);
+    int s = dist <= 256 ? distSmall[dist - 1] : distLarge[(dist - 1) >> 7];
+    out.put(distCode[s] | (dist - kDistBase[s]) << 5, 5 + kDistExtra[s]);
+  }
+};
+
+const uint16_t LFixedCodes::kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LFixedCodes::kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                               3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t LFixedCodes::kDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                              193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                              6145, 8193, 12289, 16385, 24577};
+const uint8_t LFixedCodes::kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                             6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static const LFixedCodes &fixedCodes()
+{
+  static const LFixedCodes codes;
+  return codes;
+}
+
+class LPNGEncoder : public LImageEncoder
+{
+public:
+  LPNGEncoder(int width, int height, const Sink &sink, bool compress)
+      : LImageEncoder(width, height, sink), compress(compress), bits(idat)
+  {
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    put(kSignature, 8);
+    std::vector<uint8_t> ihdr;
+    putBE32(ihdr, width);
+    putBE32(ihdr, height);
+    ihdr.insert(ihdr.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA, deflate, adaptive filters, no interlace
+    putChunk("IHDR", ihdr);
+
+    // zlib header: deflate with a 32KB window, no preset dictionary.
+    idat.insert(idat.end(), {0x78, 0x01});
+    if (compress)
+    {
+      head.assign(1 << kHashBits, -1);
+      // One fixed-Huffman block for the whole stream, closed in encodeEnd().
+      bits.put(0 | 1 << 1, 3);
+    }
+  }
+
+  void encodeRow(const GPixel row[]) override
+  {
+    // Unpremultiplied straight into the window, after the filter type byte.
+    const size_t rowBytes = (size_t)fWidth * 4 + 1;
+    const size_t start = window.size();
+    window.resize(start + rowBytes);
+    uint8_t *filtered = &window[start];
+    LUnpremulToRGBA(row, fWidth, filtered + 1);
+    if (compress)
+    {
+      filtered[0] = 1; // Sub
+      subFilter(filtered + 1, fWidth * 4);
+    }
+    else
+    {
+      filtered[0] = 0; // None
+    }
+    adler.update(filtered, rowBytes);
+
+    if (compress)
+    {
+      deflateFrom(start);
+      slide();
+    }
+    else
+    {
+      storeBlocks(false);
+    }
+    if (idat.size() >= kChunkBytes)
+    {
+      putChunk("IDAT", idat);
+      idat.clear();
+    }
+  }
+
+  void encodeEnd() override
+  {
+    if (compress)
+    {
+      fixedCodes().putLiteral(bits, 256);
+      // An empty final stored block ends the stream without knowing in advance which block
+      // would be the last.
+      bits.put(1, 3);
+      bits.flush();
+      idat.insert(idat.end(), {0, 0, 0xFF, 0xFF});
+    }
+    else
+    {
+      storeBlocks(true);
+    }
+    putBE32(idat, adler.value());
+    putChunk("IDAT", idat);
+    putChunk("IEND", {});
+  }
+
+private:
+  static const int kHashBits = 14;
+  static const int kWindow = 32768;
+  static const size_t kChunkBytes = 1 << 16;
+
+  const bool compress;
+  // Filtered bytes not yet stored, or for kPNGFast the deflate window followed by the bytes of
+  // the row being compressed.
+  std::vector<uint8_t> window;
+  // Position in window of the last 4 bytes seen with each hash, or -1.
+  std::vector<int> head;
+  std::vector<uint8_t> idat;
+  LBitWriter bits;
+  LAdler32 adler;
+
+  // Each byte less the one a pixel to its left, so flat color becomes runs of zeros. Done in
+  // place from the right, so every byte is read before it is overwritten.
+  static void subFilter(uint8_t *row, int size)
+  {
+    int i = size;
+#if LSIMD
+    for (; i - 16 >= 4; i -= 16)
+    {
+      LStoreU8x16(row + i - 16, LLoadU8x16(row + i - 16) - LLoadU8x16(row + i - 20));
+    }
+#endif
+    for (; i > 4; --i)
+    {
+      row[i - 1] -= row[i - 5];
+    }
+  }
+
+  static uint32_t load32(const uint8_t *p)
+  {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+  }
+
+  static uint64_t load64(const uint8_t *p)
+  {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+  }
+
+  // Compress window[from, end) against the window behind it: a match is taken whenever the
+  // last position with the same 4-byte hash really matches, as zlib's fastest level does.
+  void deflateFrom(size_t from)
+  {
+    const LFixedCodes &codes = fixedCodes();
+    const uint8_t *data = window.data();
+    const int end = (int)window.size();
+    int p = (int)from;
+    while (p + 4 <= end)
+    {
+      uint32_t word = load32(data + p);
+      uint32_t hash = (word * 2654435761u) >> (32 - kHashBits);
+      int candidate = head[hash];
+      head[hash] = p;
+      if (candidate >= 0 && p - candidate <= kWindow && load32(data + candidate) == word)
+      {
+        int len = 4;
+        const int most = std::min(258, end - p);
+        // Eight bytes at a time, then the rest one by one.
+        while (len + 8 <= most && load64(data + candidate + len) == load64(data + p + len))
+        {
+          len += 8;
+        }
+        while (len < most && data[candidate + len] == data[p + len])
+        {
+          ++len;
+        }
+        codes.putMatch(bits, len, p - candidate);
+        p += len;
+      }
+      else
+      {
+        codes.putLiteral(bits, data[p]);
+        ++p;
+      }
+    }
+    for (; p < end; ++p)
+    {
+      codes.putLiteral(bits, data[p]);
+    }
+  }
+
+  // Drop all but the last kWindow bytes once enough have built up that moving them is cheap.
+  void slide()
+  {
+    if (window.size() < 4 * kWindow)
+      return;
+    const int shift = (int)window.size() - kWindow;
+    window.erase(window.begin(), window.begin() + shift);
+    for (int &position : head)
+    {
+      position = position >= shift ? position - shift : -1;
+    }
+  }
+
+  // Write window out as stored blocks of up to 65535 bytes. Unless last, a partial block is
+  // kept for the next row.
+  void storeBlocks(bool last)
+  {
+    size_t done = 0;
+    while (window.size() - done >= 65535 || (last && (done < window.size() || done == 0)))
+    {
+      const size_t size = std::min(window.size() - done, (size_t)65535);
+      const bool final = last && done + size == window.size();
+      idat.insert(idat.end(), {(uint8_t)final, (uint8_t)size, (uint8_t)(size >> 8), (uint8_t)~size, (uint8_t)(~size >> 8)});
+      idat.insert(idat.end(), window.begin() + done, window.begin() + done + size);
+      done += size;
+      if (final)
+        break;
+    }
+    window.erase(window.begin(), window.begin() + done);
+  }
+
+  void putChunk(const char *type, const std::vector<uint8_t> &data)
+  {
+    const uint32_t size = (uint32_t)data.size();
+    const uint8_t header[8] = {(uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size,
+                               (uint8_t)type[0], (uint8_t)type[1], (uint8_t)type[2], (uint8_t)type[3]};
+    put(header, 8);
+    put(data);
+    const uint32_t crc = crc32(crc32(0, (const uint8_t *)type, 4), data.data(), data.size());
+    const uint8_t trailer[4] = {(uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+    put(trailer, 4);
+  }
+
+};
+
+// ---------------------------------------------------------------------------------------------
+
+std::unique_ptr<LImageEncoder> LCreateImageEncoder(LImageFormat format, int width, int height, const LImageEncoder::Sink &sink)
+{
+  switch (format)
+  {
+  case LImageFormat::kPPM:
+    return std::unique_ptr<LImageEncoder>(new LNetpbmEncoder(width, height, sink, false));
+  case LImageFormat::kPAM:
+    return std::unique_ptr<LImageEncoder>(new LNetpbmEncoder(width, height, sink, true));
+  case LImageFormat::kQOI:
+    return std::unique_ptr<LImageEncoder>(new LQOIEncoder(width, height, sink));
+  case LImageFormat::kPNGStore:
+    return std::unique_ptr<LImageEncoder>(new LPNGEncoder(width, height, sink, false));
+  case LImageFormat::kPNGFast:
+    return std::unique_ptr<LImageEncoder>(new LPNGEncoder(width, height, sink, true));
+  }
+  return nullptr;
+}
+
+LImageEncoder::Sink LFileSink(FILE *file)
+{
+  return [file](const uint8_t *bytes, size_t size)
+  { fwrite(bytes, 1, size, file); };
+}
+
+bool LWriteImage(const char *path, const GBitmap &bitmap, LImageFormat format)
+{
+  LTRACE("writeImage");
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return false;
+  std::unique_ptr<LImageEncoder> encoder = LCreateImageEncoder(format, bitmap.width(), bitmap.height(), LFileSink(file));
+  encoder->writeRows(bitmap);
+  encoder->finish();
+  bool ok = !ferror(file);
+  return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,168 @@
+#include "LFrameLoop.h"
+#include "LTrace.h"
+#include <algorithm>
+#include <cmath>
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+LFrameLoop::LFrameLoop(int width, int height, const DrawFrame &draw, bool threaded) : draw(draw)
+{
+  for (Buffer &buffer : buffers)
+  {
+    buffer.pixels = LDefaultBitmapPool().acquire(width, height);
+    buffer.canvas = LCreateCanvas(buffer.pixels.bitmap());
+  }
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  (void)threaded;
+#else
+  if (threaded)
+  {
+    thread = std::thread(&LFrameLoop::threadLoop, this);
+  }
+#endif
+}
+
+LFrameLoop::~LFrameLoop()
+{
+  if (thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      quit = true;
+    }
+    wake.notify_all();
+    thread.join();
+  }
+}
+
+void LFrameLoop::setThreadPool(LThreadPool *pool)
+{
+  for (Buffer &buffer : buffers)
+  {
+    buffer.canvas->setThreadPool(pool);
+  }
+}
+
+void LFrameLoop::startFrame()
+{
+  if (inFlight)
+    return;
+  inFlight = true;
+  if (thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      pending = true;
+    }
+    wake.notify_one();
+  }
+  else
+  {
+    drawBack();
+  }
+}
+
+const GBitmap &LFrameLoop::nextFrame()
+{
+  startFrame();
+  if (thread.joinable())
+  {
+    LTRACE("waitFrame");
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this]
+              { return !pending; });
+  }
+  inFlight = false;
+
+  auto now = std::chrono::steady_clock::now();
+  if (frame > 0)
+  {
+    frameMs.add(std::chrono::duration<double, std::milli>(now - lastFrame).count());
+  }
+  lastFrame = now;
+
+  front = 1 - front;
+  frame += 1;
+  totals.add(frontCanvas()->stats());
+  frontCanvas()->resetStats();
+  return buffers[front].pixels.bitmap();
+}
+
+LFrameTimes LFrameLoop::drawTimes() const
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return drawMs.percentiles();
+}
+
+LFrameTimes LFrameLoop::frameTimes() const
+{
+  return frameMs.percentiles();
+}
+
+void LFrameLoop::drawBack()
+{
+  LTRACE("drawFrame");
+  auto start = std::chrono::steady_clock::now();
+  draw(buffers[1 - front].canvas.get(), frame);
+  double ms = msSince(start);
+  std::lock_guard<std::mutex> guard(lock);
+  drawMs.add(ms);
+}
+
+void LFrameLoop::threadLoop()
+{
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      wake.wait(guard, [this]
+                { return pending || quit; });
+      if (quit)
+        return;
+    }
+    // front and frame only change in nextFrame(), which waits for this draw first.
+    drawBack();
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      pending = false;
+    }
+    done.notify_all();
+  }
+}
+
+void LFrameLoop::Samples::add(double value)
+{
+  if ((int)ms.size() < kTimedFrames)
+  {
+    ms.push_back(value);
+  }
+  else
+  {
+    ms[next] = value;
+  }
+  next = (next + 1) % kTimedFrames;
+}
+
+LFrameTimes LFrameLoop::Samples::percentiles() const
+{
+  LFrameTimes times;
+  if (ms.empty())
+    return times;
+  std::vector<double> sorted = ms;
+  std::sort(sorted.begin(), sorted.end());
+  // Nearest rank: the smallest sample at least p of the samples are no larger than.
+  auto rank = [&sorted](double p)
+  {
+    size_t index = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(std::max(index, (size_t)1), sorted.size()) - 1];
+  };
+  times.frames = (int)sorted.size();
+  times.p50 = rank(0.50);
+  times.p90 = rank(0.90);
+  times.p99 = rank(0.99);
+  times.max = sorted.back();
+  return times;
+}
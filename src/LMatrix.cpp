@@ -1,5 +1,6 @@
 #include "GMatrix.h"
 #include "math.h"
+#include "LSimd.h"
 
 GMatrix::GMatrix() : GMatrix(1, 0, 0, 0, 1, 0) {}
 
@@ -66,7 +67,21 @@ void GMatrix::mapPoints(GPoint dst[], const GPoint src[], int count) const
     float d = fMat[KY];
     float e = fMat[SY];
     float f = fMat[TY];
-    for (int i = 0; i < count; ++i)
+    int i = 0;
+#if LSIMD
+    // Two points per vector, as (x0, y0, x1, y1).
+    const LF32x4 m0 = {a, d, a, d};
+    const LF32x4 m1 = {b, e, b, e};
+    const LF32x4 m2 = {c, f, c, f};
+    for (; i + 2 <= count; i += 2)
+    {
+        LF32x4 p = LLoadF32x4(&src[i].fX);
+        LF32x4 xs = __builtin_shufflevector(p, p, 0, 0, 2, 2);
+        LF32x4 ys = __builtin_shufflevector(p, p, 1, 1, 3, 3);
+        LStoreF32x4(&dst[i].fX, m0 * xs + m1 * ys + m2);
+    }
+#endif
+    for (; i < count; ++i)
     {
         float x = src[i].x();
         float y = src[i].y();
@@ -0,0 +1,382 @@
+#include "LPicture.h"
+#include "LClip.h"
+#include "LPainter.h"
+#include "LUtil.h"
+#include <algorithm>
+
+// Bounds are kept well inside int range so they can be offset and intersected freely.
+static const float kMaxCoord = 1 << 24;
+
+static GIRect everything()
+{
+  return GIRect::MakeLTRB(-kMaxCoord, -kMaxCoord, kMaxCoord, kMaxCoord);
+}
+
+// Scan conversion rounds to pixel centers, so the rounded-out bounds grown by one pixel always
+// contain every touched pixel.
+static GIRect outsetBounds(const GRect &rect)
+{
+  if (!(rect.left() <= rect.right() && rect.top() <= rect.bottom()))
+  {
+    return everything();
+  }
+  GRect pinned = GRect::MakeLTRB(CLAMP(rect.left(), -kMaxCoord, kMaxCoord), CLAMP(rect.top(), -kMaxCoord, kMaxCoord),
+                                 CLAMP(rect.right(), -kMaxCoord, kMaxCoord), CLAMP(rect.bottom(), -kMaxCoord, kMaxCoord));
+  GIRect bounds = pinned.roundOut();
+  return GIRect::MakeLTRB(bounds.left() - 1, bounds.top() - 1, bounds.right() + 1, bounds.bottom() + 1);
+}
+
+void LClipOp::apply(GCanvas *canvas) const
+{
+  if (parent)
+  {
+    parent->apply(canvas);
+  }
+  if (isRect)
+  {
+    canvas->clipRect(GRect::Make(rect));
+  }
+  else
+  {
+    canvas->clipPath(path);
+  }
+}
+
+void LOp::playback(GCanvas *canvas) const
+{
+  canvas->save();
+  if (clip)
+  {
+    clip->apply(canvas);
+  }
+  draw(canvas);
+  canvas->restore();
+}
+
+void LOp::draw(GCanvas *canvas) const
+{
+  canvas->save();
+  canvas->concat(ctm);
+  switch (type)
+  {
+  case kPaint:
+    canvas->drawPaint(paint);
+    break;
+  case kRect:
+    canvas->drawRect(rect, paint);
+    break;
+  case kPolygon:
+    canvas->drawConvexPolygon(verts.data(), verts.size(), paint);
+    break;
+  case kPath:
+    canvas->drawPath(path, paint);
+    break;
+  case kMesh:
+    canvas->drawMesh(verts.data(), colors.empty() ? nullptr : colors.data(), texs.empty() ? nullptr : texs.data(), count, indices.data(), paint);
+    break;
+  case kQuad:
+    canvas->drawQuad(verts.data(), colors.empty() ? nullptr : colors.data(), texs.empty() ? nullptr : texs.data(), count, paint);
+    break;
+  case kPathInstances:
+    canvas->drawPathInstances(path, matrices.data(), colors.empty() ? nullptr : colors.data(), matrices.size(), paint);
+    break;
+  case kLines:
+    canvas->drawLines(verts.data(), verts.size(), paint);
+    break;
+  case kPolyline:
+    canvas->drawPolyline(verts.data(), verts.size(), paint);
+    break;
+  }
+  canvas->restore();
+}
+
+bool LOverwrites(const LOp &op)
+{
+  if (op.type == LOp::kPathInstances && !op.colors.empty())
+  {
+    // Each instance is drawn with its own color in the paint.
+    GPaint paint(op.paint);
+    for (const GColor &color : op.colors)
+    {
+      const GBlendMode mode = paintToMode(paint.setColor(color));
+      if (mode != GBlendMode::kSrc && mode != GBlendMode::kClear)
+        return false;
+    }
+    return true;
+  }
+  const GBlendMode mode = paintToMode(op.paint);
+  return mode == GBlendMode::kSrc || mode == GBlendMode::kClear;
+}
+
+bool LDrawsNothing(const LOp &op)
+{
+  if (op.type == LOp::kPathInstances && !op.colors.empty())
+  {
+    // The paint's own color is never drawn; only the instance colors are.
+    GPaint paint(op.paint);
+    for (const GColor &color : op.colors)
+    {
+      if (paintToMode(paint.setColor(color)) != GBlendMode::kDst)
+        return false;
+    }
+    return true;
+  }
+  return paintToMode(op.paint) == GBlendMode::kDst;
+}
+
+bool LCoveredRect(const LOp &op, GIRect *covered)
+{
+  GIRect rect;
+  switch (op.type)
+  {
+  case LOp::kPaint:
+    rect = everything();
+    break;
+  case LOp::kRect:
+    // MyCanvas rounds the rect before mapping it, and a mapped axis-aligned rect fills exactly
+    // the pixels LMapRectToDevice reports.
+    if (!LMapRectToDevice(op.ctm, GRect::Make(op.rect.round()), &rect))
+    {
+      return false;
+    }
+    break;
+  default:
+    return false;
+  }
+  for (const LClipOp *clip = op.clip.get(); clip; clip = clip->parent.get())
+  {
+    if (!clip->isRect)
+    {
+      return false;
+    }
+  }
+  if (op.clip && !rect.intersect(op.clip->bounds))
+  {
+    return false;
+  }
+  *covered = rect;
+  return !rect.isEmpty();
+}
+
+void LPlayer::draw(const LOp &op)
+{
+  if (op.clip.get() != current)
+  {
+    canvas->restore();
+    canvas->save();
+    if (op.clip)
+    {
+      op.clip->apply(canvas);
+    }
+    current = op.clip.get();
+  }
+  op.draw(canvas);
+}
+
+void LPicture::playback(GCanvas *canvas) const
+{
+  LPlayer player(canvas);
+  for (const LOp &op : ops)
+  {
+    player.draw(op);
+  }
+}
+
+void LPicture::playback(GCanvas *canvas, const GIRect &area) const
+{
+  LPlayer player(canvas);
+  for (const LOp &op : ops)
+  {
+    if (op.bounds.intersects(area))
+    {
+      player.draw(op);
+    }
+  }
+}
+
+void LRecorder::save()
+{
+  saveStates.push_back({ctm, clip});
+}
+
+void LRecorder::restore()
+{
+  ctm = saveStates.back().ctm;
+  clip = saveStates.back().clip;
+  saveStates.pop_back();
+}
+
+void LRecorder::concat(const GMatrix &matrix)
+{
+  ctm.preConcat(matrix);
+}
+
+void LRecorder::clipRect(const GRect &rect)
+{
+  GIRect device;
+  if (LMapRectToDevice(ctm, rect, &device))
+  {
+    LClipOp *clipOp = new LClipOp{clip, true, device};
+    pushClip(clipOp, device);
+    return;
+  }
+  GPath path;
+  path.addRect(rect);
+  clipPath(path);
+}
+
+void LRecorder::clipPath(const GPath &path)
+{
+  LClipOp *clipOp = new LClipOp{clip, false};
+  clipOp->path = path;
+  clipOp->path.transform(ctm);
+  pushClip(clipOp, clipOp->path.bounds().roundOut());
+}
+
+// Mirrors how MyCanvas narrows its clip bounds, so op bounds never reach past the clip.
+void LRecorder::pushClip(LClipOp *clipOp, GIRect bounds)
+{
+  if (clip && !bounds.intersect(clip->bounds))
+  {
+    bounds = GIRect::MakeLTRB(0, 0, 0, 0);
+  }
+  clipOp->bounds = bounds;
+  clip.reset(clipOp);
+}
+
+GIRect LRecorder::clipped(GIRect bounds) const
+{
+  if (clip && !bounds.intersect(clip->bounds))
+  {
+    return GIRect::MakeLTRB(0, 0, 0, 0);
+  }
+  return bounds;
+}
+
+LOp &LRecorder::push(LOp::Type type, const GPaint &paint)
+{
+  picture->ops.push_back(LOp{type, ctm, paint});
+  picture->ops.back().clip = clip;
+  return picture->ops.back();
+}
+
+GIRect LRecorder::deviceBounds(const GPoint points[], int count) const
+{
+  if (count == 0)
+  {
+    return GIRect::MakeLTRB(0, 0, 0, 0);
+  }
+  std::vector<GPoint> mapped(count);
+  ctm.mapPoints(mapped.data(), points, count);
+  GRect bounds = GRect::MakeXYWH(mapped[0].x(), mapped[0].y(), 0, 0);
+  for (int i = 1; i < count; ++i)
+  {
+    GRect pt = GRect::MakeXYWH(mapped[i].x(), mapped[i].y(), 0, 0);
+    bounds = PathUtil::unite(bounds, pt);
+  }
+  return outsetBounds(bounds);
+}
+
+void LRecorder::drawPaint(const GPaint &paint)
+{
+  push(LOp::kPaint, paint).bounds = clipped(everything());
+}
+
+void LRecorder::drawRect(const GRect &rect, const GPaint &paint)
+{
+  LOp &op = push(LOp::kRect, paint);
+  op.rect = rect;
+  // MyCanvas rounds the rect before mapping it, which under a magnifying CTM can reach well past
+  // the unrounded corners.
+  const GRect r = GRect::Make(rect.round());
+  GPoint corners[4] = {{r.left(), r.top()}, {r.right(), r.top()}, {r.right(), r.bottom()}, {r.left(), r.bottom()}};
+  op.bounds = clipped(deviceBounds(corners, 4));
+}
+
+void LRecorder::drawConvexPolygon(const GPoint points[], int count, const GPaint &paint)
+{
+  LOp &op = push(LOp::kPolygon, paint);
+  op.verts.assign(points, points + count);
+  op.bounds = clipped(deviceBounds(points, count));
+}
+
+void LRecorder::drawPath(const GPath &path, const GPaint &paint)
+{
+  LOp &op = push(LOp::kPath, paint);
+  op.path = path;
+  GPath dupPath = GPath(path);
+  dupPath.transform(ctm);
+  op.bounds = dupPath.countPoints() > 0 ? clipped(outsetBounds(dupPath.bounds())) : GIRect::MakeLTRB(0, 0, 0, 0);
+}
+
+void LRecorder::drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint &paint)
+{
+  int numVerts = 0;
+  for (int i = 0; i < count * 3; i++)
+  {
+    numVerts = std::max(numVerts, indices[i] + 1);
+  }
+  LOp &op = push(LOp::kMesh, paint);
+  op.count = count;
+  op.verts.assign(verts, verts + numVerts);
+  if (colors)
+    op.colors.assign(colors, colors + numVerts);
+  if (texs)
+    op.texs.assign(texs, texs + numVerts);
+  op.indices.assign(indices, indices + count * 3);
+  op.bounds = clipped(deviceBounds(verts, numVerts));
+}
+
+void LRecorder::drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint &paint)
+{
+  LOp &op = push(LOp::kQuad, paint);
+  op.count = level;
+  op.verts.assign(verts, verts + 4);
+  if (colors)
+    op.colors.assign(colors, colors + 4);
+  if (texs)
+    op.texs.assign(texs, texs + 4);
+  op.bounds = clipped(deviceBounds(verts, 4));
+}
+
+// A hairline only touches pixels that contain part of it, which deviceBounds' outset covers.
+void LRecorder::drawLines(const GPoint points[], int count, const GPaint &paint)
+{
+  LOp &op = push(LOp::kLines, paint);
+  op.verts.assign(points, points + count);
+  op.bounds = clipped(deviceBounds(points, count));
+}
+
+void LRecorder::drawPolyline(const GPoint points[], int count, const GPaint &paint)
+{
+  LOp &op = push(LOp::kPolyline, paint);
+  op.verts.assign(points, points + count);
+  op.bounds = clipped(deviceBounds(points, count));
+}
+
+void LRecorder::drawPathInstances(const GPath &path, const GMatrix matrices[], const GColor colors[], int count, const GPaint &paint)
+{
+  LOp &op = push(LOp::kPathInstances, paint);
+  op.path = path;
+  op.matrices.assign(matrices, matrices + count);
+  if (colors)
+    op.colors.assign(colors, colors + count);
+  op.bounds = GIRect::MakeLTRB(0, 0, 0, 0);
+  if (path.countPoints() == 0 || count <= 0)
+    return;
+  // Every flattened point lies inside the path's bounds, so their corners bound each instance.
+  const GRect local = path.bounds();
+  const GPoint corners[4] = {{local.left(), local.top()}, {local.right(), local.top()}, {local.right(), local.bottom()}, {local.left(), local.bottom()}};
+  GRect bounds;
+  for (int i = 0; i < count; ++i)
+  {
+    GPoint mapped[4];
+    (ctm * matrices[i]).mapPoints(mapped, corners, 4);
+    for (int j = 0; j < 4; ++j)
+    {
+      GRect pt = GRect::MakeXYWH(mapped[j].x(), mapped[j].y(), 0, 0);
+      bounds = i == 0 && j == 0 ? pt : PathUtil::unite(bounds, pt);
+    }
+  }
+  op.bounds = clipped(outsetBounds(bounds));
+}
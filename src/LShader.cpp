@@ -5,13 +5,51 @@
 #include "GPoint.h"
 #include "LUtil.h"
 #include "LPainter.h"
+#include "LSimd.h"
+#include "LTexture.h"
+#include <algorithm>
 #include <cmath>
+#include <new>
+#include <vector>
+
+/**
+ *  The context of a shader whose shading depends only on the inverse of the CTM times its local
+ *  matrix: the shader's shade() is handed the inverse for every row.
+ */
+template <typename Shader>
+class LInverseContext : public GShader::Context
+{
+public:
+  LInverseContext(const Shader &shader, const GMatrix &inverse) : shader(shader), inverse(inverse) {}
+
+  void shadeRow(int x, int y, int count, GPixel row[]) const override
+  {
+    shader.shade(inverse, x, y, count, row);
+  }
+
+  static GShader::Context *make(const Shader &shader, const GMatrix &matrix, void *storage)
+  {
+    static_assert(sizeof(LInverseContext) <= GShader::kContextSize, "context does not fit");
+    GMatrix inverse;
+    if (!matrix.invert(&inverse))
+      return nullptr;
+    return new (storage) LInverseContext(shader, inverse);
+  }
+
+private:
+  const Shader &shader;
+  const GMatrix inverse;
+};
 
 class LShader : public GShader
 {
 public:
-  LShader(const GBitmap &newBitmap, const GMatrix &ctm, GShader::TileMode mode) : bitmap(newBitmap), localMatrix(ctm * GMatrix::Scale(newBitmap.width(), newBitmap.height())), context(GMatrix()), invContext(GMatrix())
+  LShader(const GBitmap &newBitmap, const GMatrix &ctm, GShader::TileMode mode, LTextureLayout layout = LTextureLayout::kRowMajor) : bitmap(newBitmap), localMatrix(ctm * GMatrix::Scale(newBitmap.width(), newBitmap.height()))
   {
+    if (layout != LTextureLayout::kRowMajor)
+    {
+      relayout(layout);
+    }
     switch (mode)
     {
     case GShader::TileMode::kRepeat:
@@ -23,49 +61,191 @@ public:
     default:
       tile = clamp;
     }
+#if LSIMD
+    tile4 = tile4For(mode);
+#endif
   }
 
-  bool isOpaque()
+  // As the bitmap's owner declared it (setIsOpaque), taken when the shader was made. The pixels
+  // are not read: they may still change, e.g. a render target later drawn with as a texture.
+  bool isOpaque() const override
   {
     return bitmap.isOpaque();
   }
 
-  bool setContext(const GMatrix &ctm)
+  Context *makeContext(const GMatrix &ctm, void *storage) const override
+  {
+    return LInverseContext<LShader>::make(*this, ctm * localMatrix, storage);
+  }
+
+  void shade(const GMatrix &invContext, int x, int y, int count, GPixel row[]) const
+  {
+    if (pixels.empty())
+    {
+      shadeWith(invContext, x, y, count, row, [this](int x, int y)
+                { return *bitmap.getAddr(x, y); });
+    }
+    else
+    {
+      shadeWith(invContext, x, y, count, row, [this](int x, int y)
+                { return pixels[xOffsets[x] + yOffsets[y]]; });
+    }
+  }
+
+private:
+  const GBitmap bitmap;
+  const GMatrix localMatrix;
+
+  // A copy of the bitmap in another layout, or empty to sample the bitmap itself. Pixel (x, y)
+  // is at xOffsets[x] + yOffsets[y]: every layout here splits into a part from each axis.
+  std::vector<GPixel> pixels;
+  std::vector<uint32_t> xOffsets;
+  std::vector<uint32_t> yOffsets;
+
+  void relayout(LTextureLayout layout)
+  {
+    const int width = bitmap.width();
+    const int height = bitmap.height();
+    xOffsets.resize(width);
+    yOffsets.resize(height);
+    size_t size;
+    if (layout == LTextureLayout::kMorton)
+    {
+      // Z-order over the largest power-of-two square that fits in both padded sides; the
+      // squares themselves are laid out row by row.
+      int xBits = 0;
+      int yBits = 0;
+      while ((1 << xBits) < width)
+        ++xBits;
+      while ((1 << yBits) < height)
+        ++yBits;
+      const int bits = std::min(xBits, yBits);
+      const uint32_t mask = (1u << bits) - 1;
+      const uint32_t square = 1u << (2 * bits);
+      for (int x = 0; x < width; ++x)
+      {
+        xOffsets[x] = spreadBits(x & mask) | (x >> bits) * square;
+      }
+      for (int y = 0; y < height; ++y)
+      {
+        yOffsets[y] = spreadBits(y & mask) << 1 | (y >> bits) * square << (xBits - bits);
+      }
+      size = (size_t)1 << (xBits + yBits);
+    }
+    else
+    {
+      // Square blocks, each contiguous and row-major inside, in rows of blocks.
+      const int shift = layout == LTextureLayout::kBlocked4x4 ? 2 : 3;
+      const int side = 1 << shift;
+      const uint32_t blocksPerRow = (width + side - 1) >> shift;
+      for (int x = 0; x < width; ++x)
+      {
+        xOffsets[x] = (x >> shift << 2 * shift) + (x & (side - 1));
+      }
+      for (int y = 0; y < height; ++y)
+      {
+        yOffsets[y] = (y >> shift) * (blocksPerRow << 2 * shift) + (y & (side - 1)) * side;
+      }
+      size = (size_t)blocksPerRow * ((height + side - 1) >> shift) << 2 * shift;
+    }
+    pixels.resize(size);
+    for (int y = 0; y < height; ++y)
+    {
+      const GPixel *row = bitmap.getAddr(0, y);
+      for (int x = 0; x < width; ++x)
+      {
+        pixels[xOffsets[x] + yOffsets[y]] = row[x];
+      }
+    }
+  }
+
+  // The low 16 bits of v moved to the even bit positions.
+  static uint32_t spreadBits(uint32_t v)
   {
-    context = ctm * localMatrix;
-    return context.invert(&invContext);
+    v = (v | v << 8) & 0x00FF00FF;
+    v = (v | v << 4) & 0x0F0F0F0F;
+    v = (v | v << 2) & 0x33333333;
+    v = (v | v << 1) & 0x55555555;
+    return v;
   }
 
-  void shadeRow(int x, int y, int count, GPixel row[])
+  template <typename Fetch>
+  void shadeWith(const GMatrix &invContext, int x, int y, int count, GPixel row[], Fetch &&fetch) const
   {
-    GPoint vec{x + 0.5f, y + 0.5f};
-    GPoint local = invContext * vec;
+    // Sample positions depend only on the device x, never on where the span starts, so a
+    // span split across tiles or clips shades exactly like the whole span.
+    GPoint origin = invContext * GPoint{0.5f, y + 0.5f};
 
     int width = bitmap.width();
     int height = bitmap.height();
-    float x0 = local.x();
-    float y0 = local.y();
     float dx = invContext[GMatrix::SX];
     float dy = invContext[GMatrix::KY];
     int x1, y1;
 
-    for (int i = 0; i < count; ++i, x0 += dx, y0 += dy)
+    int i = 0;
+#if LSIMD
+    for (; i + 4 <= count; i += 4)
+    {
+      LF32x4 px = LPixelXs(x + i);
+      LI32x4 xs = LFloorToInt((float)width * tile4(origin.x() + px * dx));
+      LI32x4 ys = LFloorToInt((float)height * tile4(origin.y() + px * dy));
+      for (int k = 0; k < 4; ++k)
+      {
+        row[i + k] = fetch(xs[k], ys[k]);
+      }
+    }
+#endif
+    for (; i < count; ++i)
     {
-      x1 = GFloorToInt(width * tile(x0));
-      y1 = GFloorToInt(height * tile(y0));
-      row[i] = *bitmap.getAddr(x1, y1);
+      float px = x + i;
+      x1 = GFloorToInt(width * tile(origin.x() + px * dx));
+      y1 = GFloorToInt(height * tile(origin.y() + px * dy));
+      row[i] = fetch(x1, y1);
     }
   }
 
-private:
-  const GBitmap bitmap;
-  const GMatrix localMatrix;
-  GMatrix context;
-  GMatrix invContext;
-
   typedef float (*Tiler)(float);
   Tiler tile;
 
+#if LSIMD
+  typedef LF32x4 (*Tiler4)(LF32x4);
+  Tiler4 tile4;
+
+  static Tiler4 tile4For(GShader::TileMode mode)
+  {
+    switch (mode)
+    {
+    case GShader::TileMode::kRepeat:
+      return repeat;
+    case GShader::TileMode::kMirror:
+      return mirror;
+    default:
+      return clamp;
+    }
+  }
+
+  static inline LF32x4 clamp(LF32x4 a)
+  {
+    a = 0.999999f < a ? 0.999999f : a;
+    return 0.0f < a ? a : 0.0f;
+  }
+
+  // repeat and mirror can land on 1 itself (rounding just below 0, or an odd whole number
+  // under mirror), which would sample one past the last column or row; cap them like clamp.
+  static inline LF32x4 repeat(LF32x4 a)
+  {
+    a = a - LFloor(a);
+    return 0.999999f < a ? 0.999999f : a;
+  }
+
+  static inline LF32x4 mirror(LF32x4 a)
+  {
+    LF32x4 b = (a - 2 * LFloor(a * 0.5f)) - 1;
+    a = 1 - (b < 0.0f ? -b : b);
+    return 0.999999f < a ? 0.999999f : a;
+  }
+#endif
+
   static inline float clamp(float a)
   {
     return CLAMP(a, 0.0f, 0.999999f);
@@ -73,12 +253,12 @@ private:
 
   static inline float repeat(float a)
   {
-    return a - floorf(a);
+    return std::min(a - floorf(a), 0.999999f);
   }
 
   static inline float mirror(float a)
   {
-    return 1 - std::abs((a - 2 * floorf(a * 0.5)) - 1);
+    return std::min(1 - std::abs((a - 2 * floorf(a * 0.5)) - 1), 0.999999f);
   }
 };
 
@@ -115,9 +295,12 @@ public:
     default:
       tile = clamp;
     }
+#if LSIMD
+    tile4 = tile4For(mode);
+#endif
   }
 
-  bool isOpaque() override
+  bool isOpaque() const override
   {
     for (int i = 0; i < colors.size(); ++i)
     {
@@ -129,13 +312,12 @@ public:
     return true;
   }
 
-  bool setContext(const GMatrix &ctm) override
+  Context *makeContext(const GMatrix &ctm, void *storage) const override
   {
-    context = ctm * localMatrix;
-    return context.invert(&invContext);
+    return LInverseContext<LGradient>::make(*this, ctm * localMatrix, storage);
   }
 
-  void shadeRow(int x, int y, int count, GPixel row[]) override
+  void shade(const GMatrix &invContext, int x, int y, int count, GPixel row[]) const
   {
     if (colors.size() == 1)
     {
@@ -146,14 +328,25 @@ public:
       }
       return;
     }
-    GPoint vec{x + 0.5f, y + 0.5f};
-    GPoint local = invContext * vec;
-    float x0 = local.x();
+    GPoint origin = invContext * GPoint{0.5f, y + 0.5f};
     float dx = invContext[GMatrix::SX];
     int numColors = colors.size();
-    for (int i = 0; i < count; ++i, x0 += dx)
+    int i = 0;
+#if LSIMD
+    for (; i + 4 <= count; i += 4)
     {
-      float scale = tile(x0) * (numColors - 1);
+      LF32x4 scale = tile4(origin.x() + LPixelXs(x + i) * dx) * (float)(numColors - 1);
+      LI32x4 index = LFloorToInt(scale);
+      LF32x4 w = scale - __builtin_convertvector(index, LF32x4);
+      for (int k = 0; k < 4; ++k)
+      {
+        row[i + k] = createPixel(LLoadF32x4(&colors[index[k]].r) + w[k] * LLoadF32x4(&colorsDiff[index[k]].r));
+      }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+      float scale = tile(origin.x() + (x + i) * dx) * (numColors - 1);
       int index = GFloorToInt(scale);
       float w = scale - index;
       row[i] = createPixel(colors[index] + w * colorsDiff[index]);
@@ -165,13 +358,46 @@ private:
   GPoint p1;
   std::vector<GColor> colors;
   std::vector<GColor> colorsDiff;
-  GMatrix context;
-  GMatrix invContext;
   GMatrix localMatrix;
 
   typedef float (*Tiler)(float);
   Tiler tile;
 
+#if LSIMD
+  typedef LF32x4 (*Tiler4)(LF32x4);
+  Tiler4 tile4;
+
+  static Tiler4 tile4For(GShader::TileMode mode)
+  {
+    switch (mode)
+    {
+    case GShader::TileMode::kRepeat:
+      return repeat;
+    case GShader::TileMode::kMirror:
+      return mirror;
+    default:
+      return clamp;
+    }
+  }
+
+  static inline LF32x4 clamp(LF32x4 a)
+  {
+    a = 1.0f < a ? 1.0f : a;
+    return 0.0f < a ? a : 0.0f;
+  }
+
+  static inline LF32x4 repeat(LF32x4 a)
+  {
+    return a - LFloor(a);
+  }
+
+  static inline LF32x4 mirror(LF32x4 a)
+  {
+    LF32x4 b = (a - 2 * LFloor(a * 0.5f)) - 1;
+    return 1 - (b < 0.0f ? -b : b);
+  }
+#endif
+
   static inline float clamp(float a)
   {
     return CLAMP(a, 0.0f, 1.0f);
@@ -196,4 +422,9 @@ std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColo
 std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap &bitmap, const GMatrix &localMatrix, GShader::TileMode mode)
 {
   return std::unique_ptr<GShader>(new LShader(bitmap, localMatrix, mode));
-};
\ No newline at end of file
+};
+
+std::unique_ptr<GShader> LCreateBitmapShader(const GBitmap &bitmap, const GMatrix &localMatrix, GShader::TileMode mode, LTextureLayout layout)
+{
+  return std::unique_ptr<GShader>(new LShader(bitmap, localMatrix, mode, layout));
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "LStripRenderer.h"
+#include "LTrace.h"
+#include <algorithm>
+#include <cstring>
+
+LStripRenderer::LStripRenderer(int width, int height, int stripHeight)
+    : width(width), height(height), strip(LDefaultBitmapPool().acquire(width, std::max(1, std::min(stripHeight, height))))
+{
+  canvas = LCreateStripCanvas(strip.bitmap(), height);
+}
+
+void LStripRenderer::render(const LPicture &picture, const Sink &sink)
+{
+  LTRACE("render");
+  const GBitmap &pixels = strip.bitmap();
+  for (int top = 0; top < height; top += pixels.height())
+  {
+    LTRACE("strip");
+    const int rows = std::min(pixels.height(), height - top);
+    // Each strip starts from a clear device, as the whole device would.
+    memset(pixels.pixels(), 0, pixels.rowBytes() * rows);
+    canvas->setStrip(top);
+    picture.playback(canvas.get(), GIRect::MakeLTRB(0, top, width, top + rows));
+    sink(GBitmap(width, rows, pixels.rowBytes(), pixels.pixels(), false), top);
+    canvas->trim();
+  }
+}
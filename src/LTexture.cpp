@@ -0,0 +1,98 @@
+#include "LTexture.h"
+#include "LBitmapPool.h"
+#include "LTrace.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(LTextureHeader) == 64, "the header is 64 bytes on disk");
+
+LMappedTexture::~LMappedTexture()
+{
+  munmap(mapping, size);
+}
+
+// Whether header describes pixels that fit in a file of size bytes.
+static bool validHeader(const LTextureHeader &header, size_t size)
+{
+  if (0 != memcmp(header.magic, "LTEX", 4) || header.version != kTextureVersion)
+    return false;
+  if (header.width == 0 || header.height == 0 || header.width > (1 << 24) || header.height > (1 << 24))
+    return false;
+  if (header.rowBytes % kBitmapRowAlign || header.pixelOffset % kBitmapRowAlign || header.pixelOffset < sizeof(header))
+    return false;
+  if (header.rowBytes < (uint64_t)header.width * sizeof(GPixel))
+    return false;
+  uint64_t end = header.pixelOffset + (uint64_t)header.rowBytes * (header.height - 1) + header.width * sizeof(GPixel);
+  return end <= size;
+}
+
+std::unique_ptr<LMappedTexture> LMapTexture(const char *path)
+{
+  LTRACE("mapTexture");
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(LTextureHeader))
+  {
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = info.st_size;
+  // Copy-on-write, so a stray write through the GBitmap cannot fault or reach the file.
+  void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file.
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+
+  LTextureHeader header;
+  memcpy(&header, mapping, sizeof(header));
+  if (!validHeader(header, size))
+  {
+    munmap(mapping, size);
+    return nullptr;
+  }
+  GBitmap bitmap(header.width, header.height, header.rowBytes, (GPixel *)((char *)mapping + header.pixelOffset), false);
+  // Set after construction: a GBitmap constructed opaque checks every pixel in debug builds.
+  if (header.flags & kTextureOpaque)
+  {
+    bitmap.setIsOpaque(GBitmap::kYes_IsOpaque);
+  }
+  return std::unique_ptr<LMappedTexture>(new LMappedTexture(bitmap, mapping, size));
+}
+
+bool LWriteTexture(const char *path, const GBitmap &bitmap)
+{
+  if (bitmap.width() <= 0 || bitmap.height() <= 0)
+    return false;
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return false;
+  GBitmap opacity = bitmap;
+  opacity.computeIsOpaque();
+
+  LTextureHeader header = {};
+  memcpy(header.magic, "LTEX", 4);
+  header.version = kTextureVersion;
+  header.width = bitmap.width();
+  header.height = bitmap.height();
+  header.rowBytes = LAlignedRowBytes(bitmap.width());
+  header.flags = opacity.isOpaque() ? kTextureOpaque : 0;
+  header.pixelOffset = sizeof(header);
+  fwrite(&header, sizeof(header), 1, file);
+
+  const size_t used = bitmap.width() * sizeof(GPixel);
+  const char padding[kBitmapRowAlign] = {};
+  for (int y = 0; y < bitmap.height(); ++y)
+  {
+    fwrite(bitmap.getAddr(0, y), 1, used, file);
+    fwrite(padding, 1, header.rowBytes - used, file);
+  }
+  bool ok = !ferror(file);
+  return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,141 @@
+#include "LThreadPool.h"
+#include "LTrace.h"
+
+static int resolveThreads(int threads)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  return 1;
+#else
+  if (threads <= 0)
+  {
+    threads = std::thread::hardware_concurrency();
+  }
+  return threads > 0 ? threads : 1;
+#endif
+}
+
+LThreadPool::LThreadPool(int threads) : numWorkers(resolveThreads(threads))
+{
+  for (int i = 0; i < numWorkers; ++i)
+  {
+    queues.emplace_back(new Queue());
+  }
+  for (int i = 1; i < numWorkers; ++i)
+  {
+    this->threads.emplace_back(&LThreadPool::workerLoop, this, i);
+  }
+}
+
+LThreadPool::~LThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    quit = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads)
+  {
+    thread.join();
+  }
+}
+
+void LThreadPool::parallelFor(int count, const Job &newJob)
+{
+  if (numWorkers == 1)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      newJob(i, 0);
+    }
+    return;
+  }
+
+  // Hand out contiguous runs so neighbouring indices (e.g. adjacent tiles) stay on one worker
+  // until stealing kicks in.
+  for (int w = 0; w < numWorkers; ++w)
+  {
+    int begin = (long long)count * w / numWorkers;
+    int end = (long long)count * (w + 1) / numWorkers;
+    std::lock_guard<std::mutex> guard(queues[w]->lock);
+    for (int i = end - 1; i >= begin; --i)
+    {
+      queues[w]->indices.push_back(i);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    job = &newJob;
+    busy = numWorkers;
+    ++generation;
+  }
+  wake.notify_all();
+
+  runJobs(0);
+
+  std::unique_lock<std::mutex> guard(lock);
+  done.wait(guard, [this]
+            { return busy == 0; });
+  job = nullptr;
+}
+
+void LThreadPool::workerLoop(int worker)
+{
+  LTraceSetThreadName("worker " + std::to_string(worker));
+  int seen = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      wake.wait(guard, [this, seen]
+                { return quit || generation != seen; });
+      if (quit)
+      {
+        return;
+      }
+      seen = generation;
+    }
+    runJobs(worker);
+  }
+}
+
+void LThreadPool::runJobs(int worker)
+{
+  int index;
+  while (next(worker, &index))
+  {
+    (*job)(index, worker);
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+  if (--busy == 0)
+  {
+    done.notify_all();
+  }
+}
+
+bool LThreadPool::next(int worker, int *index)
+{
+  {
+    Queue &own = *queues[worker];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.indices.empty())
+    {
+      *index = own.indices.back();
+      own.indices.pop_back();
+      return true;
+    }
+  }
+  for (int i = 1; i < numWorkers; ++i)
+  {
+    Queue &victim = *queues[(worker + i) % numWorkers];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.indices.empty())
+    {
+      *index = victim.indices.front();
+      victim.indices.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
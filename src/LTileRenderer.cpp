@@ -0,0 +1,66 @@
+#include "LTileRenderer.h"
+#include "LTrace.h"
+#include <algorithm>
+
+LTileRenderer::LTileRenderer(const GBitmap &device, int tileSize, int threads)
+    : fDevice(device), tileSize(tileSize), tilesX((device.width() + tileSize - 1) / tileSize), tilesY((device.height() + tileSize - 1) / tileSize), pool(threads), bins(tilesX * tilesY)
+{
+  for (int i = 0; i < pool.count(); ++i)
+  {
+    canvases.push_back(LCreateCanvas(device));
+  }
+}
+
+void LTileRenderer::binOps(const LPicture &picture)
+{
+  LTRACE("bin");
+  for (std::vector<int> &bin : bins)
+  {
+    bin.clear();
+  }
+
+  const GIRect device = GIRect::MakeWH(fDevice.width(), fDevice.height());
+  for (int i = 0; i < (int)picture.ops.size(); ++i)
+  {
+    GIRect bounds = picture.ops[i].bounds;
+    if (!bounds.intersect(device))
+    {
+      continue;
+    }
+    int tx0 = bounds.left() / tileSize;
+    int ty0 = bounds.top() / tileSize;
+    int tx1 = (bounds.right() - 1) / tileSize;
+    int ty1 = (bounds.bottom() - 1) / tileSize;
+    for (int ty = ty0; ty <= ty1; ++ty)
+    {
+      for (int tx = tx0; tx <= tx1; ++tx)
+      {
+        bins[ty * tilesX + tx].push_back(i);
+      }
+    }
+  }
+}
+
+void LTileRenderer::render(const LPicture &picture)
+{
+  LTRACE("render");
+  binOps(picture);
+
+  pool.parallelFor(bins.size(), [&](int tile, int worker)
+                   {
+    const std::vector<int> &bin = bins[tile];
+    if (bin.empty())
+    {
+      return;
+    }
+    LTRACE("tile");
+    int left = (tile % tilesX) * tileSize;
+    int top = (tile / tilesX) * tileSize;
+    LCanvas *canvas = canvases[worker].get();
+    canvas->setBounds(GIRect::MakeXYWH(left, top, tileSize, tileSize));
+    LPlayer player(canvas);
+    for (int index : bin)
+    {
+      player.draw(picture.ops[index]);
+    } });
+}
@@ -0,0 +1,203 @@
+#include "LTrace.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> gLTraceEnabled(false);
+
+// Per-thread capacity; at a few hundred events per frame this holds the last hundred or so.
+static const int kRingSize = 1 << 16;
+
+// Rings of threads that have exited are kept for a dump after a pool shuts down, but only this
+// many; the oldest go first.
+static const int kMaxExitedRings = 8;
+
+namespace
+{
+  // Written only by the ring's thread and read by LTraceJSON on any thread, so every field is
+  // atomic; relaxed stores cost the same as plain ones.
+  struct Event
+  {
+    std::atomic<const char *> name;
+    std::atomic<long long> startNs;
+    std::atomic<long long> endNs;
+  };
+
+  struct Ring
+  {
+    int tid;
+    std::string name;
+    std::unique_ptr<Event[]> events{new Event[kRingSize]};
+    // Total events written; the ring holds the last kRingSize of them. Only the ring's thread
+    // stores it.
+    std::atomic<long long> written{0};
+    // written when the current trace started; earlier events belong to an older trace.
+    long long since = 0;
+    bool exited = false;
+  };
+
+  std::mutex ringsLock;
+  std::vector<std::shared_ptr<Ring>> rings;
+  int nextTid = 1;
+  const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+  void retire(const std::shared_ptr<Ring> &ring);
+
+  // A thread's ring, handed over to retire() when the thread exits.
+  struct RingOwner
+  {
+    std::shared_ptr<Ring> ring;
+    ~RingOwner()
+    {
+      if (ring)
+        retire(ring);
+    }
+  };
+
+  // Rings are only allocated once a thread records something, so naming a thread is free.
+  thread_local RingOwner owner;
+  thread_local std::string threadName;
+
+  // Keep an exited thread's ring only while it holds events of the current trace, and at most
+  // kMaxExitedRings of them.
+  void retire(const std::shared_ptr<Ring> &ring)
+  {
+    std::lock_guard<std::mutex> guard(ringsLock);
+    ring->exited = true;
+    int exited = 0;
+    for (int i = (int)rings.size() - 1; i >= 0; --i)
+    {
+      const Ring &r = *rings[i];
+      if (r.exited && (r.written.load(std::memory_order_relaxed) == r.since || ++exited > kMaxExitedRings))
+      {
+        rings.erase(rings.begin() + i);
+      }
+    }
+  }
+}
+
+static Ring &threadRing()
+{
+  if (!owner.ring)
+  {
+    owner.ring = std::make_shared<Ring>();
+    std::lock_guard<std::mutex> guard(ringsLock);
+    owner.ring->tid = nextTid++;
+    owner.ring->name = threadName.empty() ? "thread " + std::to_string(owner.ring->tid) : threadName;
+    rings.push_back(owner.ring);
+  }
+  return *owner.ring;
+}
+
+long long LTraceNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void LTraceRecord(const char *name, long long startNs, long long endNs)
+{
+  Ring &own = threadRing();
+  const long long n = own.written.load(std::memory_order_relaxed);
+  // Orders the store of written = n before the slot is overwritten, so a reader that sees any
+  // of the new fields also sees n and knows the slot is being reused (see LTraceJSON).
+  std::atomic_thread_fence(std::memory_order_release);
+  Event &slot = own.events[n % kRingSize];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.startNs.store(startNs, std::memory_order_relaxed);
+  slot.endNs.store(endNs, std::memory_order_relaxed);
+  own.written.store(n + 1, std::memory_order_release);
+}
+
+void LTraceStart()
+{
+  {
+    // Nothing a recording thread writes is touched: each ring just remembers where this trace
+    // begins, and rings of exited threads, holding only older events, are dropped.
+    std::lock_guard<std::mutex> guard(ringsLock);
+    for (size_t i = rings.size(); i-- > 0;)
+    {
+      if (rings[i]->exited)
+      {
+        rings.erase(rings.begin() + i);
+        continue;
+      }
+      rings[i]->since = rings[i]->written.load(std::memory_order_acquire);
+    }
+  }
+  gLTraceEnabled.store(true, std::memory_order_relaxed);
+}
+
+void LTraceStop()
+{
+  gLTraceEnabled.store(false, std::memory_order_relaxed);
+}
+
+void LTraceSetThreadName(const std::string &name)
+{
+  threadName = name;
+  if (owner.ring)
+  {
+    std::lock_guard<std::mutex> guard(ringsLock);
+    owner.ring->name = name;
+  }
+}
+
+std::string LTraceJSON()
+{
+  std::lock_guard<std::mutex> guard(ringsLock);
+  std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  char buffer[256];
+  struct Copied
+  {
+    const char *name;
+    long long startNs;
+    long long endNs;
+  };
+  std::vector<Copied> copied;
+  for (const std::shared_ptr<Ring> &ring : rings)
+  {
+    snprintf(buffer, sizeof(buffer),
+             "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+             first ? "" : ",", ring->tid, ring->name.c_str());
+    json += buffer;
+    first = false;
+
+    // The thread may still be recording: copy the events out, then drop any whose slot it has
+    // since come round to again, as they may be torn.
+    const long long end = ring->written.load(std::memory_order_acquire);
+    long long begin = std::max(ring->since, end - kRingSize);
+    copied.clear();
+    for (long long i = begin; i < end; ++i)
+    {
+      const Event &event = ring->events[i % kRingSize];
+      copied.push_back({event.name.load(std::memory_order_relaxed), event.startNs.load(std::memory_order_relaxed),
+                        event.endNs.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const long long reused = ring->written.load(std::memory_order_relaxed) - kRingSize + 1;
+    for (long long i = std::max(begin, reused); i < end; ++i)
+    {
+      const Copied &event = copied[i - begin];
+      snprintf(buffer, sizeof(buffer), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+               event.name, ring->tid, event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0);
+      json += buffer;
+    }
+  }
+  json += "\n]}\n";
+  return json;
+}
+
+bool LTraceWrite(const char *path)
+{
+  FILE *f = fopen(path, "w");
+  if (!f)
+  {
+    return false;
+  }
+  std::string json = LTraceJSON();
+  bool ok = fwrite(json.data(), 1, json.size(), f) == json.size();
+  return fclose(f) == 0 && ok;
+}
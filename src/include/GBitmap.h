@@ -56,7 +56,9 @@ public:
     }
 
     /**
-     *  Allocate the memory for the bitmap. If rowBytes is 0, it will be computed from w.
+     *  Allocate the memory for the bitmap, zeroed and 64-byte aligned; release it with free().
+     *  If rowBytes is 0, it will be computed from w, padded to a multiple of 64 bytes so every
+     *  row starts on a cache line.
      */
     void alloc(int w, int h, size_t rowBytes = 0);
 
@@ -19,7 +19,7 @@ public:
     virtual ~GCanvas() {}
 
     /**
-     *  Save off a copy of the canvas state (CTM), to be later used if the balancing call to
+     *  Save off a copy of the canvas state (CTM and clip), to be later used if the balancing call to
      *  restore() is made. Calls to save/restore can be nested:
      *  save();
      *      save();
@@ -32,7 +32,7 @@ public:
     virtual void save() = 0;
 
     /**
-     *  Copy the canvas state (CTM) that was record in the correspnding call to save() back into
+     *  Copy the canvas state (CTM and clip) that was record in the correspnding call to save() back into
      *  the canvas. It is an error to call restore() if there has been no previous call to save().
      */
     virtual void restore() = 0;
@@ -45,6 +45,18 @@ public:
      */
     virtual void concat(const GMatrix& matrix) = 0;
 
+    /**
+     *  Intersect the current clip with the rectangle, mapped by the CTM. Pixels whose centers
+     *  fall outside the clip are left untouched by subsequent draws. The canvas is constructed
+     *  with the clip set to the whole device.
+     */
+    virtual void clipRect(const GRect&) = 0;
+
+    /**
+     *  Intersect the current clip with the path (non-zero winding), mapped by the CTM.
+     */
+    virtual void clipPath(const GPath&) = 0;
+
     /**
      *  Fill the entire canvas with the specified color, using the specified blendmode.
      */
@@ -122,6 +134,50 @@ public:
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint&) = 0;
 
+    /**
+     *  Draw a hairline from pts[2i] to pts[2i + 1] for each pair of points (a trailing odd point
+     *  is ignored). A hairline is one pixel thick whatever the CTM: it steps one pixel at a time
+     *  along whichever of x and y its mapped end points differ more in, touching the single
+     *  pixel that contains the line at each pixel center it passes. Centers at the lower end
+     *  are skipped and centers at the higher end are drawn, as for filled edges, so the segments
+     *  of a polyline that continue in the same direction never touch a pixel twice.
+     */
+    virtual void drawLines(const GPoint pts[], int count, const GPaint&) = 0;
+
+    /**
+     *  Draw hairlines from pts[0] to pts[1], pts[1] to pts[2], ... pts[count - 2] to
+     *  pts[count - 1], as drawLines does.
+     */
+    virtual void drawPolyline(const GPoint pts[], int count, const GPaint&) = 0;
+
+    /**
+     *  Fill the path once per instance, e.g. the same marker at many places. Instance i is drawn
+     *  as if by
+     *      save();
+     *      concat(matrices[i]);
+     *      drawPath(path, paint);   // with its color replaced by colors[i]
+     *      restore();
+     *  in order. colors can be null, in which case every instance uses the paint's color.
+     *
+     *  A canvas may flatten the path's curves once for all instances, as finely as the instance
+     *  that magnifies it most needs, and reuse one instance's coverage for another that differs
+     *  from it only by a whole-pixel translation. Either can move an edge that passes within
+     *  float rounding of a pixel center by a pixel, compared with drawPath.
+     */
+    virtual void drawPathInstances(const GPath& path, const GMatrix matrices[], const GColor colors[],
+                                   int count, const GPaint& paint) {
+        GPaint instance(paint);
+        for (int i = 0; i < count; ++i) {
+            if (colors) {
+                instance.setColor(colors[i]);
+            }
+            this->save();
+            this->concat(matrices[i]);
+            this->drawPath(path, instance);
+            this->restore();
+        }
+    }
+
     // Helpers
 
     void translate(float x, float y) {
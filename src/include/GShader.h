@@ -27,22 +27,41 @@ public:
     virtual ~GShader() {}
 
     // Return true iff all of the GPixels that may be returned by this shader will be opaque.
-    virtual bool isOpaque() = 0;
+    virtual bool isOpaque() const = 0;
 
-    // The draw calls in GCanvas must call this with the CTM before any calls to shadeSpan().
-    virtual bool setContext(const GMatrix& ctm) = 0;
+    /**
+     *  The shader as seen through one CTM, for the length of one draw. Contexts only read the
+     *  shader, so one shader may be drawn by any number of canvases and threads at once, and a
+     *  context may shade rows on several threads at once.
+     */
+    class Context {
+    public:
+        virtual ~Context() {}
+
+        /**
+         *  Given a row of pixels in device space [x, y] ... [x + count - 1, y], return the
+         *  corresponding src pixels in row[0...count - 1]. The caller must ensure that row[]
+         *  can hold at least [count] entries.
+         */
+        virtual void shadeRow(int x, int y, int count, GPixel row[]) const = 0;
+    };
+
+    // Bytes of storage a context may need.
+    static const size_t kContextSize = 128;
 
     /**
-     *  Given a row of pixels in device space [x, y] ... [x + count - 1, y], return the
-     *  corresponding src pixels in row[0...count - 1]. The caller must ensure that row[]
-     *  can hold at least [count] entries.
+     *  The draw calls in GCanvas call this with the CTM before shading. The context is built in
+     *  storage, which holds kContextSize bytes aligned for any type, and the caller destroys it.
+     *  Returns nullptr, building nothing, if the CTM leaves nothing to shade (it cannot be
+     *  inverted).
      */
-    virtual void shadeRow(int x, int y, int count, GPixel row[]) = 0;
+    virtual Context* makeContext(const GMatrix& ctm, void* storage) const = 0;
 };
 
 /**
  *  Return a subclass of GShader that draws the specified bitmap and a local matrix.
- *  Returns null if the either parameter is invalid.
+ *  Returns null if the either parameter is invalid. The shader is opaque only if the bitmap
+ *  is marked opaque (setIsOpaque) when it is created; its pixels are not inspected.
  */
 std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap&, const GMatrix& localMatrix,
                                              GShader::TileMode = GShader::kClamp);
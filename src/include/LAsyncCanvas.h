@@ -0,0 +1,89 @@
+#ifndef LASYNCCANVASDEF
+#define LASYNCCANVASDEF
+
+#include "GBitmap.h"
+#include "LPicture.h"
+#include "LSpmcQueue.h"
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ *  Raster workers for LAsyncCanvas. Flushed pictures go onto a lock-free queue and each is
+ *  drawn whole by whichever worker takes it, so independent targets (e.g. a batch of
+ *  thumbnails) draw in parallel while the producer records the next one.
+ *
+ *  Submit from one thread only. Builds without thread support have no workers and draw each
+ *  picture inside submit().
+ */
+class LAsyncRenderer
+{
+public:
+  // threads <= 0 means one per hardware thread. queueSize bounds the pictures waiting to draw.
+  explicit LAsyncRenderer(int threads = 0, int queueSize = 256);
+
+  // Waits for every submitted picture to finish drawing.
+  ~LAsyncRenderer();
+
+  int threads() const { return (int)workers.size(); }
+
+  /**
+   *  Draw picture into target on a worker. Neither target's pixels nor the shaders the picture
+   *  uses may be touched until the future is ready. If the queue is full, the caller draws
+   *  queued pictures itself until there is room.
+   */
+  std::future<void> submit(LPicture &&picture, const GBitmap &target);
+
+private:
+  struct Job
+  {
+    LPicture picture;
+    GBitmap target;
+    std::promise<void> done;
+  };
+
+  LSpmcQueue<Job> queue;
+  std::vector<std::thread> workers;
+
+  // Workers with nothing to take sleep here until the producer has pushed again.
+  std::mutex sleepLock;
+  std::condition_variable wake;
+  std::atomic<unsigned> pushes{0};
+  std::atomic<int> sleepers{0};
+  std::atomic<bool> quit{false};
+
+  void workerLoop();
+  void run(Job &job);
+};
+
+/**
+ *  A GCanvas front end for LAsyncRenderer: draws are recorded until flush(), which hands them
+ *  to the workers and returns a future that is ready once they are in the target's pixels.
+ *  Recording continues straight away, with the same CTM and clip.
+ */
+class LAsyncCanvas : public LRecorder
+{
+public:
+  LAsyncCanvas(LAsyncRenderer *renderer, const GBitmap &target) : LRecorder(&frame), renderer(renderer), target(target) {}
+
+  // Pictures for one target must draw in order, so this first waits for the previous flush.
+  std::shared_future<void> flush()
+  {
+    if (last.valid())
+      last.wait();
+    last = renderer->submit(std::move(frame), target).share();
+    frame.reset();
+    return last;
+  }
+
+private:
+  LPicture frame;
+  LAsyncRenderer *renderer;
+  GBitmap target;
+  std::shared_future<void> last;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef LBITMAPPOOLDEF
+#define LBITMAPPOOLDEF
+
+#include "GBitmap.h"
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Rows of allocated and pooled bitmaps start on this boundary, so whole-row SIMD loads never
+// split a line.
+static const size_t kBitmapRowAlign = 64;
+
+// width pixels rounded up to a multiple of kBitmapRowAlign bytes.
+static inline size_t LAlignedRowBytes(int width)
+{
+  size_t bytes = (size_t)width * sizeof(GPixel);
+  return (bytes + kBitmapRowAlign - 1) / kBitmapRowAlign * kBitmapRowAlign;
+}
+
+class LBitmapPool;
+
+/**
+ *  A bitmap whose pixels came from an LBitmapPool and go back to it on destruction. Movable,
+ *  not copyable; bitmap() may be copied freely as long as the copies do not outlive this.
+ */
+class LPooledBitmap
+{
+public:
+  LPooledBitmap() : pool(nullptr), bytes(0) {}
+  LPooledBitmap(LPooledBitmap &&other) : fBitmap(other.fBitmap), pool(other.pool), bytes(other.bytes)
+  {
+    other.pool = nullptr;
+  }
+  LPooledBitmap &operator=(LPooledBitmap &&other);
+  LPooledBitmap(const LPooledBitmap &) = delete;
+  LPooledBitmap &operator=(const LPooledBitmap &) = delete;
+  ~LPooledBitmap() { release(); }
+
+  const GBitmap &bitmap() const { return fBitmap; }
+
+  // Hand the pixels back now rather than at destruction.
+  void release();
+
+private:
+  friend class LBitmapPool;
+  LPooledBitmap(const GBitmap &bitmap, LBitmapPool *pool, size_t bytes) : fBitmap(bitmap), pool(pool), bytes(bytes) {}
+
+  GBitmap fBitmap;
+  LBitmapPool *pool;
+  size_t bytes;
+};
+
+/**
+ *  Recycles bitmap storage by size class, so offscreens (layers, tiles, mip levels) that come
+ *  and go every frame stop going through the system allocator. Buffers are 64-byte aligned
+ *  with padded rows (see LAlignedRowBytes). Size classes are four per power of two, so a
+ *  recycled buffer is at most 25% larger than asked for. Thread safe.
+ */
+class LBitmapPool
+{
+public:
+  enum Init
+  {
+    kZeroed,
+    // Leave the pixels as the last user left them. Only for callers whose first draw
+    // overwrites every pixel, e.g. a full kSrc fill.
+    kUninitialized,
+  };
+
+  // At most maxPooledBytes are kept for reuse; anything released beyond that is freed.
+  explicit LBitmapPool(size_t maxPooledBytes = 64 << 20) : maxPooledBytes(maxPooledBytes) {}
+  ~LBitmapPool();
+
+  // Returns an empty handle, whose bitmap has no pixels, if the memory cannot be allocated.
+  LPooledBitmap acquire(int width, int height, Init init = kZeroed);
+
+  // Free every buffer waiting for reuse.
+  void trim();
+
+  // Bytes currently waiting for reuse.
+  size_t pooledBytes();
+
+private:
+  friend class LPooledBitmap;
+
+  const size_t maxPooledBytes;
+  std::mutex lock;
+  std::map<size_t, std::vector<void *>> freeLists;
+  size_t pooled = 0;
+
+  void recycle(void *pixels, size_t bytes);
+};
+
+// A process-wide pool for callers that do not need their own.
+LBitmapPool &LDefaultBitmapPool();
+
+#endif
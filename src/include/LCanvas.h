@@ -0,0 +1,97 @@
+#ifndef LCANVASDEF
+#define LCANVASDEF
+
+#include "GCanvas.h"
+#include "GBitmap.h"
+#include "GRect.h"
+#include "LStats.h"
+
+class LCoverage;
+class LThreadPool;
+
+// Bytes a canvas holds, by what it holds them for.
+struct LMemoryUsage
+{
+  size_t columnBuffer = 0; // per-row dot lists used by scan conversion
+  size_t rowBuffer = 0;    // one device row of shaded pixels per drawing thread
+  size_t geometry = 0;     // device-space path copy and mesh/quad temporaries
+  size_t clip = 0;         // clip masks held by the current and saved states
+  size_t other = 0;        // save stack and span lists
+
+  // What trim() may release. The row buffer is always needed and clip masks belong to the
+  // save stack, so neither counts.
+  size_t scratch() const { return columnBuffer + geometry + other; }
+  size_t total() const { return scratch() + rowBuffer + clip; }
+};
+
+// Scratch a canvas may keep across frames before trim() releases any.
+static const size_t kDefaultScratchBudget = 1 << 20;
+
+/**
+ *  The canvas returned by GCreateCanvas, with the extra hooks the renderers in this library
+ *  need on top of the GCanvas interface.
+ */
+class LCanvas : public GCanvas
+{
+public:
+  /**
+   *  Restrict all drawing to the device pixels inside bounds (intersected with the device).
+   *  Output inside bounds is identical to what an unrestricted canvas would produce, so a
+   *  single canvas can be pointed at one tile or band after another.
+   */
+  virtual void setBounds(const GIRect &bounds) = 0;
+
+  /**
+   *  For a canvas from LCreateStripCanvas: the bitmap now holds device rows [top, top + its
+   *  height), and drawing is bounded to them as if by setBounds. Coordinates stay in the whole
+   *  device's space. Clears the clip and what opacity tracking knew.
+   */
+  virtual void setStrip(int top) = 0;
+
+  /**
+   *  Route pixel writes through coverage: only pixels not already claimed by an op later than
+   *  order are shaded and written, and if claim is true the written pixels are then claimed for
+   *  order. Pass nullptr to go back to writing every pixel. See LDrawFrontToBack.
+   */
+  virtual void setCoverage(LCoverage *coverage, int order, bool claim) = 0;
+
+  /**
+   *  Opacity tracking (on by default) remembers which device pixels are known opaque or known
+   *  clear and blends onto them with the cheaper equivalent mode, e.g. kSrcOver onto cleared
+   *  pixels is a plain copy. setBounds() forgets what it knew inside the new bounds; call
+   *  invalidateOpacity() whenever anything else writes to the device.
+   */
+  virtual void setOpacityTracking(bool enabled) = 0;
+  virtual void invalidateOpacity() = 0;
+
+  /**
+   *  Draw large fills and paths in horizontal bands spread over pool; pass nullptr to draw on
+   *  the calling thread only. The pool must outlive the canvas (or the next call), and must not
+   *  be the one the canvas is itself being driven from, e.g. by LTileRenderer.
+   */
+  virtual void setThreadPool(LThreadPool *pool) = 0;
+
+  // Counters since creation or the last resetStats(). All zero unless built with LSTATS.
+  virtual LStats stats() const = 0;
+  virtual void resetStats() = 0;
+
+  virtual LMemoryUsage memoryUsage() const = 0;
+
+  // The scratch size trim() brings the canvas down to.
+  virtual void setScratchBudget(size_t bytes) = 0;
+
+  /**
+   *  Release scratch until memoryUsage().scratch() is within the budget, starting with
+   *  temporaries sized by the last draw and then the largest dot rows. Call between frames;
+   *  buffers that fit the budget are kept so steady-state drawing does not reallocate.
+   */
+  virtual void trim() = 0;
+};
+
+std::unique_ptr<LCanvas> LCreateCanvas(const GBitmap &device);
+
+// A canvas for a device deviceHeight rows tall of which strip holds only some rows at a time;
+// see setStrip(). It starts on rows [0, strip.height()).
+std::unique_ptr<LCanvas> LCreateStripCanvas(const GBitmap &strip, int deviceHeight);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef LCLIPDEF
+#define LCLIPDEF
+
+#include "GMatrix.h"
+#include "GRect.h"
+#include "LDot.h"
+#include <vector>
+
+// A run of pixels [x0, x1) on one row.
+struct LSpan
+{
+  int x0;
+  int x1;
+};
+
+/**
+ *  Coverage of a non-rectangular clip, stored as sorted, disjoint runs per device row.
+ *  Rows outside bounds are empty. Masks are immutable once built so saved states can share them.
+ */
+struct LClipMask
+{
+  GIRect bounds;
+  std::vector<std::vector<LSpan>> rows;
+
+  const std::vector<LSpan> &row(int y) const { return rows[y - bounds.top()]; }
+};
+
+// Intersect two sorted, disjoint span lists.
+static inline void LIntersectSpans(const std::vector<LSpan> &a, const std::vector<LSpan> &b, std::vector<LSpan> &out)
+{
+  size_t i = 0;
+  size_t j = 0;
+  while (i < a.size() && j < b.size())
+  {
+    int x0 = std::max(a[i].x0, b[j].x0);
+    int x1 = std::min(a[i].x1, b[j].x1);
+    if (x0 < x1)
+    {
+      out.push_back({x0, x1});
+    }
+    if (a[i].x1 < b[j].x1)
+      ++i;
+    else
+      ++j;
+  }
+}
+
+/**
+ *  If m keeps rectangles axis-aligned, store the device pixels whose centers fall inside the
+ *  mapped rect in out (the same rule drawRect uses) and return true.
+ */
+static inline bool LMapRectToDevice(const GMatrix &m, const GRect &rect, GIRect *out)
+{
+  if (m[GMatrix::KX] != 0 || m[GMatrix::KY] != 0)
+  {
+    return false;
+  }
+  GPoint pts[2] = {{rect.left(), rect.top()}, {rect.right(), rect.bottom()}};
+  m.mapPoints(pts, 2);
+  *out = GRect::MakeLTRB(std::min(pts[0].x(), pts[1].x()), std::min(pts[0].y(), pts[1].y()),
+                         std::max(pts[0].x(), pts[1].x()), std::max(pts[0].y(), pts[1].y()))
+             .round();
+  return true;
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef LCOMMANDSDEF
+#define LCOMMANDSDEF
+
+#include "GCanvas.h"
+#include "GColor.h"
+#include "GMatrix.h"
+#include "GPaint.h"
+#include "GPath.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ *  A batch of canvas calls encoded as 32-bit words, so JS can write a whole frame into one
+ *  buffer in wasm memory (through Uint32Array and Float32Array views of the same bytes) and
+ *  cross into wasm once to run it. Each command is an opcode word followed by its arguments,
+ *  where f is a float word and u an unsigned one:
+ *
+ *    kCmdSave, kCmdRestore
+ *    kCmdConcat             f[6]     SX KX TX KY SY TY
+ *    kCmdClipRect           f[4]     left top right bottom
+ *    kCmdClipPath                    clips to the current path
+ *    kCmdSetColor           f[4]     r g b a
+ *    kCmdSetBlendMode       u        a GBlendMode
+ *    kCmdSetShader          u        index into LCommandRunner::shaders, or kNoShader
+ *    kCmdPathReset
+ *    kCmdMoveTo, kCmdLineTo f[2]
+ *    kCmdQuadTo             f[4]
+ *    kCmdCubicTo            f[6]
+ *    kCmdAddRect            f[4] u   left top right bottom direction
+ *    kCmdAddCircle          f[3] u   cx cy radius direction
+ *    kCmdDrawPaint
+ *    kCmdDrawRect           f[4]
+ *    kCmdDrawPath                    fills the current path
+ *    kCmdDrawConvexPolygon  u n, f[2n]
+ *    kCmdDrawMesh           u triangles, u vertices, u flags (kHasColors | kHasTexs),
+ *                           f[2 * vertices], f[4 * vertices] if colors, f[2 * vertices] if texs,
+ *                           u[3 * triangles] indices
+ *    kCmdDrawQuad           u level, u flags, f[8], f[16] if colors, f[8] if texs
+ *    kCmdDrawPathInstances  u count, u flags (kHasColors), f[6 * count] matrices as for
+ *                           kCmdConcat, f[4 * count] if colors; fills the current path
+ *    kCmdDrawLines          u n, f[2n]
+ *    kCmdDrawPolyline       u n, f[2n]
+ *
+ *  The paint and the current path carry over from one command to the next within a batch, so
+ *  a run of draws in one color sets it once. Each batch starts with the default GPaint and an
+ *  empty path.
+ */
+enum LCommand : uint32_t
+{
+  kCmdSave,
+  kCmdRestore,
+  kCmdConcat,
+  kCmdClipRect,
+  kCmdClipPath,
+  kCmdSetColor,
+  kCmdSetBlendMode,
+  kCmdSetShader,
+  kCmdPathReset,
+  kCmdMoveTo,
+  kCmdLineTo,
+  kCmdQuadTo,
+  kCmdCubicTo,
+  kCmdAddRect,
+  kCmdAddCircle,
+  kCmdDrawPaint,
+  kCmdDrawRect,
+  kCmdDrawPath,
+  kCmdDrawConvexPolygon,
+  kCmdDrawMesh,
+  kCmdDrawQuad,
+  kCmdDrawPathInstances,
+  kCmdDrawLines,
+  kCmdDrawPolyline,
+  kCmdCount,
+};
+
+static const uint32_t kNoShader = 0xFFFFFFFF;
+static const uint32_t kHasColors = 1;
+static const uint32_t kHasTexs = 2;
+
+static inline uint32_t LFloatWord(float f)
+{
+  uint32_t word;
+  memcpy(&word, &f, sizeof(word));
+  return word;
+}
+
+/**
+ *  Decodes and issues batches. Scratch for mesh and polygon arrays is kept between batches, so
+ *  steady-state frames do not allocate.
+ */
+class LCommandRunner
+{
+public:
+  // The shaders kSetShader refers to, by index. They must outlive any batch that uses them.
+  std::vector<GShader *> shaders;
+
+  /**
+   *  Issue the count words of commands on canvas. Returns count, or if a command is unknown,
+   *  truncated or out of range, or is a restore without a save earlier in the batch, the index
+   *  of its opcode word; everything before it has been issued. Saves the batch leaves open are
+   *  restored before returning, so the canvas ends at the save depth it started at.
+   */
+  int run(const uint32_t words[], int count, GCanvas *canvas);
+
+private:
+  struct Reader;
+
+  GPaint paint;
+  GPath path;
+  std::vector<GPoint> points;
+  std::vector<GColor> colors;
+  std::vector<GPoint> texs;
+  std::vector<int> indices;
+  std::vector<GMatrix> matrices;
+  int depth = 0;  // saves issued by the current batch and not yet restored
+
+  // Issue one command whose fixed arguments are known to be there; false if it is malformed.
+  bool issue(uint32_t op, Reader &in, GCanvas *canvas);
+  void readVertices(Reader &in, int count, uint32_t flags);
+};
+
+/**
+ *  A GCanvas that encodes every call into a batch for LCommandRunner, for native producers and
+ *  for testing the format. Shaders are added to the shader table on first use.
+ */
+class LCommandWriter : public GCanvas
+{
+public:
+  std::vector<uint32_t> words;
+  std::vector<GShader *> shaders;
+
+  // Start a new batch; the shader table is kept.
+  void reset();
+
+  void save() override;
+  void restore() override;
+  void concat(const GMatrix &matrix) override;
+  void clipRect(const GRect &rect) override;
+  void clipPath(const GPath &path) override;
+
+  void drawPaint(const GPaint &paint) override;
+  void drawRect(const GRect &rect, const GPaint &paint) override;
+  void drawConvexPolygon(const GPoint points[], int count, const GPaint &paint) override;
+  void drawPath(const GPath &path, const GPaint &paint) override;
+  void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint &paint) override;
+  void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint &paint) override;
+  void drawPathInstances(const GPath &path, const GMatrix matrices[], const GColor colors[], int count, const GPaint &paint) override;
+  void drawLines(const GPoint points[], int count, const GPaint &paint) override;
+  void drawPolyline(const GPoint points[], int count, const GPaint &paint) override;
+
+private:
+  // The paint the runner will have once the words so far have run.
+  GPaint current;
+
+  void put(uint32_t word) { words.push_back(word); }
+  void put(float f) { words.push_back(LFloatWord(f)); }
+  void putRect(const GRect &rect);
+  void putPoints(const GPoint points[], int count);
+  void putColors(const GColor colors[], int count);
+  void putMatrix(const GMatrix &matrix);
+  void putPointList(LCommand op, const GPoint points[], int count, const GPaint &paint);
+  void setPaint(const GPaint &paint);
+  void setPath(const GPath &path);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef LCOVERAGEDEF
+#define LCOVERAGEDEF
+
+#include "LClip.h"
+#include "LPicture.h"
+#include <vector>
+
+class LCanvas;
+
+// A run [x0, x1) already written by the op at index owner.
+struct LCoverSpan
+{
+  int x0;
+  int x1;
+  int owner;
+};
+
+/**
+ *  Per-row record of which op last wrote each pixel, for drawing opaque ops front to back.
+ *  Rows hold sorted, disjoint runs.
+ */
+class LCoverage
+{
+public:
+  void reset(int height)
+  {
+    rows.resize(height);
+    for (std::vector<LCoverSpan> &row : rows)
+    {
+      row.clear();
+    }
+  }
+
+  // Append to out the pieces of [x0, x1) on row y not covered by an op later than order.
+  void visible(int y, int x0, int x1, int order, std::vector<LSpan> &out) const
+  {
+    int x = x0;
+    for (const LCoverSpan &span : rows[y])
+    {
+      if (span.x0 >= x1)
+        break;
+      if (span.x1 <= x || span.owner <= order)
+        continue;
+      if (span.x0 > x)
+      {
+        out.push_back({x, span.x0});
+      }
+      x = span.x1;
+      if (x >= x1)
+        return;
+    }
+    out.push_back({x, x1});
+  }
+
+  // Mark the uncovered parts of [x0, x1) on row y as written by owner.
+  void add(int y, int x0, int x1, int owner)
+  {
+    std::vector<LCoverSpan> &row = rows[y];
+    size_t i = 0;
+    int x = x0;
+    while (x < x1)
+    {
+      while (i < row.size() && row[i].x1 <= x)
+      {
+        ++i;
+      }
+      int end = (i == row.size() || row[i].x0 >= x1) ? x1 : row[i].x0;
+      if (x < end)
+      {
+        if (i > 0 && row[i - 1].owner == owner && row[i - 1].x1 == x)
+        {
+          row[i - 1].x1 = end;
+        }
+        else
+        {
+          row.insert(row.begin() + i, {x, end, owner});
+          ++i;
+        }
+      }
+      if (end == x1 || i == row.size())
+        break;
+      x = row[i].x1;
+      ++i;
+    }
+  }
+
+private:
+  std::vector<std::vector<LCoverSpan>> rows;
+};
+
+/**
+ *  Draw picture so that opaque work is proportional to visible pixels. Ops that overwrite
+ *  their pixels (LOverwrites) are drawn first, front to back, each shading only pixels no later
+ *  overwriting op has claimed. The remaining ops are then composited back to front, skipping
+ *  pixels claimed by an overwriting op that comes after them. The result matches drawing the
+ *  picture in order.
+ */
+void LDrawFrontToBack(const LPicture &picture, LCanvas *canvas, LCoverage *coverage, int height);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef LCULLDEF
+#define LCULLDEF
+
+#include "LPicture.h"
+
+struct LCullStats
+{
+  int opsCulled = 0;
+  // Device pixels (by op bounds) that no longer need to be drawn.
+  long long pixelsCulled = 0;
+};
+
+/**
+ *  Remove ops from picture that cannot change the device: ops that are entirely hidden behind
+ *  later opaque rects (opaque fills with kSrc/kSrcOver, or anything drawn with kSrc), ops that
+ *  draw nothing (kDst), and ops that miss the device. Walks the ops back to front, tracking the
+ *  largest opaque rects seen so far. Rendering the culled picture gives the same pixels.
+ */
+LCullStats LCullOccluded(LPicture *picture, const GIRect &device);
+
+#endif
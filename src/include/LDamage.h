@@ -0,0 +1,71 @@
+#ifndef LDAMAGEDEF
+#define LDAMAGEDEF
+
+#include "GBitmap.h"
+#include "LCanvas.h"
+#include "LPicture.h"
+#include <vector>
+
+// True if the two ops would draw exactly the same pixels.
+bool LSameOp(const LOp &a, const LOp &b);
+
+/**
+ *  Keeps the previous frame around and, for each new frame, diffs the two op lists. Only the
+ *  bounds of ops that were added, removed or changed are re-rasterized; everything else in the
+ *  device is left as the previous frame drew it.
+ *
+ *  This relies on each frame painting its damaged pixels from scratch, i.e. the frame starts
+ *  with a drawPaint that overwrites the device. Frames that do not are drawn in full.
+ *  Shaders are compared by pointer, so a shader whose output changes between frames needs an
+ *  invalidate().
+ *
+ *  The web page in main.cpp does not use this: its scene turns every frame, so it converts and
+ *  presents whole frames. A host with a mostly static scene can pass render()'s rects to
+ *  convertRect and present each with a dirty-rect putImageData.
+ */
+class LIncrementalRenderer
+{
+public:
+  LIncrementalRenderer(const GBitmap &device) : fDevice(device), canvas(LCreateCanvas(device)) {}
+
+  // Draw frame and return the device rects that changed since the last frame.
+  const std::vector<GIRect> &render(const LPicture &frame);
+
+  const std::vector<GIRect> &damage() const { return rects; }
+
+  // Force the next frame to be drawn in full.
+  void invalidate() { valid = false; }
+
+private:
+  const GBitmap fDevice;
+  std::unique_ptr<LCanvas> canvas;
+  LPicture previous;
+  std::vector<GIRect> rects;
+  bool valid = false;
+
+  void addDamage(GIRect rect);
+};
+
+/**
+ *  A GCanvas front end for LIncrementalRenderer: draws are recorded until flush().
+ */
+class LDamageCanvas : public LRecorder
+{
+public:
+  LDamageCanvas(const GBitmap &device) : LRecorder(&frame), renderer(device) {}
+
+  const std::vector<GIRect> &flush()
+  {
+    renderer.render(frame);
+    frame.reset();
+    return renderer.damage();
+  }
+
+  void invalidate() { renderer.invalidate(); }
+
+private:
+  LPicture frame;
+  LIncrementalRenderer renderer;
+};
+
+#endif
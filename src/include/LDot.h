@@ -2,6 +2,8 @@
 #define LDOTDEF
 
 #include "GMath.h"
+#include "GMatrix.h"
+#include "GPath.h"
 #include "LUtil.h"
 #include <vector>
 #include <cmath>
@@ -23,15 +25,47 @@ static inline void LEdgeToDots(std::vector<std::vector<LDot>> &dots, const GPoin
   float dx = (p1.x() - p0.x()) / (p1.y() - p0.y());
   float b = p0.x() - dx * p0.y();
   int y = CLAMP(GRoundToInt(std::min(p0.y(), p1.y())), bounds.top(), bounds.bottom());
-  float x = dx * (y + 0.5) + b;
   int winding = p0.y() < p1.y() ? 1 : -1;
 
-  for (int i = 0; i < numDots; ++i, x += dx, ++y)
+  // x is evaluated from y rather than accumulated, so clipping the first row away (tiles,
+  // bands) cannot shift the dots that remain.
+  for (int i = 0; i < numDots; ++i, ++y)
   {
+    float x = dx * (y + 0.5) + b;
     dots[y].emplace_back(CLAMP(GRoundToInt(x), bounds.left(), bounds.right()), winding);
   }
 }
 
+static inline void LSortRow(LDot *row, int numDots)
+{
+  std::sort(row, row + numDots, [](LDot a, LDot b)
+            { return a.x < b.x; });
+}
+
+/**
+ *  Walk a row of dots sorted by x with the non-zero winding rule, calling visit(x0, x1) for each
+ *  filled run.
+ */
+template <typename Visit>
+static inline void LWalkRow(const LDot *row, int numDots, Visit &&visit)
+{
+  int w = 0;
+  int x0 = 0;
+  for (int i = 0; i < numDots; ++i)
+  {
+    int x = row[i].x;
+    if (w == 0)
+    {
+      x0 = x;
+    }
+    w += row[i].w;
+    if (w == 0 && x0 < x)
+    {
+      visit(x0, x);
+    }
+  }
+}
+
 static inline float quadError(const GPoint &p0, const GPoint &p1, const GPoint &p2)
 {
   const GPoint e = (-1 * p0 + 2 * p1 - p2) * 0.25;
@@ -47,44 +81,59 @@ static inline float cubicError(const GPoint &p0, const GPoint &p1, const GPoint
   return std::sqrt(eX * eX + eY * eY);
 }
 
-static inline void LQuadToDots(std::vector<std::vector<LDot>> &dots, const GPoint &p0, const GPoint &p1, const GPoint &p2, const GIRect &bounds)
+/**
+ *  Call edge(p0, p1) for each line segment the quad is flattened into, and return how many
+ *  there were. scale is how much the points will be magnified before they are drawn (1 for
+ *  device points), so the segments stay fine enough once they are.
+ */
+template <typename Edge>
+static inline int LFlattenQuad(const GPoint &p0, const GPoint &p1, const GPoint &p2, float scale, Edge &&edge)
 {
   GPoint a = QUADA(p0, p1, p2);
   GPoint b = QUADB(p0, p1);
-  int numSegments = GCeilToInt(2 * std::sqrt(quadError(p0, p1, p2)));
+  int numSegments = GCeilToInt(2 * std::sqrt(scale * quadError(p0, p1, p2)));
   float dt = 1.0f / numSegments;
   GPoint prevPoint = p0;
   float t = dt;
   for (int i = 1; i < numSegments; ++i, t += dt)
   {
     GPoint currPoint = HORNER2(a, b, p0, t);
-    LEdgeToDots(dots, prevPoint, currPoint, bounds);
+    edge(prevPoint, currPoint);
     prevPoint = GPoint(currPoint);
   }
-  LEdgeToDots(dots, prevPoint, p2, bounds);
+  edge(prevPoint, p2);
+  return numSegments;
 }
 
-static inline void LCubicToDots(std::vector<std::vector<LDot>> &dots, const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPoint &p3, const GIRect &bounds)
+// As LFlattenQuad, for a cubic.
+template <typename Edge>
+static inline int LFlattenCubic(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPoint &p3, float scale, Edge &&edge)
 {
   GPoint a = CUBICA(p0, p1, p2, p3);
   GPoint b = CUBICB(p0, p1, p2);
   GPoint c = CUBICC(p0, p1);
-  int numSegments = GCeilToInt(std::sqrt(3 * cubicError(p0, p1, p2, p3)));
+  int numSegments = GCeilToInt(std::sqrt(3 * scale * cubicError(p0, p1, p2, p3)));
   float dt = 1.0f / numSegments;
   GPoint prevPoint = p0;
   float t = dt;
   for (int i = 1; i < numSegments; ++i, t += dt)
   {
     GPoint currPoint = HORNER3(a, b, c, p0, t);
-    LEdgeToDots(dots, prevPoint, currPoint, bounds);
+    edge(prevPoint, currPoint);
     prevPoint = GPoint(currPoint);
   }
-  LEdgeToDots(dots, prevPoint, p3, bounds);
+  edge(prevPoint, p3);
+  return numSegments;
 }
 
-static inline void LPathToDots(std::vector<std::vector<LDot>> &dots, const GPath &path, const GIRect &bounds)
+/**
+ *  Call edge(p0, p1) for every line edge of path, closing edges included and curves flattened
+ *  for scale as in LFlattenQuad. Returns the number of edges.
+ */
+template <typename Edge>
+static inline int LFlattenPath(const GPath &path, float scale, Edge &&edge)
 {
-  // int numDots = 0;
+  int numEdges = 0;
   GPath::Edger edger(path);
   std::vector<GPoint> pts(GPath::kMaxNextPoints);
 
@@ -94,20 +143,58 @@ static inline void LPathToDots(std::vector<std::vector<LDot>> &dots, const GPath
     switch (verb)
     {
     case GPath::Verb::kLine:
-      // ctm.mapPoints(pts.data(), 2);
-      LEdgeToDots(dots, pts[0], pts[1], bounds);
+      edge(pts[0], pts[1]);
+      numEdges += 1;
       break;
     case GPath::Verb::kQuad:
-      LQuadToDots(dots, pts[0], pts[1], pts[2], bounds);
+      numEdges += LFlattenQuad(pts[0], pts[1], pts[2], scale, edge);
       break;
     case GPath::Verb::kCubic:
-      LCubicToDots(dots, pts[0], pts[1], pts[2], pts[3], bounds);
+      numEdges += LFlattenCubic(pts[0], pts[1], pts[2], pts[3], scale, edge);
       break;
     default:
       break;
     }
     verb = edger.next(pts.data());
   }
+  return numEdges;
+}
+
+// Returns the number of line segments the quad was flattened into.
+static inline int LQuadToDots(std::vector<std::vector<LDot>> &dots, const GPoint &p0, const GPoint &p1, const GPoint &p2, const GIRect &bounds)
+{
+  return LFlattenQuad(p0, p1, p2, 1.0f, [&](const GPoint &a, const GPoint &b)
+                      { LEdgeToDots(dots, a, b, bounds); });
+}
+
+// Returns the number of line segments the cubic was flattened into.
+static inline int LCubicToDots(std::vector<std::vector<LDot>> &dots, const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPoint &p3, const GIRect &bounds)
+{
+  return LFlattenCubic(p0, p1, p2, p3, 1.0f, [&](const GPoint &a, const GPoint &b)
+                       { LEdgeToDots(dots, a, b, bounds); });
+}
+
+// Returns the number of line edges emitted, after flattening curves.
+static inline int LPathToDots(std::vector<std::vector<LDot>> &dots, const GPath &path, const GIRect &bounds)
+{
+  return LFlattenPath(path, 1.0f, [&](const GPoint &a, const GPoint &b)
+                      { LEdgeToDots(dots, a, b, bounds); });
+}
+
+/**
+ *  The most m can stretch any vector: the larger singular value of its linear part. Curves
+ *  flattened in a path's own space for LFlattenPath use this as their scale.
+ */
+static inline float LMaxScale(const GMatrix &m)
+{
+  float a = m[GMatrix::SX];
+  float b = m[GMatrix::KX];
+  float c = m[GMatrix::KY];
+  float d = m[GMatrix::SY];
+  float sum = a * a + b * b + c * c + d * d;
+  float det = a * d - b * c;
+  float root = std::sqrt(std::max(0.0f, sum * sum - 4 * det * det));
+  return std::sqrt((sum + root) * 0.5f);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef LENCODEDEF
+#define LENCODEDEF
+
+#include "GBitmap.h"
+#include "GPixel.h"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// ceil(2^24 / a), so that LUnpremul is a multiply instead of a divide.
+extern const uint32_t kUnpremulScale[256];
+
+/**
+ *  One premultiplied channel c of alpha a unpremultiplied: exactly (c * 255 + a / 2) / a, the
+ *  rounded division, for every c <= a (and 0 when a is 0). The product stays under 2^32 for
+ *  all such c, so it also works in 32-bit vector lanes. Larger c, which no valid GPixel has, are
+ *  clamped to a.
+ */
+static inline uint8_t LUnpremul(unsigned c, unsigned a)
+{
+  c = c < a ? c : a;
+  return (uint8_t)(((c * 255 + a / 2) * kUnpremulScale[a]) >> 24);
+}
+
+// Convert a row of premultiplied GPixels into unpremultiplied RGBA bytes, as PNG and canvas
+// ImageData expect.
+void LUnpremulToRGBA(const GPixel src[], int width, uint8_t dst[]);
+
+enum class LImageFormat
+{
+  kPPM,      // binary RGB (P6), premultiplied, i.e. the image over black
+  kPAM,      // binary RGBA (P7 RGB_ALPHA), unpremultiplied
+  kQOI,      // "Quite OK Image" RGBA
+  kPNGStore, // PNG with uncompressed deflate blocks: as fast as copying
+  kPNGFast,  // PNG with the Sub filter and a one-probe LZ77 into fixed Huffman codes
+};
+
+/**
+ *  Streams an image out as its rows arrive, so a whole device never has to exist at once (see
+ *  LStripRenderer). The header goes to the sink on creation; each writeRows() encodes and
+ *  passes on what it can, and finish() writes the rest. Memory is a row or two plus, for
+ *  kPNGFast, the 32KB deflate window.
+ */
+class LImageEncoder
+{
+public:
+  using Sink = std::function<void(const uint8_t *bytes, size_t size)>;
+
+  virtual ~LImageEncoder() {}
+
+  int width() const { return fWidth; }
+  int height() const { return fHeight; }
+  int rowsWritten() const { return rows; }
+
+  // Encode rows as the next rows of the image, top to bottom. rows must be width() wide; any
+  // past height() are ignored.
+  void writeRows(const GBitmap &rows);
+
+  // Write the trailer. Returns false, writing nothing, if fewer than height() rows were written.
+  bool finish();
+
+protected:
+  LImageEncoder(int width, int height, const Sink &sink) : fWidth(width), fHeight(height), sink(sink) {}
+
+  virtual void encodeRow(const GPixel row[]) = 0;
+  virtual void encodeEnd() = 0;
+
+  void put(const uint8_t *bytes, size_t size) { sink(bytes, size); }
+  void put(const std::vector<uint8_t> &bytes) { sink(bytes.data(), bytes.size()); }
+
+  const int fWidth;
+  const int fHeight;
+
+private:
+  Sink sink;
+  int rows = 0;
+  bool finished = false;
+};
+
+std::unique_ptr<LImageEncoder> LCreateImageEncoder(LImageFormat format, int width, int height, const LImageEncoder::Sink &sink);
+
+// A sink that appends to file. The caller closes it.
+LImageEncoder::Sink LFileSink(FILE *file);
+
+// Encode all of bitmap into a new file at path. Returns false if the file could not be written.
+bool LWriteImage(const char *path, const GBitmap &bitmap, LImageFormat format);
+
+#endif
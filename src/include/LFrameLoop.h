@@ -0,0 +1,118 @@
+#ifndef LFRAMELOOPDEF
+#define LFRAMELOOPDEF
+
+#include "GBitmap.h"
+#include "LBitmapPool.h"
+#include "LCanvas.h"
+#include "LStats.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Percentiles over the most recent frames, in milliseconds; all zero before the first frame.
+struct LFrameTimes
+{
+  int frames = 0;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double max = 0;
+};
+
+/**
+ *  Animation with a front and a back buffer: while the front buffer (frame N) is presented, the
+ *  back one is drawn with frame N + 1, and the two trade places without copying. Each buffer has
+ *  its own canvas, so a canvas always draws into the same pixels and keeps its opacity state and
+ *  scratch from two frames back.
+ *
+ *  With thread support the back buffer is drawn on a thread of the loop's own, so presenting
+ *  overlaps drawing; otherwise startFrame() draws inline. A frame loop per presenting thread:
+ *
+ *    loop.startFrame();
+ *    for (;;) { const GBitmap &frame = loop.nextFrame(); loop.startFrame(); present(frame); }
+ */
+class LFrameLoop
+{
+public:
+  /**
+   *  Draw frame number frame (counting from 0) on canvas. The buffer still holds the frame from
+   *  two frames back, so draw must cover every pixel, e.g. starting with clear(). It runs on the
+   *  loop's thread, never at the same time as another call to draw.
+   */
+  typedef std::function<void(LCanvas *canvas, int frame)> DrawFrame;
+
+  // threaded is ignored in builds without thread support.
+  LFrameLoop(int width, int height, const DrawFrame &draw, bool threaded = true);
+  ~LFrameLoop();
+
+  bool threaded() const { return thread.joinable(); }
+
+  // Draw each frame in bands over pool (see LCanvas::setThreadPool). Call before startFrame().
+  void setThreadPool(LThreadPool *pool);
+
+  // Begin drawing the next frame into the back buffer. Starts one if none is in flight.
+  void startFrame();
+
+  /**
+   *  Wait for the frame in flight, make it the front buffer and return it; it stays unchanged
+   *  until the next call. Nothing is drawn between this and the next startFrame(), so that is the
+   *  place to change anything draw reads.
+   */
+  const GBitmap &nextFrame();
+
+  // The canvas that drew the front buffer. Only touched by the presenting thread.
+  LCanvas *frontCanvas() { return buffers[front].canvas.get(); }
+
+  // Counters of every frame nextFrame() has returned since creation or resetStats().
+  LStats stats() const { return totals; }
+  void resetStats() { totals = LStats(); }
+
+  // How long draw took, and the time between nextFrame() calls, over the last kTimedFrames.
+  LFrameTimes drawTimes() const;
+  LFrameTimes frameTimes() const;
+
+  static const int kTimedFrames = 240;
+
+private:
+  struct Buffer
+  {
+    LPooledBitmap pixels;
+    std::unique_ptr<LCanvas> canvas;
+  };
+
+  // The last kTimedFrames samples, oldest overwritten first.
+  struct Samples
+  {
+    std::vector<double> ms;
+    int next = 0;
+
+    void add(double value);
+    LFrameTimes percentiles() const;
+  };
+
+  DrawFrame draw;
+  Buffer buffers[2];
+  int front = 0;
+  int frame = 0;
+  bool inFlight = false;
+  LStats totals;
+  Samples frameMs;
+  std::chrono::steady_clock::time_point lastFrame;
+
+  std::thread thread;
+  mutable std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool pending = false;
+  bool quit = false;
+  Samples drawMs;
+
+  void drawBack();
+  void threadLoop();
+};
+
+#endif
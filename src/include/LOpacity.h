@@ -0,0 +1,129 @@
+#ifndef LOPACITYDEF
+#define LOPACITYDEF
+
+#include "GBlendMode.h"
+#include "GRect.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// What is known about a group of device pixels.
+enum class LOpacity : uint8_t
+{
+  kUnknown,
+  kOpaque, // every pixel has alpha 255
+  kClear,  // every pixel is 0
+};
+
+/**
+ *  The mode that gives exactly the same pixels as mode when the destination is known, e.g.
+ *  kSrcOver onto clear pixels is a kSrc copy and kDstOver onto opaque pixels leaves them alone
+ *  (kDst). Every reduction holds bit for bit with LPainter's integer blend math.
+ */
+static inline GBlendMode LReduceForDst(GBlendMode mode, LOpacity dst)
+{
+  if (dst == LOpacity::kOpaque)
+  {
+    switch (mode)
+    {
+    case GBlendMode::kDstOver:
+      return GBlendMode::kDst;
+    case GBlendMode::kSrcIn:
+      return GBlendMode::kSrc;
+    case GBlendMode::kSrcOut:
+      return GBlendMode::kClear;
+    case GBlendMode::kSrcATop:
+      return GBlendMode::kSrcOver;
+    case GBlendMode::kDstATop:
+      return GBlendMode::kDstIn;
+    case GBlendMode::kXor:
+      return GBlendMode::kDstOut;
+    default:
+      return mode;
+    }
+  }
+  if (dst == LOpacity::kClear)
+  {
+    switch (mode)
+    {
+    case GBlendMode::kSrc:
+    case GBlendMode::kSrcOver:
+    case GBlendMode::kDstOver:
+    case GBlendMode::kSrcOut:
+    case GBlendMode::kDstATop:
+    case GBlendMode::kXor:
+      return GBlendMode::kSrc;
+    default:
+      // Everything else leaves zero pixels at zero.
+      return GBlendMode::kDst;
+    }
+  }
+  return mode;
+}
+
+/**
+ *  What is known about pixels in state dst after drawing over them with mode (already
+ *  reduced). full says whether every pixel of the group was written; srcOpaque whether every
+ *  source pixel has alpha 255.
+ */
+static inline LOpacity LOpacityAfter(LOpacity dst, GBlendMode mode, bool srcOpaque, bool full)
+{
+  switch (mode)
+  {
+  case GBlendMode::kDst:
+  case GBlendMode::kSrcATop:
+    return dst;
+  case GBlendMode::kClear:
+    return full || dst == LOpacity::kClear ? LOpacity::kClear : LOpacity::kUnknown;
+  case GBlendMode::kSrc:
+    return srcOpaque && (full || dst == LOpacity::kOpaque) ? LOpacity::kOpaque : LOpacity::kUnknown;
+  case GBlendMode::kSrcOver:
+  case GBlendMode::kDstOver:
+    return dst == LOpacity::kOpaque || (srcOpaque && full) ? LOpacity::kOpaque : LOpacity::kUnknown;
+  case GBlendMode::kSrcIn:
+  case GBlendMode::kDstIn:
+  case GBlendMode::kDstOut:
+    return dst == LOpacity::kClear ? LOpacity::kClear : LOpacity::kUnknown;
+  default:
+    return LOpacity::kUnknown;
+  }
+}
+
+/**
+ *  Per-canvas record of which device pixels are known opaque or known clear, kept in cells one
+ *  row high and kCellWidth pixels wide. Cells start out unknown unless the device is declared
+ *  opaque.
+ */
+class LOpacityMap
+{
+public:
+  static const int kCellShift = 5;
+  static const int kCellWidth = 1 << kCellShift;
+
+  void reset(int width, int height, LOpacity state)
+  {
+    cellsPerRow = (width + kCellWidth - 1) >> kCellShift;
+    cells.assign((size_t)cellsPerRow * height, state);
+  }
+
+  // Forget what is known about the cells touching rect.
+  void invalidate(const GIRect &rect)
+  {
+    if (rect.isEmpty())
+      return;
+    int c0 = rect.left() >> kCellShift;
+    int c1 = (rect.right() + kCellWidth - 1) >> kCellShift;
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+      std::fill(row(y) + c0, row(y) + c1, LOpacity::kUnknown);
+    }
+  }
+
+  LOpacity *row(int y) { return cells.data() + (size_t)y * cellsPerRow; }
+
+private:
+  int cellsPerRow = 0;
+  std::vector<LOpacity> cells;
+};
+
+#endif
@@ -5,8 +5,11 @@
 #include "GPixel.h"
 #include "GColor.h"
 #include "GBlendMode.h"
+#include "GMatrix.h"
 #include "GPaint.h"
 #include "GShader.h"
+#include "LSimd.h"
+#include <cstddef>
 
 #define FLOATTOPXLINT(val) (GRoundToInt(val * 255))
 #define DIV255(val) ((val + 128) * 257 >> 16)
@@ -23,6 +26,18 @@ static inline GPixel createPixel(GColor color)
     return GPixel_PackARGB(a, r, g, b);
 }
 
+#if LSIMD
+// createPixel for a color held in (r, g, b, a) lanes.
+static inline GPixel createPixel(LF32x4 color)
+{
+    color = color < 1.0f ? color : 1.0f;
+    color = 0.0f < color ? color : 0.0f;
+    LF32x4 alpha = {color[3], color[3], color[3], 1.0f};
+    LI32x4 c = LFloorToInt(color * alpha * 255.0f + 0.5f);
+    return GPixel_PackARGB(c[3], c[0], c[1], c[2]);
+}
+#endif
+
 static inline GPixel scale255(GPixel pxl, uint8_t scale)
 {
     switch (scale)
@@ -132,6 +147,49 @@ static inline GPixel kMult(GPixel src, GPixel dst)
     return GPixel_PackARGB(a, r, g, b);
 }
 
+#if LSIMD
+// scale255 on four pixels, each with its own scale. The red/blue and alpha/green channel
+// pairs are each worked on in the two 16-bit halves of a lane.
+static inline LU32x4 scale255(LU32x4 pxl, LU32x4 scale)
+{
+    LU32x4 rb = (pxl & 0x00FF00FF) * scale + 0x00800080;
+    LU32x4 ag = ((pxl >> 8) & 0x00FF00FF) * scale + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return rb | ag;
+}
+
+static inline LU32x4 kSrcOver(LU32x4 src, LU32x4 dst)
+{
+    return src + scale255(dst, 255 - (src >> 24));
+}
+
+static inline LU32x4 kDstOver(LU32x4 src, LU32x4 dst)
+{
+    return dst + scale255(src, 255 - (dst >> 24));
+}
+
+static inline LU32x4 kSrcIn(LU32x4 src, LU32x4 dst)
+{
+    return scale255(src, dst >> 24);
+}
+
+static inline LU32x4 kDstIn(LU32x4 src, LU32x4 dst)
+{
+    return scale255(dst, src >> 24);
+}
+
+static inline LU32x4 kSrcOut(LU32x4 src, LU32x4 dst)
+{
+    return scale255(src, 255 - (dst >> 24));
+}
+
+static inline LU32x4 kDstOut(LU32x4 src, LU32x4 dst)
+{
+    return scale255(dst, 255 - (src >> 24));
+}
+#endif
+
 static inline GBlendMode translate0(GBlendMode mode)
 {
     switch ((int)mode)
@@ -264,16 +322,123 @@ static inline void paintRow(GPixel src[], GPixel dst[], int length, Painter pain
     }
 }
 
-typedef void (*Filler)(int, int, GPixel[], int, GShader *, GPixel);
+// Blends a whole row, so the mode is picked once per row rather than per pixel.
+typedef void (*RowPainter)(GPixel src[], GPixel dst[], int length);
+
+template <Painter painter>
+static void paintRowWith(GPixel src[], GPixel dst[], int length)
+{
+    paintRow(src, dst, length, painter);
+}
+
+#if LSIMD
+template <Painter painter, LU32x4 (*painter4)(LU32x4, LU32x4)>
+static void paintRowWith(GPixel src[], GPixel dst[], int length)
+{
+    int i = 0;
+    for (; i + 4 <= length; i += 4)
+    {
+        LStoreU32x4(dst + i, painter4(LLoadU32x4(src + i), LLoadU32x4(dst + i)));
+    }
+    for (; i < length; ++i)
+    {
+        dst[i] = painter(src[i], dst[i]);
+    }
+}
+#define LROWPAINTER(mode) paintRowWith<mode, mode>
+#else
+#define LROWPAINTER(mode) paintRowWith<mode>
+#endif
+
+static void clearRow(GPixel src[], GPixel dst[], int length)
+{
+    memset(dst, 0, length * sizeof(GPixel));
+}
+
+static void copyRow(GPixel src[], GPixel dst[], int length)
+{
+    memcpy(dst, src, length * sizeof(GPixel));
+}
+
+static void keepRow(GPixel src[], GPixel dst[], int length)
+{
+}
+
+static inline RowPainter modeToRowPainter(const GBlendMode mode)
+{
+    switch (mode)
+    {
+    case GBlendMode::kClear:
+        return clearRow;
+    case GBlendMode::kSrc:
+        return copyRow;
+    case GBlendMode::kDst:
+        return keepRow;
+    case GBlendMode::kSrcOver:
+        return LROWPAINTER(kSrcOver);
+    case GBlendMode::kDstOver:
+        return LROWPAINTER(kDstOver);
+    case GBlendMode::kSrcIn:
+        return LROWPAINTER(kSrcIn);
+    case GBlendMode::kDstIn:
+        return LROWPAINTER(kDstIn);
+    case GBlendMode::kSrcOut:
+        return LROWPAINTER(kSrcOut);
+    case GBlendMode::kDstOut:
+        return LROWPAINTER(kDstOut);
+    case GBlendMode::kSrcATop:
+        return paintRowWith<kSrcATop>;
+    case GBlendMode::kDstATop:
+        return paintRowWith<kDstATop>;
+    case GBlendMode::kXor:
+        return paintRowWith<kXor>;
+    default:
+        return clearRow;
+    }
+}
+
+/**
+ *  Storage for the context of one draw's shader (see GShader::makeContext), destroyed with it.
+ *  Empty when there is no shader, or when the CTM leaves it nothing to shade.
+ */
+class LShaderContext
+{
+public:
+    LShaderContext(const GShader *shader, const GMatrix &ctm)
+        : context(shader ? shader->makeContext(ctm, storage) : nullptr) {}
+    LShaderContext(const LShaderContext &) = delete;
+    LShaderContext &operator=(const LShaderContext &) = delete;
+    ~LShaderContext()
+    {
+        if (context)
+            context->~Context();
+    }
+
+    const GShader::Context *get() const { return context; }
+
+private:
+    alignas(std::max_align_t) unsigned char storage[GShader::kContextSize];
+    GShader::Context *context;
+};
+
+typedef void (*Filler)(int, int, GPixel[], int, const GShader::Context *, GPixel);
 
-static inline void shadeRow(int x, int y, GPixel dst[], int length, GShader *shader, GPixel base)
+static inline void shadeRow(int x, int y, GPixel dst[], int length, const GShader::Context *shader, GPixel base)
 {
     shader->shadeRow(x, y, length, dst);
 }
 
-static inline void fillRow(int x, int y, GPixel dst[], int length, GShader *shader, GPixel base)
+static inline void fillRow(int x, int y, GPixel dst[], int length, const GShader::Context *shader, GPixel base)
 {
-    for (int i = 0; i < length; ++i)
+    int i = 0;
+#if LSIMD
+    const LU32x4 base4 = {base, base, base, base};
+    for (; i + 4 <= length; i += 4)
+    {
+        LStoreU32x4(dst + i, base4);
+    }
+#endif
+    for (; i < length; ++i)
     {
         dst[i] = base;
     }
@@ -0,0 +1,162 @@
+#ifndef LPICTUREDEF
+#define LPICTUREDEF
+
+#include "GCanvas.h"
+#include "GMatrix.h"
+#include "GPaint.h"
+#include "GPath.h"
+#include "GRect.h"
+#include <memory>
+#include <vector>
+
+/**
+ *  A recorded clipRect or clipPath, already mapped to device space and chained to the clip it
+ *  was intersected with. Clips are immutable, so every op recorded under one shares it.
+ */
+struct LClipOp
+{
+  std::shared_ptr<const LClipOp> parent;
+  bool isRect;
+  GIRect rect;
+  GPath path;
+  // Device bounds of the whole chain; nothing outside them can be drawn.
+  GIRect bounds;
+
+  // Apply the chain to a canvas with an identity CTM.
+  void apply(GCanvas *canvas) const;
+};
+
+/**
+ *  One recorded draw call. Every op carries the CTM it was recorded with, so ops can be
+ *  replayed individually and in any subset (per tile, per damage rect, ...).
+ *
+ *  bounds is a conservative estimate of the device pixels the op can touch.
+ */
+struct LOp
+{
+  enum Type
+  {
+    kPaint,
+    kRect,
+    kPolygon,
+    kPath,
+    kMesh,
+    kQuad,
+    kPathInstances,
+    kLines,
+    kPolyline,
+  };
+
+  Type type;
+  GMatrix ctm;
+  GPaint paint;
+  GIRect bounds;
+  std::shared_ptr<const LClipOp> clip;
+
+  GRect rect;
+  GPath path;
+  std::vector<GPoint> verts;
+  std::vector<GColor> colors;
+  std::vector<GPoint> texs;
+  std::vector<int> indices;
+  std::vector<GMatrix> matrices;
+  int count = 0;
+
+  // Issue this op, with its clip, on a canvas that has an identity CTM and no clip.
+  void playback(GCanvas *canvas) const;
+
+  // Issue this op without touching the canvas clip.
+  void draw(GCanvas *canvas) const;
+};
+
+// True if op replaces every pixel it covers regardless of what was underneath.
+bool LOverwrites(const LOp &op);
+
+// True if op leaves every pixel as it was (its paint, or every instance color, reduces to kDst).
+bool LDrawsNothing(const LOp &op);
+
+/**
+ *  If op is guaranteed to paint every pixel of a device rect (e.g. a drawRect under a
+ *  scale/translate CTM), store that rect in covered and return true.
+ */
+bool LCoveredRect(const LOp &op, GIRect *covered);
+
+/**
+ *  Replays ops one at a time, re-applying the clip only when it differs from the previous op's.
+ *  The canvas must start with an identity CTM and no clip, and gets both back on destruction.
+ */
+class LPlayer
+{
+public:
+  LPlayer(GCanvas *canvas) : canvas(canvas) { canvas->save(); }
+  ~LPlayer() { canvas->restore(); }
+
+  void draw(const LOp &op);
+
+private:
+  GCanvas *canvas;
+  const LClipOp *current = nullptr;
+};
+
+/**
+ *  A list of recorded draws. Shaders are referenced, not copied, so they must outlive the
+ *  picture.
+ */
+class LPicture
+{
+public:
+  std::vector<LOp> ops;
+
+  void playback(GCanvas *canvas) const;
+
+  // Replay only the ops whose bounds intersect area.
+  void playback(GCanvas *canvas, const GIRect &area) const;
+
+  void reset() { ops.clear(); }
+};
+
+/**
+ *  A GCanvas that appends every draw to an LPicture instead of rasterizing it.
+ */
+class LRecorder : public GCanvas
+{
+public:
+  LRecorder(LPicture *picture) : picture(picture), ctm(GMatrix()) {}
+
+  void save() override;
+  void restore() override;
+  void concat(const GMatrix &matrix) override;
+  void clipRect(const GRect &rect) override;
+  void clipPath(const GPath &path) override;
+
+  void drawPaint(const GPaint &paint) override;
+  void drawRect(const GRect &rect, const GPaint &paint) override;
+  void drawConvexPolygon(const GPoint points[], int count, const GPaint &paint) override;
+  void drawPath(const GPath &path, const GPaint &paint) override;
+  void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint &paint) override;
+  void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint &paint) override;
+  void drawPathInstances(const GPath &path, const GMatrix matrices[], const GColor colors[], int count, const GPaint &paint) override;
+  void drawLines(const GPoint points[], int count, const GPaint &paint) override;
+  void drawPolyline(const GPoint points[], int count, const GPaint &paint) override;
+
+protected:
+  LPicture *picture;
+
+private:
+  struct State
+  {
+    GMatrix ctm;
+    std::shared_ptr<const LClipOp> clip;
+  };
+
+  std::vector<State> saveStates;
+  GMatrix ctm;
+  std::shared_ptr<const LClipOp> clip;
+
+  LOp &push(LOp::Type type, const GPaint &paint);
+  void pushClip(LClipOp *clipOp, GIRect bounds);
+  GIRect clipped(GIRect bounds) const;
+  GIRect deviceBounds(const GPoint points[], int count) const;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef LSIMDDEF
+#define LSIMDDEF
+
+#include <cstdint>
+#include <cstring>
+
+// Four-lane kernels written with GCC/Clang vector extensions, which lower to SIMD128 in the
+// -msimd128 wasm build and to SSE or NEON natively. LSIMD is 0 in the scalar wasm build and
+// with make SCALAR=1, and callers then use their plain loops. Every vector kernel gives the
+// same bits as the loop it stands in for.
+#if !defined(LSCALAR) && (defined(__wasm_simd128__) || defined(__SSE2__) || defined(__ARM_NEON))
+#define LSIMD 1
+#else
+#define LSIMD 0
+#endif
+
+#if LSIMD
+
+typedef uint32_t LU32x4 __attribute__((vector_size(16)));
+typedef int32_t LI32x4 __attribute__((vector_size(16)));
+typedef float LF32x4 __attribute__((vector_size(16)));
+typedef uint8_t LU8x16 __attribute__((vector_size(16)));
+
+static inline LU32x4 LLoadU32x4(const uint32_t *src)
+{
+  LU32x4 v;
+  memcpy(&v, src, sizeof(v));
+  return v;
+}
+
+static inline void LStoreU32x4(uint32_t *dst, LU32x4 v)
+{
+  memcpy(dst, &v, sizeof(v));
+}
+
+static inline LU8x16 LLoadU8x16(const uint8_t *src)
+{
+  LU8x16 v;
+  memcpy(&v, src, sizeof(v));
+  return v;
+}
+
+static inline void LStoreU8x16(uint8_t *dst, LU8x16 v)
+{
+  memcpy(dst, &v, sizeof(v));
+}
+
+static inline LF32x4 LLoadF32x4(const float *src)
+{
+  LF32x4 v;
+  memcpy(&v, src, sizeof(v));
+  return v;
+}
+
+static inline void LStoreF32x4(float *dst, LF32x4 v)
+{
+  memcpy(dst, &v, sizeof(v));
+}
+
+// floorf on each lane. Floats of 2^23 and up are already whole, which keeps the int round trip
+// in range.
+static inline LF32x4 LFloor(LF32x4 v)
+{
+  LF32x4 truncated = __builtin_convertvector(__builtin_convertvector(v, LI32x4), LF32x4);
+  LF32x4 floored = truncated > v ? truncated - 1.0f : truncated;
+  LF32x4 magnitude = v < 0.0f ? -v : v;
+  return magnitude >= 8388608.0f ? v : floored;
+}
+
+static inline LI32x4 LFloorToInt(LF32x4 v)
+{
+  return __builtin_convertvector(LFloor(v), LI32x4);
+}
+
+// x + {0, 1, 2, 3} as floats, the device x of four neighbouring pixels.
+static inline LF32x4 LPixelXs(int x)
+{
+  LI32x4 xs = {x, x + 1, x + 2, x + 3};
+  return __builtin_convertvector(xs, LF32x4);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef LSPMCQUEUEDEF
+#define LSPMCQUEUEDEF
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ *  A bounded lock-free queue with one producing thread and any number of consuming ones. Each
+ *  slot carries a sequence number saying whether it is waiting for the producer or for a
+ *  consumer, so push() is plain stores and pop() one compare-exchange on the head.
+ *
+ *  T must be default constructible and move assignable; popped slots are left moved-from.
+ */
+template <typename T>
+class LSpmcQueue
+{
+public:
+  // capacity is rounded up to a power of two.
+  explicit LSpmcQueue(size_t capacity)
+  {
+    size_t size = 1;
+    while (size < capacity)
+    {
+      size *= 2;
+    }
+    mask = size - 1;
+    slots.reset(new Slot[size]);
+    for (size_t i = 0; i < size; ++i)
+    {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LSpmcQueue(const LSpmcQueue &) = delete;
+  LSpmcQueue &operator=(const LSpmcQueue &) = delete;
+
+  // Producer only. Returns false, leaving value alone, if the queue is full.
+  bool push(T &value)
+  {
+    Slot &slot = slots[tail & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != tail)
+      return false;
+    slot.value = std::move(value);
+    slot.sequence.store(tail + 1, std::memory_order_release);
+    tail += 1;
+    return true;
+  }
+
+  // Any thread. Returns false if the queue is empty.
+  bool pop(T *value)
+  {
+    size_t pos = head.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;)
+    {
+      slot = &slots[pos & mask];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t ready = (intptr_t)(sequence - (pos + 1));
+      if (ready == 0)
+      {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (ready < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+    *value = std::move(slot->value);
+    // The slot is free for the producer's next lap around the ring.
+    slot->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  size_t mask;
+  // Consumers contend on head; keep the producer's tail off its cache line.
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) size_t tail = 0;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef LSTATSDEF
+#define LSTATSDEF
+
+#include <chrono>
+
+// Hot-path counters are compiled in only when LSTATS is defined (make STATS=1). Otherwise
+// LSTAT(...) and LSTAT_TIME(...) expand to nothing and LCanvas::stats() stays zero.
+#ifdef LSTATS
+#define LSTAT(statement) statement
+#define LSTAT_TIME(stats, phase) LStatTimer phaseTimer(&(stats).phaseNs[LStats::phase])
+#else
+#define LSTAT(statement)
+#define LSTAT_TIME(stats, phase)
+#endif
+
+/**
+ *  What a canvas has done since it was created or last reset. Draws are counted per entry
+ *  point, so a drawQuad also counts the drawMesh it turns into, and a rotated drawRect counts
+ *  as a drawConvexPolygon and a drawPath too.
+ */
+struct LStats
+{
+  enum Draw
+  {
+    kDrawPaint,
+    kDrawRect,
+    kDrawConvexPolygon,
+    kDrawPath,
+    kDrawMesh,
+    kDrawQuad,
+    kDrawPathInstances,
+    kDrawLines,
+    kDrawPolyline,
+    kDrawCount,
+  };
+
+  enum Phase
+  {
+    kGeometry, // transforming points and computing device bounds
+    kScan,     // turning edges into dots
+    kSort,     // sorting each row's dots
+    kPaint,    // walking rows, shading and blending
+    kPhaseCount,
+  };
+
+  static const int kBlendModeCount = 12;
+
+  long long draws[kDrawCount] = {};
+  long long edges = 0;
+  long long dots = 0;
+  // Rows paintBuffer looked at, and the ones that had any dots.
+  long long rowsVisited = 0;
+  long long rowsNonEmpty = 0;
+  // Pixels written, by the blend mode left after paintToMode's reductions.
+  long long pixels[kBlendModeCount] = {};
+  long long shaderRows = 0;
+  long long shaderPixels = 0;
+  long long sorts = 0;
+  long long sortedDots = 0;
+  int maxSortSize = 0;
+  long long phaseNs[kPhaseCount] = {};
+
+  void add(const LStats &other)
+  {
+    for (int i = 0; i < kDrawCount; ++i)
+      draws[i] += other.draws[i];
+    for (int i = 0; i < kBlendModeCount; ++i)
+      pixels[i] += other.pixels[i];
+    for (int i = 0; i < kPhaseCount; ++i)
+      phaseNs[i] += other.phaseNs[i];
+    edges += other.edges;
+    dots += other.dots;
+    rowsVisited += other.rowsVisited;
+    rowsNonEmpty += other.rowsNonEmpty;
+    shaderRows += other.shaderRows;
+    shaderPixels += other.shaderPixels;
+    sorts += other.sorts;
+    sortedDots += other.sortedDots;
+    maxSortSize = maxSortSize > other.maxSortSize ? maxSortSize : other.maxSortSize;
+  }
+};
+
+static inline const char *LDrawName(int draw)
+{
+  static const char *names[] = {"drawPaint", "drawRect", "drawConvexPolygon", "drawPath", "drawMesh", "drawQuad", "drawPathInstances",
+                                "drawLines", "drawPolyline"};
+  return names[draw];
+}
+
+static inline const char *LPhaseName(int phase)
+{
+  static const char *names[] = {"geometry", "scan", "sort", "paint"};
+  return names[phase];
+}
+
+static inline const char *LBlendModeName(int mode)
+{
+  static const char *names[] = {"kClear", "kSrc", "kDst", "kSrcOver", "kDstOver", "kSrcIn",
+                                "kDstIn", "kSrcOut", "kDstOut", "kSrcATop", "kDstATop", "kXor"};
+  return names[mode];
+}
+
+// Adds the lifetime of the enclosing scope to *ns.
+class LStatTimer
+{
+public:
+  LStatTimer(long long *ns) : ns(ns), start(std::chrono::steady_clock::now()) {}
+
+  ~LStatTimer()
+  {
+    *ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+private:
+  long long *ns;
+  std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LSTRIPRENDERERDEF
+#define LSTRIPRENDERERDEF
+
+#include "GBitmap.h"
+#include "LBitmapPool.h"
+#include "LCanvas.h"
+#include "LPicture.h"
+#include <functional>
+#include <memory>
+
+/**
+ *  Renders an LPicture for a device too large to hold in memory: the device is drawn top to
+ *  bottom in horizontal strips through one reusable strip bitmap, and each strip is handed to
+ *  a sink (e.g. an image encoder) as soon as it is finished. Only the ops touching a strip are
+ *  replayed into it, and scan conversion only produces dots for the strip's rows, so memory is
+ *  the strip plus the picture whatever the device size. Output matches drawing the picture
+ *  into the whole device.
+ */
+class LStripRenderer
+{
+public:
+  // Called once per strip, top to bottom: rows holds device rows [top, top + rows.height()).
+  // The pixels are only valid until the sink returns.
+  using Sink = std::function<void(const GBitmap &rows, int top)>;
+
+  LStripRenderer(int width, int height, int stripHeight = 256);
+
+  void render(const LPicture &picture, const Sink &sink);
+
+  int stripHeight() const { return strip.bitmap().height(); }
+
+  // Release scratch over the canvas budget; see LCanvas::trim. render() trims after each strip.
+  void trim() { canvas->trim(); }
+
+  LMemoryUsage memoryUsage() const { return canvas->memoryUsage(); }
+
+private:
+  const int width;
+  const int height;
+  LPooledBitmap strip;
+  std::unique_ptr<LCanvas> canvas;
+};
+
+#endif
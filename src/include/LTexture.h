@@ -0,0 +1,97 @@
+#ifndef LTEXTUREDEF
+#define LTEXTUREDEF
+
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GShader.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ *  The texture container: premultiplied GPixels exactly as they sit in a GBitmap, behind a
+ *  fixed header, so a file can be mapped and drawn from without decoding or copying.
+ *
+ *    offset  size
+ *    0       4     magic "LTEX"
+ *    4       4     version (1)
+ *    8       4     width
+ *    12      4     height
+ *    16      4     rowBytes, a multiple of kBitmapRowAlign
+ *    20      4     flags: kTextureOpaque if every pixel has alpha 0xFF
+ *    24      4     offset of the first row, a multiple of kBitmapRowAlign
+ *    28      36    zero
+ *
+ *  Fields are little-endian, as are the pixels. Rows are padded like LBitmapPool's, so mapped
+ *  textures get the same aligned row loads.
+ */
+struct LTextureHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t rowBytes;
+  uint32_t flags;
+  uint32_t pixelOffset;
+  uint32_t reserved[9];
+};
+
+static const uint32_t kTextureVersion = 1;
+static const uint32_t kTextureOpaque = 1 << 0;
+
+/**
+ *  A texture file mapped into memory. Pages are read in as the shader first touches them, so
+ *  opening a large library costs little until it is drawn from. The mapping is private: writes
+ *  to bitmap() stay in this process and never reach the file.
+ */
+class LMappedTexture
+{
+public:
+  ~LMappedTexture();
+
+  LMappedTexture(const LMappedTexture &) = delete;
+  LMappedTexture &operator=(const LMappedTexture &) = delete;
+
+  // The pixels, valid for the life of this object. Marked opaque if the header says so. Draw
+  // them with GCreateBitmapShader, which reads none of them until drawn with.
+  const GBitmap &bitmap() const { return fBitmap; }
+
+private:
+  friend std::unique_ptr<LMappedTexture> LMapTexture(const char *path);
+  LMappedTexture(const GBitmap &bitmap, void *mapping, size_t size) : fBitmap(bitmap), mapping(mapping), size(size) {}
+
+  GBitmap fBitmap;
+  void *mapping;
+  size_t size;
+};
+
+// Map the texture file at path. Returns nullptr if it cannot be read or is not a valid
+// container, e.g. a header that does not fit the file's size.
+std::unique_ptr<LMappedTexture> LMapTexture(const char *path);
+
+// Write bitmap to path as a texture container, working out the opaque flag. Returns false if
+// the file could not be written.
+bool LWriteTexture(const char *path, const GBitmap &bitmap);
+
+/**
+ *  How a bitmap shader stores its pixels. Row-major is the bitmap as given. The others keep a
+ *  reordered copy so that samples near each other in 2D are near each other in memory, which
+ *  keeps a rotated or scaled-down fill from missing cache on nearly every pixel: 4x4 blocks
+ *  are one 64-byte line each, 8x8 blocks four, and Morton (Z) order nests blocks of every size.
+ *  Output is identical whatever the layout.
+ */
+enum class LTextureLayout
+{
+  kRowMajor,
+  kBlocked4x4,
+  kBlocked8x8,
+  kMorton,
+};
+
+// GCreateBitmapShader storing the pixels in layout. Any layout but kRowMajor copies them at
+// creation, so the bitmap need not outlive the shader then; Morton pads each side to a power
+// of two.
+std::unique_ptr<GShader> LCreateBitmapShader(const GBitmap &bitmap, const GMatrix &localMatrix, GShader::TileMode mode, LTextureLayout layout);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef LTHREADPOOLDEF
+#define LTHREADPOOLDEF
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ *  A fixed set of workers that run indexed jobs. Each worker owns a deque of indices; it pops
+ *  from the back of its own and, once that runs dry, steals from the front of the others.
+ *
+ *  The calling thread takes part as worker 0, so a pool of 1 runs everything inline. Builds
+ *  without thread support always get a pool of 1.
+ */
+class LThreadPool
+{
+public:
+  typedef std::function<void(int index, int worker)> Job;
+
+  // threads <= 0 means one per hardware thread.
+  explicit LThreadPool(int threads = 0);
+  ~LThreadPool();
+
+  // Total number of workers, including the calling thread.
+  int count() const { return numWorkers; }
+
+  // Run job(i, worker) for every i in [0, count) and return once all of them have finished.
+  void parallelFor(int count, const Job &job);
+
+private:
+  struct Queue
+  {
+    std::mutex lock;
+    std::deque<int> indices;
+  };
+
+  int numWorkers;
+  std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<Queue>> queues;
+
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable done;
+  const Job *job = nullptr;
+  int generation = 0;
+  int busy = 0;
+  bool quit = false;
+
+  void workerLoop(int worker);
+  void runJobs(int worker);
+  bool next(int worker, int *index);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef LTILERENDERERDEF
+#define LTILERENDERERDEF
+
+#include "GBitmap.h"
+#include "LCanvas.h"
+#include "LPicture.h"
+#include "LThreadPool.h"
+
+/**
+ *  Renders an LPicture by binning its ops into square tiles and drawing each tile's ops start
+ *  to finish before moving on, so a tile's pixels stay in cache across the whole op list.
+ *  Tiles are spread over a work-stealing pool. Output matches drawing the ops directly.
+ */
+class LTileRenderer
+{
+public:
+  LTileRenderer(const GBitmap &device, int tileSize = 64, int threads = 0);
+
+  void render(const LPicture &picture);
+
+  int threadCount() const { return pool.count(); }
+
+  // Release worker scratch over the canvas budget; see LCanvas::trim.
+  void trim()
+  {
+    for (const std::unique_ptr<LCanvas> &canvas : canvases)
+    {
+      canvas->trim();
+    }
+  }
+
+  // Counters summed over the worker canvases. All zero unless built with LSTATS.
+  LStats stats() const
+  {
+    LStats total;
+    for (const std::unique_ptr<LCanvas> &canvas : canvases)
+    {
+      total.add(canvas->stats());
+    }
+    return total;
+  }
+
+private:
+  const GBitmap fDevice;
+  const int tileSize;
+  const int tilesX;
+  const int tilesY;
+  LThreadPool pool;
+  std::vector<std::unique_ptr<LCanvas>> canvases;
+  std::vector<std::vector<int>> bins;
+
+  // Fill bins with the indices of the ops that touch each tile.
+  void binOps(const LPicture &picture);
+};
+
+/**
+ *  A GCanvas front end for LTileRenderer: draws are recorded until flush().
+ */
+class LTileCanvas : public LRecorder
+{
+public:
+  LTileCanvas(const GBitmap &device, int tileSize = 64, int threads = 0) : LRecorder(&frame), renderer(device, tileSize, threads) {}
+
+  void flush()
+  {
+    renderer.render(frame);
+    frame.reset();
+  }
+
+private:
+  LPicture frame;
+  LTileRenderer renderer;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef LTRACEDEF
+#define LTRACEDEF
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ *  Scoped trace events in Chrome trace-event format (chrome://tracing, ui.perfetto.dev).
+ *
+ *  Tracing is compiled in everywhere and switched at run time. While it is off, an LTRACE scope
+ *  costs one relaxed load and a branch. While it is on, each thread appends complete events to
+ *  its own fixed-size ring, so the newest events win and nothing is locked on the hot path.
+ *  Starting, stopping and dumping are safe while other threads record. A thread's ring is kept
+ *  after it exits, for a dump after a pool shuts down, but only the last few such rings.
+ *  Scope names must be string literals (or otherwise outlive the trace).
+ */
+
+extern std::atomic<bool> gLTraceEnabled;
+
+static inline bool LTraceEnabled()
+{
+  return gLTraceEnabled.load(std::memory_order_relaxed);
+}
+
+// Start recording, dropping any events from an earlier trace.
+void LTraceStart();
+
+// Stop recording. Events stay around for LTraceJSON.
+void LTraceStop();
+
+// Name the calling thread in the trace output, e.g. "worker 2".
+void LTraceSetThreadName(const std::string &name);
+
+// The recorded events as a Chrome trace JSON document. Events still being recorded while it runs
+// may be left out.
+std::string LTraceJSON();
+
+// Write LTraceJSON() to path. Returns false if the file could not be written.
+bool LTraceWrite(const char *path);
+
+void LTraceRecord(const char *name, long long startNs, long long endNs);
+
+long long LTraceNow();
+
+class LTraceScope
+{
+public:
+  LTraceScope(const char *name) : name(LTraceEnabled() ? name : nullptr)
+  {
+    if (this->name)
+    {
+      start = LTraceNow();
+    }
+  }
+
+  ~LTraceScope()
+  {
+    if (name)
+    {
+      LTraceRecord(name, start, LTraceNow());
+    }
+  }
+
+private:
+  const char *name;
+  long long start = 0;
+};
+
+#define LTRACE_JOIN2(a, b) a##b
+#define LTRACE_JOIN(a, b) LTRACE_JOIN2(a, b)
+#define LTRACE(name) LTraceScope LTRACE_JOIN(traceScope, __LINE__)(name)
+
+#endif
@@ -5,144 +5,104 @@
 #include "LUtil.h"
 #include "LPainter.h"
 
-class LTriShader : public GShader
+/**
+ *  Shading for one mesh triangle with per-vertex colors: the colors are interpolated in the
+ *  triangle's own coordinates. Built per triangle on the stack; never touches the paint's
+ *  shader.
+ */
+class LColorContext : public GShader::Context
 {
 public:
-  virtual void init(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GColor &c0, const GColor &c1, const GColor &c2) {}
-  virtual void init(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPoint &t0, const GPoint &t1, const GPoint &t2) {}
-};
-
-class LColorShader : public LTriShader
-{
-public:
-  LColorShader() {}
-
-  void init(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GColor &c0, const GColor &c1, const GColor &c2) override
+  // Returns false if the triangle has no area under ctm, leaving nothing to shade.
+  bool init(const GMatrix &ctm, const GPoint &p0, const GPoint &p1, const GPoint &p2, const GColor &c0, const GColor &c1, const GColor &c2)
   {
     _c0 = c0;
-    _c1 = c1;
-    _c2 = c2;
-    m[GMatrix::SX] = p1.x() - p0.x();
-    m[GMatrix::KX] = p2.x() - p0.x();
-    m[GMatrix::TX] = p0.x();
-    m[GMatrix::KY] = p1.y() - p0.y();
-    m[GMatrix::SY] = p2.y() - p0.y();
-    m[GMatrix::TY] = p0.y();
+    d1 = c1 - c0;
+    d2 = c2 - c0;
+    opaque = c0.a == 1.0f && c1.a == 1.0f && c2.a == 1.0f;
+    GMatrix m(p1.x() - p0.x(), p2.x() - p0.x(), p0.x(), p1.y() - p0.y(), p2.y() - p0.y(), p0.y());
+    return (ctm * m).invert(&invContext);
   }
 
-  bool isOpaque() override
-  {
-    return _c0.a == 1.0f && _c1.a == 1.0f && _c2.a == 1.0f;
-  }
+  bool isOpaque() const { return opaque; }
 
-  bool setContext(const GMatrix &ctm) override
+  void shadeRow(int x, int y, int count, GPixel row[]) const override
   {
-    GMatrix context = ctm * m;
-    return context.invert(&invContext);
-  }
-
-  void shadeRow(int x, int y, int count, GPixel row[]) override
-  {
-    GPoint vec{x + 0.5f, y + 0.5f};
-    GPoint local = invContext * vec;
-    GColor c = local.x() * (_c1 - _c0) + local.y() * (_c2 - _c0) + _c0;
-    GColor dc = invContext[GMatrix::SX] * (_c1 - _c0) + invContext[GMatrix::KY] * (_c2 - _c0);
-    for (int i = 0; i < count; ++i, c += dc)
+    GPoint origin = invContext * GPoint{0.5f, y + 0.5f};
+    float dx = invContext[GMatrix::SX];
+    float dy = invContext[GMatrix::KY];
+    int i = 0;
+#if LSIMD
+    const LF32x4 c0 = LLoadF32x4(&_c0.r);
+    const LF32x4 d14 = LLoadF32x4(&d1.r);
+    const LF32x4 d24 = LLoadF32x4(&d2.r);
+    for (; i + 4 <= count; i += 4)
     {
-      row[i] = createPixel(c);
+      LF32x4 px = LPixelXs(x + i);
+      LF32x4 u = origin.x() + px * dx;
+      LF32x4 v = origin.y() + px * dy;
+      for (int k = 0; k < 4; ++k)
+      {
+        row[i + k] = createPixel(u[k] * d14 + v[k] * d24 + c0);
+      }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+      float px = x + i;
+      row[i] = createPixel((origin.x() + px * dx) * d1 + (origin.y() + px * dy) * d2 + _c0);
     }
   }
 
 private:
   GColor _c0;
-  GColor _c1;
-  GColor _c2;
+  GColor d1;
+  GColor d2;
+  bool opaque;
   GMatrix invContext;
-  GMatrix m;
 };
 
-class LProxyShader : public LTriShader
+/**
+ *  The matrix taking a triangle's texture coordinates t0..t2 to its points p0..p2. A textured
+ *  triangle is shaded by the paint's shader with this concatenated onto the CTM. Returns false if
+ *  the texture coordinates have no area.
+ */
+static inline bool LTexToPoints(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPoint &t0, const GPoint &t1, const GPoint &t2, GMatrix *m)
 {
-public:
-  LProxyShader(GShader *shader) : real(shader) {}
-
-  void init(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPoint &t0, const GPoint &t1, const GPoint &t2) override
-  {
-    GPoint tD1 = t1 - t0;
-    GPoint tD2 = t2 - t0;
-    GMatrix t(tD1.x(), tD2.x(), t0.x(), tD1.y(), tD2.y(), t0.y());
-    GPoint pD1 = p1 - p0;
-    GPoint pD2 = p2 - p0;
-    GMatrix p(pD1.x(), pD2.x(), p0.x(), pD1.y(), pD2.y(), p0.y());
-    t.invert(&t);
-    m = p * t;
-  }
-
-  bool isOpaque() override
-  {
-    return real->isOpaque();
-  }
-
-  bool setContext(const GMatrix &ctm) override
-  {
-    return real->setContext(ctm * m);
-  }
-
-  void shadeRow(int x, int y, int count, GPixel row[]) override
-  {
-    real->shadeRow(x, y, count, row);
-  }
-
-private:
-  GShader *real;
-  GMatrix m;
-};
-
-class LComposeShader : public LTriShader
+  GPoint tD1 = t1 - t0;
+  GPoint tD2 = t2 - t0;
+  GMatrix t(tD1.x(), tD2.x(), t0.x(), tD1.y(), tD2.y(), t0.y());
+  GPoint pD1 = p1 - p0;
+  GPoint pD2 = p2 - p0;
+  GMatrix p(pD1.x(), pD2.x(), p0.x(), pD1.y(), pD2.y(), p0.y());
+  if (!t.invert(&t))
+    return false;
+  *m = p * t;
+  return true;
+}
+
+// A triangle with both colors and texture coordinates: the two shadings multiplied.
+class LComposeContext : public GShader::Context
 {
 public:
-  LComposeShader(LTriShader *first, LTriShader *second) : shader0(first), shader1(second) {}
-  LComposeShader(GShader *shader)
-  {
-    shader0 = new LColorShader();
-    shader1 = new LProxyShader(shader);
-  }
+  LComposeContext(const GShader::Context *colors, const GShader::Context *texture) : colors(colors), texture(texture) {}
 
-  ~LComposeShader()
+  void shadeRow(int x, int y, int count, GPixel row[]) const override
   {
-    delete shader0;
-    delete shader1;
-  }
-
-  void init(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GColor &c0, const GColor &c1, const GColor &c2) override
-  {
-    shader0->init(p0, p1, p2, c0, c1, c2);
-  }
-
-  void init(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPoint &t0, const GPoint &t1, const GPoint &t2) override
-  {
-    shader1->init(p0, p1, p2, t0, t1, t2);
-  }
-
-  bool isOpaque() override
-  {
-    return shader0->isOpaque() && shader1->isOpaque();
-  }
-
-  bool setContext(const GMatrix &ctm) override
-  {
-    return shader0->setContext(ctm) && shader1->setContext(ctm);
-  }
-
-  void shadeRow(int x, int y, int count, GPixel row[]) override
-  {
-    std::vector<GPixel> temp(count);
-    shader0->shadeRow(x, y, count, temp.data());
-    shader1->shadeRow(x, y, count, row);
-    paintRow(temp.data(), row, count, kMult);
+    // Shading depends only on the device x, so the row can be done in pieces.
+    GPixel temp[kChunk];
+    for (int i = 0; i < count; i += kChunk)
+    {
+      int n = std::min(kChunk, count - i);
+      colors->shadeRow(x + i, y, n, temp);
+      texture->shadeRow(x + i, y, n, row + i);
+      paintRow(temp, row + i, n, kMult);
+    }
   }
 
 private:
-  LTriShader *shader0;
-  LTriShader *shader1;
-};
\ No newline at end of file
+  static constexpr int kChunk = 256;
+
+  const GShader::Context *colors;
+  const GShader::Context *texture;
+};
@@ -1,4 +1,5 @@
 #include "GCanvas.h"
+#include "LCanvas.h"
 #include "GPixel.h"
 #include "GBitmap.h"
 #include "GRect.h"
@@ -9,20 +10,35 @@
 #include "GShader.h"
 #include "LUtil.h"
 #include "LTriShader.h"
+#include "LClip.h"
+#include "LCoverage.h"
+#include "LOpacity.h"
+#include "LStats.h"
+#include "LThreadPool.h"
+#include "LTrace.h"
+#include <memory>
 #include <vector>
 
-class MyCanvas : public GCanvas
+class MyCanvas : public LCanvas
 {
 public:
-  MyCanvas(const GBitmap &device) : fDevice(device), screenRect(GIRect::MakeLTRB(0, 0, device.width(), device.height())), rowBuffer(device.width(), 0), columnBuffer(device.height()), ctm(GMatrix()) {}
+  // deviceHeight is the height of the device the bitmap is a strip of; see setStrip().
+  MyCanvas(const GBitmap &device, int deviceHeight) : fDevice(device), deviceHeight(deviceHeight), screenRect(stripRect()), clipBounds(screenRect), columnBuffer(deviceHeight), ctm(GMatrix())
+  {
+    lanes.resize(1);
+    lanes[0].rowBuffer.resize(device.width());
+    opacity.reset(device.width(), device.height(), initialOpacity());
+  }
 
   void drawPaint(const GPaint &paint) override
   {
-    paintRect(screenRect, paint);
+    LSTAT(counters.draws[LStats::kDrawPaint]++);
+    paintRect(clipBounds, paint);
   }
 
   void drawRect(const GRect &rect, const GPaint &paint) override
   {
+    LSTAT(counters.draws[LStats::kDrawRect]++);
     const GIRect rounded = rect.round();
     if (ctm == GMatrix())
     {
@@ -39,6 +55,7 @@ public:
 
   void drawConvexPolygon(const GPoint points[], int count, const GPaint &paint) override
   {
+    LSTAT(counters.draws[LStats::kDrawConvexPolygon]++);
     GPath path;
     path.addPolygon(points, count);
     drawPath(path, paint);
@@ -46,47 +63,138 @@ public:
 
   void drawPath(const GPath &path, const GPaint &paint) override
   {
+    LSTAT(counters.draws[LStats::kDrawPath]++);
+    LTRACE("drawPath");
     const GBlendMode mode = paintToMode(paint);
     if (mode == GBlendMode::kDst)
       return;
+    LShaderContext shading(paint.getShader(), ctm);
+    if (paint.getShader() && !shading.get())
+      return;
+
+    GRect deviceBounds;
+    {
+      LTRACE("geometry");
+      LSTAT_TIME(counters, kGeometry);
+      devicePath = path;
+      devicePath.transform(ctm);
+      deviceBounds = devicePath.bounds();
+    }
+    // Reject before any curve is flattened into dots.
+    if (!deviceBounds.roundOut().intersects(clipBounds))
+      return;
+    GIRect bounds = deviceBounds.round();
+    int top = CLAMP(bounds.top(), clipBounds.top(), clipBounds.bottom());
+    int bottom = CLAMP(bounds.bottom(), clipBounds.top(), clipBounds.bottom());
+    {
+      LTRACE("scan");
+      LSTAT_TIME(counters, kScan);
+      [[maybe_unused]] int numEdges = LPathToDots(columnBuffer, devicePath, clipBounds);
+      LSTAT(counters.edges += numEdges);
+    }
+    paintBuffer(top, bottom, makeBrush(paint, shading.get()));
+  }
+
+  void drawPathInstances(const GPath &path, const GMatrix matrices[], const GColor colors[], int count, const GPaint &paint) override
+  {
+    LSTAT(counters.draws[LStats::kDrawPathInstances]++);
+    LTRACE("drawPathInstances");
+    if (count <= 0)
+      return;
+    {
+      LTRACE("geometry");
+      LSTAT_TIME(counters, kGeometry);
+      float scale = 0;
+      for (int i = 0; i < count; ++i)
+      {
+        scale = std::max(scale, LMaxScale(ctm * matrices[i]));
+      }
+      instanceEdges.clear();
+      LFlattenPath(path, scale, [this](const GPoint &p0, const GPoint &p1)
+                   { instanceEdges.push_back(p0);
+                     instanceEdges.push_back(p1); });
+    }
+    if (instanceEdges.empty())
+      return;
+    instanceBounds = GRect::MakeXYWH(instanceEdges[0].x(), instanceEdges[0].y(), 0, 0);
+    for (GPoint &p : instanceEdges)
+    {
+      GRect pt = GRect::MakeXYWH(p.x(), p.y(), 0, 0);
+      instanceBounds = PathUtil::unite(instanceBounds, pt);
+    }
+    // Stamps are of this path only.
+    stamps.clear();
+    nextStamp = 0;
 
-    GPath dupPath = GPath(path);
-    dupPath.transform(ctm);
-    GIRect bounds = dupPath.bounds().round();
-    int top = CLAMP(bounds.top(), screenRect.top(), screenRect.bottom());
-    int bottom = CLAMP(bounds.bottom(), screenRect.top(), screenRect.bottom());
-    LPathToDots(columnBuffer, dupPath, screenRect);
-    paintBuffer(top, bottom, paint);
+    GPaint instancePaint(paint);
+    for (int i = 0; i < count; ++i)
+    {
+      if (colors)
+      {
+        instancePaint.setColor(colors[i]);
+      }
+      if (paintToMode(instancePaint) == GBlendMode::kDst)
+        continue;
+      const GMatrix m = ctm * matrices[i];
+      LShaderContext shading(paint.getShader(), m);
+      if (paint.getShader() && !shading.get())
+        continue;
+      const Brush brush = makeBrush(instancePaint, shading.get());
+      int dx, dy;
+      if (const Stamp *stamp = findStamp(m, &dx, &dy))
+      {
+        paintStamp(*stamp, dx, dy, brush);
+      }
+      else
+      {
+        fillInstance(m, brush);
+      }
+    }
+  }
+
+  void drawLines(const GPoint points[], int count, const GPaint &paint) override
+  {
+    LSTAT(counters.draws[LStats::kDrawLines]++);
+    LTRACE("drawLines");
+    drawHairlines(points, count, 2, paint);
+  }
+
+  void drawPolyline(const GPoint points[], int count, const GPaint &paint) override
+  {
+    LSTAT(counters.draws[LStats::kDrawPolyline]++);
+    LTRACE("drawPolyline");
+    drawHairlines(points, count, 1, paint);
   }
 
   void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint &paint) override
   {
+    LSTAT(counters.draws[LStats::kDrawMesh]++);
+    LTRACE("drawMesh");
     const GBlendMode mode = paintToMode(paint);
     if (mode == GBlendMode::kDst || count == 0)
       return;
-    GPaint meshPaint = GPaint();
-    meshPaint.setBlendMode(mode);
-    meshPaint.setRGBA(0, 0, 0, 1);
-
-    bool hasColors = colors != nullptr;
-    bool hasTexs = texs != nullptr;
-    LTriShader *triShader = nullptr;
-    if (hasColors && hasTexs)
-      triShader = new LComposeShader(paint.getShader());
-    else if (hasColors)
-      triShader = new LColorShader();
-    else if (hasTexs)
-      triShader = new LProxyShader(paint.getShader());
-    meshPaint.setShader(triShader);
     int numVerts = 0;
     for (int i = 0; i < count * 3; i++)
     {
       numVerts = std::max(numVerts, indices[i] + 1);
     }
+    meshVerts.resize(numVerts);
+    {
+      LTRACE("geometry");
+      LSTAT_TIME(counters, kGeometry);
+      ctm.mapPoints(meshVerts.data(), verts, numVerts);
+    }
+    if (!intersectsClip(meshVerts.data(), numVerts))
+      return;
+
+    bool hasColors = colors != nullptr;
+    // texs only mean something with a shader to look them up in.
+    bool hasTexs = texs != nullptr && paint.getShader() != nullptr;
+    const GShader *shader = hasTexs ? paint.getShader() : nullptr;
+    // With neither, triangles are filled opaque black.
+    const GPixel black = GPixel_PackARGB(255, 0, 0, 0);
 
     int vIdx = 0;
-    std::vector<GPoint> mappedverts(numVerts);
-    ctm.mapPoints(mappedverts.data(), verts, numVerts);
     for (int i = 0; i < count; ++i, vIdx += 3)
     {
       int idx0 = indices[vIdx];
@@ -95,36 +203,54 @@ public:
       GPoint p0 = verts[idx0];
       GPoint p1 = verts[idx1];
       GPoint p2 = verts[idx2];
+      // Every triangle gets contexts of its own on the stack; the paint's shader is only read.
+      LColorContext colorContext;
+      bool opaque = true;
       if (hasColors)
       {
-        triShader->init(p0, p1, p2, colors[idx0], colors[idx1], colors[idx2]);
+        if (!colorContext.init(ctm, p0, p1, p2, colors[idx0], colors[idx1], colors[idx2]))
+          continue;
+        opaque = colorContext.isOpaque();
       }
+      GMatrix texToPoints;
+      if (hasTexs && !LTexToPoints(p0, p1, p2, texs[idx0], texs[idx1], texs[idx2], &texToPoints))
+        continue;
+      LShaderContext texContext(shader, ctm * texToPoints);
       if (hasTexs)
       {
-        triShader->init(p0, p1, p2, texs[idx0], texs[idx1], texs[idx2]);
+        if (!texContext.get())
+          continue;
+        opaque = opaque && shader->isOpaque();
       }
-      paintTriangle(mappedverts[idx0], mappedverts[idx1], mappedverts[idx2], meshPaint);
+      LComposeContext composed(&colorContext, texContext.get());
+      const GShader::Context *shading = hasTexs ? (hasColors ? &composed : texContext.get()) : (hasColors ? &colorContext : nullptr);
+      const GBlendMode triangleMode = opaque ? translate255(mode) : mode;
+      paintTriangle(meshVerts[idx0], meshVerts[idx1], meshVerts[idx2],
+                    {shading ? shadeRow : fillRow, modeToRowPainter(triangleMode), shading, black, triangleMode, opaque});
     }
-
-    delete triShader;
   }
 
   void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint &paint) override
   {
+    LSTAT(counters.draws[LStats::kDrawQuad]++);
+    // The patch lies inside the hull of its corners, so this rejects before tessellating.
+    GPoint corners[4];
+    ctm.mapPoints(corners, verts, 4);
+    if (!intersectsClip(corners, 4))
+      return;
+
     int numDiv = level + 1;
     int numPts = level + 2;
     float step = 1.0f / numDiv;
-    std::vector<GPoint> lerpVerts;
-    std::vector<GColor> lerpColors;
-    std::vector<GPoint> lerpTexs;
-    quadLerp(lerpVerts, verts[0], verts[1], verts[2], verts[3], numPts, step);
+    quadLerp(quadVerts, verts[0], verts[1], verts[2], verts[3], numPts, step);
     if (colors)
-      quadLerp(lerpColors, colors[0], colors[1], colors[2], colors[3], numPts, step);
+      quadLerp(quadColors, colors[0], colors[1], colors[2], colors[3], numPts, step);
     if (texs)
-      quadLerp(lerpTexs, texs[0], texs[1], texs[2], texs[3], numPts, step);
+      quadLerp(quadTexs, texs[0], texs[1], texs[2], texs[3], numPts, step);
 
     int numTri = numDiv * numDiv * 2;
-    std::vector<int> indices(numTri * 3);
+    std::vector<int> &indices = quadIndices;
+    indices.resize(numTri * 3);
     int anchor = 0;
     int idx = 0;
     for (int i = 0; i < numDiv; ++i)
@@ -143,33 +269,356 @@ public:
       }
       ++anchor;
     }
-    drawMesh(lerpVerts.data(), lerpColors.size() > 0 ? lerpColors.data() : nullptr, lerpTexs.size() > 0 ? lerpTexs.data() : nullptr, numTri, indices.data(), paint);
+    drawMesh(quadVerts.data(), colors ? quadColors.data() : nullptr, texs ? quadTexs.data() : nullptr, numTri, indices.data(), paint);
   }
 
   void save() override
   {
-    saveStates.push_back(GMatrix(ctm));
+    saveStates.push_back({ctm, clipBounds, clipMask});
   }
 
   void restore() override
   {
-    ctm = saveStates.back();
+    const State &state = saveStates.back();
+    ctm = state.ctm;
+    clipBounds = state.clipBounds;
+    clipMask = state.clipMask;
     saveStates.pop_back();
   }
 
+  void clipRect(const GRect &rect) override
+  {
+    GIRect device;
+    if (LMapRectToDevice(ctm, rect, &device))
+    {
+      // Axis-aligned clips only shrink the bounds every draw is already clamped to.
+      intersectClip(device);
+      return;
+    }
+    GPath path;
+    path.addRect(rect);
+    clipPath(path);
+  }
+
+  void clipPath(const GPath &path) override
+  {
+    devicePath = path;
+    devicePath.transform(ctm);
+    intersectClip(devicePath.bounds().roundOut());
+    if (clipBounds.isEmpty())
+      return;
+
+    std::shared_ptr<LClipMask> mask = std::make_shared<LClipMask>();
+    mask->bounds = clipBounds;
+    mask->rows.resize(clipBounds.height());
+    LPathToDots(columnBuffer, devicePath, clipBounds);
+    std::vector<LSpan> &spans = clipSpans;
+    for (int y = clipBounds.top(); y < clipBounds.bottom(); ++y)
+    {
+      std::vector<LDot> &row = columnBuffer[y];
+      LSortRow(row.data(), row.size());
+      std::vector<LSpan> &maskRow = mask->rows[y - clipBounds.top()];
+      if (clipMask)
+      {
+        spans.clear();
+        LWalkRow(row.data(), row.size(), [&](int x0, int x1)
+                 { spans.push_back({x0, x1}); });
+        LIntersectSpans(spans, clipMask->row(y), maskRow);
+      }
+      else
+      {
+        LWalkRow(row.data(), row.size(), [&](int x0, int x1)
+                 { maskRow.push_back({x0, x1}); });
+      }
+      row.clear();
+    }
+    clipMask = mask;
+  }
+
   void concat(const GMatrix &matrix) override
   {
     ctm.preConcat(matrix);
   }
 
+  void setBounds(const GIRect &bounds) override
+  {
+    screenRect = clipRects(bounds, stripRect());
+    clipBounds = screenRect;
+    clipMask.reset();
+    // Another canvas may have drawn here since this one last did.
+    opacity.invalidate(GIRect::MakeLTRB(screenRect.left(), screenRect.top() - stripTop, screenRect.right(), screenRect.bottom() - stripTop));
+  }
+
+  void setStrip(int top) override
+  {
+    stripTop = top;
+    screenRect = stripRect();
+    clipBounds = screenRect;
+    clipMask.reset();
+    opacity.reset(fDevice.width(), fDevice.height(), initialOpacity());
+  }
+
+  void setCoverage(LCoverage *newCoverage, int order, bool claim) override
+  {
+    coverage = newCoverage;
+    coverageOrder = order;
+    coverageClaim = claim;
+  }
+
+  void setOpacityTracking(bool enabled) override
+  {
+    trackOpacity = enabled;
+    opacity.reset(fDevice.width(), fDevice.height(), initialOpacity());
+  }
+
+  void invalidateOpacity() override
+  {
+    opacity.reset(fDevice.width(), fDevice.height(), initialOpacity());
+  }
+
+  void setThreadPool(LThreadPool *newPool) override
+  {
+    pool = newPool;
+    lanes.resize(pool ? pool->count() : 1);
+    for (Lane &lane : lanes)
+    {
+      lane.rowBuffer.resize(fDevice.width());
+    }
+  }
+
+  LStats stats() const override
+  {
+    LStats total = counters;
+    for (const Lane &lane : lanes)
+    {
+      total.add(lane.counters);
+    }
+    return total;
+  }
+
+  void resetStats() override
+  {
+    counters = LStats();
+    for (Lane &lane : lanes)
+    {
+      lane.counters = LStats();
+    }
+  }
+
+  LMemoryUsage memoryUsage() const override
+  {
+    LMemoryUsage usage;
+    usage.columnBuffer = columnBuffer.capacity() * sizeof(std::vector<LDot>);
+    for (const std::vector<LDot> &row : columnBuffer)
+    {
+      usage.columnBuffer += row.capacity() * sizeof(LDot);
+    }
+    usage.columnBuffer += stampDots.capacity() * sizeof(std::vector<LDot>);
+    for (const std::vector<LDot> &row : stampDots)
+    {
+      usage.columnBuffer += row.capacity() * sizeof(LDot);
+    }
+    for (const Lane &lane : lanes)
+    {
+      usage.rowBuffer += lane.rowBuffer.capacity() * sizeof(GPixel);
+      usage.other += lane.visibleSpans.capacity() * sizeof(LSpan);
+    }
+    // GPath does not expose its capacity, so the path copy is estimated from its size.
+    usage.geometry = devicePath.countPoints() * (sizeof(GPoint) + sizeof(GPath::Verb)) +
+                     meshVerts.capacity() * sizeof(GPoint) + quadVerts.capacity() * sizeof(GPoint) +
+                     quadColors.capacity() * sizeof(GColor) + quadTexs.capacity() * sizeof(GPoint) +
+                     quadIndices.capacity() * sizeof(int) +
+                     (linePoints.capacity() + instanceEdges.capacity() + instancePoints.capacity()) * sizeof(GPoint) +
+                     stamps.capacity() * sizeof(Stamp);
+    for (const Stamp &stamp : stamps)
+    {
+      usage.geometry += stamp.rowStarts.capacity() * sizeof(int) + stamp.spans.capacity() * sizeof(LSpan);
+    }
+    const LClipMask *counted = nullptr;
+    auto addMask = [&](const std::shared_ptr<const LClipMask> &mask)
+    {
+      // Saved states usually share the current mask; count each one once in a row.
+      if (!mask || mask.get() == counted)
+        return;
+      counted = mask.get();
+      usage.clip += sizeof(LClipMask) + mask->rows.capacity() * sizeof(std::vector<LSpan>);
+      for (const std::vector<LSpan> &row : mask->rows)
+      {
+        usage.clip += row.capacity() * sizeof(LSpan);
+      }
+    };
+    for (const State &state : saveStates)
+    {
+      addMask(state.clipMask);
+    }
+    addMask(clipMask);
+    usage.other += saveStates.capacity() * sizeof(State) + clipSpans.capacity() * sizeof(LSpan);
+    return usage;
+  }
+
+  void setScratchBudget(size_t bytes) override
+  {
+    scratchBudget = bytes;
+  }
+
+  void trim() override
+  {
+    LMemoryUsage usage = memoryUsage();
+    size_t scratch = usage.scratch();
+    if (scratch <= scratchBudget)
+      return;
+
+    // Transient geometry goes first: it is sized by the last draw, not by steady state.
+    scratch -= usage.geometry;
+    devicePath = GPath();
+    std::vector<GPoint>().swap(meshVerts);
+    std::vector<GPoint>().swap(quadVerts);
+    std::vector<GColor>().swap(quadColors);
+    std::vector<GPoint>().swap(quadTexs);
+    std::vector<int>().swap(quadIndices);
+    std::vector<GPoint>().swap(linePoints);
+    std::vector<GPoint>().swap(instanceEdges);
+    std::vector<GPoint>().swap(instancePoints);
+    std::vector<Stamp>().swap(stamps);
+    nextStamp = 0;
+    scratch -= stampDots.capacity() * sizeof(std::vector<LDot>);
+    for (const std::vector<LDot> &row : stampDots)
+    {
+      scratch -= row.capacity() * sizeof(LDot);
+    }
+    std::vector<std::vector<LDot>>().swap(stampDots);
+    scratch -= clipSpans.capacity() * sizeof(LSpan);
+    std::vector<LSpan>().swap(clipSpans);
+    for (Lane &lane : lanes)
+    {
+      scratch -= lane.visibleSpans.capacity() * sizeof(LSpan);
+      std::vector<LSpan>().swap(lane.visibleSpans);
+    }
+
+    // Then the largest dot rows, which only a few unusually complex paths grow that far.
+    std::vector<int> rows;
+    for (int y = 0; y < (int)columnBuffer.size(); ++y)
+    {
+      if (columnBuffer[y].capacity() > 0)
+        rows.push_back(y);
+    }
+    std::sort(rows.begin(), rows.end(), [this](int a, int b)
+              { return columnBuffer[a].capacity() > columnBuffer[b].capacity(); });
+    for (int y : rows)
+    {
+      if (scratch <= scratchBudget)
+        break;
+      scratch -= columnBuffer[y].capacity() * sizeof(LDot);
+      std::vector<LDot>().swap(columnBuffer[y]);
+    }
+  }
+
 private:
-  // Note: we store a copy of the bitmap
+  struct State
+  {
+    GMatrix ctm;
+    GIRect clipBounds;
+    std::shared_ptr<const LClipMask> clipMask;
+  };
+
+  // Everything needed to produce and blend one run of pixels.
+  struct Brush
+  {
+    Filler fill;
+    RowPainter painter;
+    const GShader::Context *shader;
+    GPixel base;
+    GBlendMode mode;
+    // Every source pixel has alpha 255.
+    bool opaque;
+  };
+
+  // What writing pixels needs on one thread. Lane 0 serves the calling thread; with a pool,
+  // band-parallel drawing gives every worker its own.
+  struct Lane
+  {
+    std::vector<GPixel> rowBuffer;
+    std::vector<LSpan> visibleSpans;
+    LStats counters;
+  };
+
+  /**
+   *  The coverage of drawPathInstances' flattened path under one matrix, with the whole pixels
+   *  of its translation taken out and replaced by origin, which puts every edge inside
+   *  [0, width) x [0, height). Instances whose matrices differ only in those whole pixels are
+   *  painted by shifting its spans.
+   */
+  struct Stamp
+  {
+    // SX KX KY SY, then the fractional parts of TX and TY.
+    float key[6];
+    int originX;
+    int originY;
+    int width;
+    int height;
+    // Row y's spans are spans[rowStarts[y]] up to spans[rowStarts[y + 1]].
+    std::vector<int> rowStarts;
+    std::vector<LSpan> spans;
+  };
+
+  // Bands get at least this many rows, so small draws never pay for waking the pool.
+  static const int kMinBandRows = 32;
+  // Stamps kept for one drawPathInstances; past this they are replaced round-robin.
+  static const int kMaxStamps = 16;
+  // Instances larger than this on a side, or translated further than kMaxStampShift, are filled
+  // directly instead of being stamped.
+  static const int kMaxStampSize = 1024;
+  static constexpr float kMaxStampShift = 1 << 24;
+
+  // Note: we store a copy of the bitmap. It holds device rows [stripTop, stripTop + its height)
+  // of a device deviceHeight rows tall; for an ordinary canvas that is the whole device.
   const GBitmap fDevice;
-  const GIRect screenRect;
-  std::vector<GPixel> rowBuffer;
+  const int deviceHeight;
+  int stripTop = 0;
+  GIRect screenRect;
+  // Every draw is clamped to clipBounds; clipMask, if any, further limits each row.
+  GIRect clipBounds;
+  std::shared_ptr<const LClipMask> clipMask;
   std::vector<std::vector<LDot>> columnBuffer;
-  std::vector<GMatrix> saveStates;
+  std::vector<State> saveStates;
   GMatrix ctm;
+  LCoverage *coverage = nullptr;
+  int coverageOrder = 0;
+  bool coverageClaim = false;
+  LStats counters;
+  LThreadPool *pool = nullptr;
+  std::vector<Lane> lanes;
+  // Scratch kept between draws so steady-state drawing does not allocate; see trim().
+  GPath devicePath;
+  std::vector<GPoint> meshVerts;
+  std::vector<GPoint> quadVerts;
+  std::vector<GColor> quadColors;
+  std::vector<GPoint> quadTexs;
+  std::vector<int> quadIndices;
+  std::vector<LSpan> clipSpans;
+  // drawHairlines' points, mapped to device space.
+  std::vector<GPoint> linePoints;
+  // drawPathInstances' path, flattened in its own space into pairs of edge end points.
+  std::vector<GPoint> instanceEdges;
+  std::vector<GPoint> instancePoints;
+  GRect instanceBounds;
+  std::vector<Stamp> stamps;
+  int nextStamp = 0;
+  std::vector<std::vector<LDot>> stampDots;
+  size_t scratchBudget = kDefaultScratchBudget;
+  bool trackOpacity = true;
+  LOpacityMap opacity;
+
+  // The device rows the bitmap holds, and so all that can be drawn.
+  GIRect stripRect() const
+  {
+    return GIRect::MakeLTRB(0, stripTop, fDevice.width(), std::min(stripTop + fDevice.height(), deviceHeight));
+  }
+
+  LOpacity initialOpacity() const
+  {
+    return fDevice.isOpaque() ? LOpacity::kOpaque : LOpacity::kUnknown;
+  }
 
   GIRect clipRects(GIRect rect1, GIRect rect2)
   {
@@ -185,83 +634,532 @@ private:
     return GIRect::MakeLTRB(0, 0, 0, 0);
   }
 
-  void paintRect(const GIRect &rect, const GPaint &paint)
+  void intersectClip(const GIRect &rect)
   {
-    GIRect clipped = clipRects(rect, screenRect);
+    if (!clipBounds.intersect(rect))
+    {
+      clipBounds = GIRect::MakeLTRB(0, 0, 0, 0);
+    }
+  }
+
+  bool intersectsClip(const GPoint points[], int count)
+  {
+    if (count == 0)
+      return false;
+    GRect bounds = GRect::MakeXYWH(points[0].x(), points[0].y(), 0, 0);
+    for (int i = 1; i < count; ++i)
+    {
+      GRect pt = GRect::MakeXYWH(points[i].x(), points[i].y(), 0, 0);
+      bounds = PathUtil::unite(bounds, pt);
+    }
+    return bounds.roundOut().intersects(clipBounds);
+  }
+
+  // shading is the context of the paint's shader for the current CTM.
+  Brush makeBrush(const GPaint &paint, const GShader::Context *shading)
+  {
+    const GShader *shader = paint.getShader();
     const GBlendMode mode = paintToMode(paint);
-    if (mode == GBlendMode::kDst)
+    const GPixel base = createPixel(paint.getColor());
+    const bool opaque = shader ? shader->isOpaque() : GPixel_GetA(base) == 255;
+    return {shading ? shadeRow : fillRow, modeToRowPainter(mode), shading, base, mode, opaque};
+  }
+
+  void paintRun(int x, int y, int width, const Brush &brush, Lane &lane)
+  {
+    if (coverage)
+    {
+      lane.visibleSpans.clear();
+      coverage->visible(y, x, x + width, coverageOrder, lane.visibleSpans);
+      for (const LSpan &span : lane.visibleSpans)
+      {
+        writeRun(span.x0, y, span.x1 - span.x0, brush, lane);
+        if (coverageClaim)
+        {
+          coverage->add(y, span.x0, span.x1, coverageOrder);
+        }
+      }
+      return;
+    }
+    writeRun(x, y, width, brush, lane);
+  }
+
+  void writeRun(int x, int y, int width, const Brush &brush, Lane &lane)
+  {
+    if (!trackOpacity)
+    {
+      shadeRun(x, y, width, brush, brush.mode, brush.painter, lane);
       return;
+    }
+
+    // Walk the run in groups of cells whose state matches, blending each group with the mode
+    // reduced for what is known to be under it.
+    const int shift = LOpacityMap::kCellShift;
+    const int end = x + width;
+    LOpacity *cells = opacity.row(y - stripTop);
+    for (int x0 = x; x0 < end;)
+    {
+      const int first = x0 >> shift;
+      const LOpacity state = cells[first];
+      int last = first;
+      while (((last + 1) << shift) < end && cells[last + 1] == state)
+      {
+        ++last;
+      }
+      const int x1 = std::min(end, (last + 1) << shift);
+
+      const GBlendMode mode = LReduceForDst(brush.mode, state);
+      if (mode != GBlendMode::kDst)
+      {
+        shadeRun(x0, y, x1 - x0, brush, mode, mode == brush.mode ? brush.painter : modeToRowPainter(mode), lane);
+      }
+      else
+      {
+        LSTAT(lane.counters.pixels[(int)mode] += x1 - x0);
+      }
+
+      for (int c = first; c <= last; ++c)
+      {
+        const bool full = x0 <= (c << shift) && std::min(fDevice.width(), (c + 1) << shift) <= x1;
+        cells[c] = LOpacityAfter(state, mode, brush.opaque, full);
+      }
+      x0 = x1;
+    }
+  }
 
-    const GPixel basePixel = createPixel(paint.getColor());
-    const Painter painter = modeToPainter(mode);
-    GShader *shader = paint.getShader();
-    const Filler fill = shader ? shadeRow : fillRow;
-    shader && shader->setContext(ctm);
+  void shadeRun(int x, int y, int width, const Brush &brush, GBlendMode mode, RowPainter painter, Lane &lane)
+  {
+    LSTAT(lane.counters.pixels[(int)mode] += width);
+    if (mode == GBlendMode::kClear)
+    {
+      // Nothing to shade.
+      painter(nullptr, fDevice.getAddr(x, y - stripTop), width);
+      return;
+    }
+    LSTAT(if (brush.shader) { lane.counters.shaderRows++; lane.counters.shaderPixels += width; });
+    brush.fill(x, y, lane.rowBuffer.data(), width, brush.shader, brush.base);
+    painter(lane.rowBuffer.data(), fDevice.getAddr(x, y - stripTop), width);
+  }
 
-    for (int y = clipped.top(); y < clipped.bottom(); y++)
+  // Paint [x0, x1) on row y, which the caller has already limited to clipBounds.
+  void paintSpan(int x0, int x1, int y, const Brush &brush, Lane &lane)
+  {
+    if (!clipMask)
+    {
+      paintRun(x0, y, x1 - x0, brush, lane);
+      return;
+    }
+    for (const LSpan &span : clipMask->row(y))
     {
-      fill(clipped.left(), y, rowBuffer.data(), clipped.width(), shader, basePixel);
-      paintRow(rowBuffer.data(), fDevice.getAddr(clipped.left(), y), clipped.width(), painter);
+      if (span.x0 >= x1)
+        break;
+      int left = std::max(x0, span.x0);
+      int right = std::min(x1, span.x1);
+      if (left < right)
+      {
+        paintRun(left, y, right - left, brush, lane);
+      }
     }
   }
 
-  void paintBuffer(int top, int bottom, const GPaint &paint)
+  void paintRect(const GIRect &rect, const GPaint &paint)
   {
+    GIRect clipped = clipRects(rect, clipBounds);
     const GBlendMode mode = paintToMode(paint);
-    const Painter painter = modeToPainter(mode);
-    const GPixel basePixel = createPixel(paint.getColor());
-    GShader *shader = paint.getShader();
-    const Filler fill = shader ? shadeRow : fillRow;
-    if (shader)
+    if (mode == GBlendMode::kDst)
+      return;
+
+    LShaderContext shading(paint.getShader(), ctm);
+    if (paint.getShader() && !shading.get())
+      return;
+
+    LTRACE("paintRect");
+    const Brush brush = makeBrush(paint, shading.get());
+    forBands(clipped.top(), clipped.bottom(), [&](int top, int bottom, Lane &lane)
+             {
+      LSTAT_TIME(lane.counters, kPaint);
+      for (int y = top; y < bottom; y++)
+      {
+        paintSpan(clipped.left(), clipped.right(), y, brush, lane);
+      } });
+  }
+
+  void paintBuffer(int top, int bottom, const Brush &brush)
+  {
+    LTRACE("paintBuffer");
+    forBands(top, bottom, [&](int bandTop, int bandBottom, Lane &lane)
+             { paintRows(bandTop, bandBottom, brush, lane); });
+  }
+
+  /**
+   *  Call draw(top, bottom, lane) over [top, bottom). With a pool the rows are cut into bands
+   *  drawn in parallel: every row's dots, coverage and opacity cells are its own, so bands
+   *  never touch the same state. Shaders are only read while shading.
+   */
+  template <typename Draw>
+  void forBands(int top, int bottom, Draw &&draw)
+  {
+    const int bands = pool ? std::min(pool->count() * 2, (bottom - top) / kMinBandRows) : 1;
+    if (bands <= 1)
     {
-      shader->setContext(ctm);
+      draw(top, bottom, lanes[0]);
+      return;
     }
+    LTRACE("bands");
+    pool->parallelFor(bands, [&](int band, int worker)
+                      {
+      LTRACE("band");
+      int bandTop = top + (long long)(bottom - top) * band / bands;
+      int bandBottom = top + (long long)(bottom - top) * (band + 1) / bands;
+      draw(bandTop, bandBottom, lanes[worker]); });
+  }
 
+  void paintRows(int top, int bottom, const Brush &brush, Lane &lane)
+  {
+    // Sort every row first and then walk them, so the two phases can be timed and traced as
+    // a whole rather than per row.
+    {
+      LTRACE("sort");
+      LSTAT_TIME(lane.counters, kSort);
+      for (int y = top; y < bottom; y++)
+      {
+        std::vector<LDot> &row = columnBuffer[y];
+        LSTAT(lane.counters.rowsVisited++);
+        LSTAT(if (!row.empty()) { lane.counters.rowsNonEmpty++; lane.counters.dots += row.size(); });
+        if (row.size() > 1)
+        {
+          LSortRow(row.data(), row.size());
+          LSTAT(lane.counters.sorts++; lane.counters.sortedDots += row.size());
+          LSTAT(lane.counters.maxSortSize = std::max(lane.counters.maxSortSize, (int)row.size()));
+        }
+      }
+    }
+    LTRACE("paint");
+    LSTAT_TIME(lane.counters, kPaint);
     for (int y = top; y < bottom; y++)
     {
-      LDot *currRow = columnBuffer[y].data();
-      int numDots = columnBuffer[y].size();
-      if (numDots == 0)
+      std::vector<LDot> &row = columnBuffer[y];
+      if (row.empty())
       {
         continue;
       }
-      std::sort(currRow, currRow + numDots, [](LDot a, LDot b)
-                { return a.x < b.x; });
-      int w = 0;
-      int x0 = 0;
+      LWalkRow(row.data(), row.size(), [&](int x0, int x1)
+               { paintSpan(x0, x1, y, brush, lane); });
+      row.clear();
+    }
+  }
+
+  void paintTriangle(const GPoint &p0, const GPoint &p1, const GPoint &p2, const Brush &brush)
+  {
+    const GPoint corners[3] = {p0, p1, p2};
+    if (!intersectsClip(corners, 3))
+      return;
+    {
+      LTRACE("scan");
+      LSTAT_TIME(counters, kScan);
+      LEdgeToDots(columnBuffer, p0, p1, clipBounds);
+      LEdgeToDots(columnBuffer, p1, p2, clipBounds);
+      LEdgeToDots(columnBuffer, p2, p0, clipBounds);
+      LSTAT(counters.edges += 3);
+    }
+    int top = std::max(GRoundToInt(std::min(p0.y(), std::min(p1.y(), p2.y()))), clipBounds.top());
+    int bottom = std::min(GRoundToInt(std::max(p0.y(), std::max(p1.y(), p2.y()))), clipBounds.bottom());
+    paintBuffer(top, bottom, brush);
+  }
 
-      for (int i = 0; i < numDots; ++i)
+  // Hairlines from points[i] to points[i + 1] for i = 0, step, 2 * step, ...
+  void drawHairlines(const GPoint points[], int count, int step, const GPaint &paint)
+  {
+    const GBlendMode mode = paintToMode(paint);
+    if (mode == GBlendMode::kDst || count < 2)
+      return;
+    LShaderContext shading(paint.getShader(), ctm);
+    if (paint.getShader() && !shading.get())
+      return;
+    linePoints.resize(count);
+    {
+      LTRACE("geometry");
+      LSTAT_TIME(counters, kGeometry);
+      ctm.mapPoints(linePoints.data(), points, count);
+    }
+    const Brush brush = makeBrush(paint, shading.get());
+    Lane &lane = lanes[0];
+    LTRACE("paint");
+    LSTAT_TIME(lane.counters, kPaint);
+    for (int i = 0; i + 1 < count; i += step)
+    {
+      hairline(linePoints[i], linePoints[i + 1], brush, lane);
+    }
+  }
+
+  /**
+   *  Walk the major axis of the device-space segment a..b one pixel center at a time, putting
+   *  the pixel on the minor axis from the line's equation rather than by accumulating, so a
+   *  tile or band that starts partway along still places every pixel the same. Along x, pixels
+   *  in the same row are painted as one span.
+   */
+  void hairline(GPoint a, GPoint b, const Brush &brush, Lane &lane)
+  {
+    const float dx = b.x() - a.x();
+    const float dy = b.y() - a.y();
+    // A difference is finite only if both end points are.
+    if (!std::isfinite(dx) || !std::isfinite(dy) || (dx == 0 && dy == 0))
+      return;
+    const bool alongX = std::abs(dx) >= std::abs(dy);
+    const float slope = alongX ? dy / dx : dx / dy;
+    const float intercept = alongX ? a.y() - slope * a.x() : a.x() - slope * a.y();
+    const float majorA = alongX ? a.x() : a.y();
+    const float majorB = alongX ? b.x() : b.y();
+    // The same centers as LEdgeToDots takes rows from: those in (low, high]. Clamping before
+    // rounding is the same as after, and keeps far-off end points in int range.
+    const int lowLimit = alongX ? clipBounds.left() : clipBounds.top();
+    const int highLimit = alongX ? clipBounds.right() : clipBounds.bottom();
+    const int first = GRoundToInt(CLAMP(std::min(majorA, majorB), (float)lowLimit, (float)highLimit));
+    const int last = GRoundToInt(CLAMP(std::max(majorA, majorB), (float)lowLimit, (float)highLimit));
+    // Minor positions are checked against the clip as floats before they are converted, and
+    // the clip is never negative, so truncating them is flooring them.
+    const float minorLow = alongX ? clipBounds.top() : clipBounds.left();
+    const float minorHigh = alongX ? clipBounds.bottom() : clipBounds.right();
+    const bool direct = !clipMask && !coverage && !brush.shader;
+
+    if (!alongX)
+    {
+      for (int y = first; y < last; ++y)
       {
-        LDot currDot = currRow[i];
-        int x = currDot.x;
-        if (w == 0)
-        {
-          x0 = x;
-        }
-        w += currDot.w;
-        if (w == 0 && x0 < x)
+        const float x = slope * (y + 0.5f) + intercept;
+        if (x >= minorLow && x < minorHigh)
         {
-          fill(x0, y, rowBuffer.data(), x - x0, shader, basePixel);
-          paintRow(rowBuffer.data(), fDevice.getAddr(x0, y), x - x0, painter);
+          const int px = (int)x;
+          hairlineRun(px, px + 1, y, direct, brush, lane);
         }
       }
-      columnBuffer[y].clear();
+      return;
+    }
+    int runStart = first;
+    int runRow = 0;
+    bool inRun = false;
+    for (int x = first; x < last; ++x)
+    {
+      const float y = slope * (x + 0.5f) + intercept;
+      const bool inside = y >= minorLow && y < minorHigh;
+      const int row = inside ? (int)y : 0;
+      if (inRun && (!inside || row != runRow))
+      {
+        hairlineRun(runStart, x, runRow, direct, brush, lane);
+        inRun = false;
+      }
+      if (inside && !inRun)
+      {
+        runStart = x;
+        runRow = row;
+        inRun = true;
+      }
+    }
+    if (inRun)
+    {
+      hairlineRun(runStart, last, runRow, direct, brush, lane);
+    }
+  }
+
+  // Hairline runs are a pixel or a few, so a solid brush writes them straight to the device,
+  // skipping the row buffer. Clip masks, coverage and shaders take the usual paintSpan route.
+  void hairlineRun(int x0, int x1, int y, bool direct, const Brush &brush, Lane &lane)
+  {
+    if (!direct)
+    {
+      paintSpan(x0, x1, y, brush, lane);
+      return;
+    }
+    GPixel *dst = fDevice.getAddr(0, y - stripTop);
+    const Painter painter = modeToPainter(brush.mode);
+    if (!trackOpacity)
+    {
+      LSTAT(lane.counters.pixels[(int)brush.mode] += x1 - x0);
+      for (int x = x0; x < x1; ++x)
+      {
+        dst[x] = painter(brush.base, dst[x]);
+      }
+      return;
+    }
+    LOpacity *cells = opacity.row(y - stripTop);
+    const int shift = LOpacityMap::kCellShift;
+    for (int x = x0; x < x1; ++x)
+    {
+      // As writeRun does for a run of one.
+      LOpacity &cell = cells[x >> shift];
+      const GBlendMode mode = LReduceForDst(brush.mode, cell);
+      const bool full = x <= ((x >> shift) << shift) && std::min(fDevice.width(), ((x >> shift) + 1) << shift) <= x + 1;
+      cell = LOpacityAfter(cell, mode, brush.opaque, full);
+      LSTAT(lane.counters.pixels[(int)mode]++);
+      if (mode != GBlendMode::kDst)
+      {
+        dst[x] = (mode == brush.mode ? painter : modeToPainter(mode))(brush.base, dst[x]);
+      }
+    }
+  }
+
+  /**
+   *  Find or make the stamp for an instance drawn under m, and set (*dx, *dy) to the offset
+   *  that places it. Returns nullptr if the instance should be filled directly instead. A stamp
+   *  depends only on the key part of m, never on which instance needed it first or what was
+   *  clipped, so an instance's pixels are the same in every tile and band.
+   */
+  const Stamp *findStamp(const GMatrix &m, int *dx, int *dy)
+  {
+    const float tx = m[GMatrix::TX];
+    const float ty = m[GMatrix::TY];
+    if (!(std::abs(tx) < kMaxStampShift && std::abs(ty) < kMaxStampShift))
+      return nullptr;
+    const float wholeX = std::floor(tx);
+    const float wholeY = std::floor(ty);
+    const float key[6] = {m[GMatrix::SX], m[GMatrix::KX], m[GMatrix::KY], m[GMatrix::SY], tx - wholeX, ty - wholeY};
+
+    Stamp *stamp = nullptr;
+    for (Stamp &candidate : stamps)
+    {
+      if (std::equal(key, key + 6, candidate.key))
+      {
+        stamp = &candidate;
+        break;
+      }
+    }
+    if (!stamp)
+    {
+      const GMatrix local(key[0], key[1], key[4], key[2], key[3], key[5]);
+      const GPoint corners[4] = {{instanceBounds.left(), instanceBounds.top()}, {instanceBounds.right(), instanceBounds.top()},
+                                 {instanceBounds.right(), instanceBounds.bottom()}, {instanceBounds.left(), instanceBounds.bottom()}};
+      GPoint mapped[4];
+      local.mapPoints(mapped, corners, 4);
+      GRect bounds = GRect::MakeXYWH(mapped[0].x(), mapped[0].y(), 0, 0);
+      for (int i = 1; i < 4; ++i)
+      {
+        GRect pt = GRect::MakeXYWH(mapped[i].x(), mapped[i].y(), 0, 0);
+        bounds = PathUtil::unite(bounds, pt);
+      }
+      // Also false for a matrix that is not finite.
+      if (!(bounds.width() < kMaxStampSize && bounds.height() < kMaxStampSize))
+        return nullptr;
+      if ((int)stamps.size() < kMaxStamps)
+      {
+        stamps.emplace_back();
+        stamp = &stamps.back();
+      }
+      else
+      {
+        stamp = &stamps[nextStamp];
+        nextStamp = (nextStamp + 1) % kMaxStamps;
+      }
+      std::copy(key, key + 6, stamp->key);
+      buildStamp(*stamp, local, bounds);
     }
+    *dx = (int)wholeX - stamp->originX;
+    *dy = (int)wholeY - stamp->originY;
+    return stamp;
   }
 
-  void paintTriangle(const GPoint &p0, const GPoint &p1, const GPoint &p2, const GPaint &paint)
+  // Rasterize the flattened path under local, which maps it into bounds, into stamp.
+  void buildStamp(Stamp &stamp, const GMatrix &local, const GRect &bounds)
   {
-    LEdgeToDots(columnBuffer, p0, p1, screenRect);
-    LEdgeToDots(columnBuffer, p1, p2, screenRect);
-    LEdgeToDots(columnBuffer, p2, p0, screenRect);
-    int top = std::max(GRoundToInt(std::min(p0.y(), std::min(p1.y(), p2.y()))), screenRect.top());
-    int bottom = std::min(GRoundToInt(std::max(p0.y(), std::max(p1.y(), p2.y()))), screenRect.bottom());
-    paintBuffer(top, bottom, paint);
+    LTRACE("scan");
+    LSTAT_TIME(counters, kScan);
+    // A pixel of margin on every side absorbs rounding in the placed points.
+    stamp.originX = 1 - GFloorToInt(bounds.left());
+    stamp.originY = 1 - GFloorToInt(bounds.top());
+    stamp.width = GCeilToInt(bounds.right()) + stamp.originX + 1;
+    stamp.height = GCeilToInt(bounds.bottom()) + stamp.originY + 1;
+    const GMatrix placed(local[GMatrix::SX], local[GMatrix::KX], local[GMatrix::TX] + stamp.originX,
+                         local[GMatrix::KY], local[GMatrix::SY], local[GMatrix::TY] + stamp.originY);
+    instancePoints.resize(instanceEdges.size());
+    placed.mapPoints(instancePoints.data(), instanceEdges.data(), instanceEdges.size());
+
+    if ((int)stampDots.size() < stamp.height)
+    {
+      stampDots.resize(stamp.height);
+    }
+    const GIRect area = GIRect::MakeWH(stamp.width, stamp.height);
+    for (size_t i = 0; i < instancePoints.size(); i += 2)
+    {
+      LEdgeToDots(stampDots, instancePoints[i], instancePoints[i + 1], area);
+    }
+    LSTAT(counters.edges += instancePoints.size() / 2);
+
+    stamp.rowStarts.clear();
+    stamp.spans.clear();
+    for (int y = 0; y < stamp.height; ++y)
+    {
+      std::vector<LDot> &row = stampDots[y];
+      stamp.rowStarts.push_back(stamp.spans.size());
+      if (row.size() > 1)
+      {
+        LSortRow(row.data(), row.size());
+      }
+      LWalkRow(row.data(), row.size(), [&](int x0, int x1)
+               { stamp.spans.push_back({x0, x1}); });
+      row.clear();
+    }
+    stamp.rowStarts.push_back(stamp.spans.size());
+  }
+
+  void paintStamp(const Stamp &stamp, int dx, int dy, const Brush &brush)
+  {
+    const int top = std::max(dy, clipBounds.top());
+    const int bottom = std::min(dy + stamp.height, clipBounds.bottom());
+    if (top >= bottom || dx + stamp.width <= clipBounds.left() || dx >= clipBounds.right())
+      return;
+    forBands(top, bottom, [&](int bandTop, int bandBottom, Lane &lane)
+             {
+      LSTAT_TIME(lane.counters, kPaint);
+      for (int y = bandTop; y < bandBottom; ++y)
+      {
+        const int row = y - dy;
+        for (int i = stamp.rowStarts[row]; i < stamp.rowStarts[row + 1]; ++i)
+        {
+          const int x0 = std::max(stamp.spans[i].x0 + dx, clipBounds.left());
+          const int x1 = std::min(stamp.spans[i].x1 + dx, clipBounds.right());
+          if (x0 < x1)
+          {
+            paintSpan(x0, x1, y, brush, lane);
+          }
+        }
+      } });
+  }
+
+  // Fill the flattened path under m the way drawPath fills a path of lines.
+  void fillInstance(const GMatrix &m, const Brush &brush)
+  {
+    instancePoints.resize(instanceEdges.size());
+    {
+      LTRACE("geometry");
+      LSTAT_TIME(counters, kGeometry);
+      m.mapPoints(instancePoints.data(), instanceEdges.data(), instanceEdges.size());
+    }
+    if (!intersectsClip(instancePoints.data(), instancePoints.size()))
+      return;
+    float minY = instancePoints[0].y();
+    float maxY = minY;
+    for (const GPoint &p : instancePoints)
+    {
+      minY = std::min(minY, p.y());
+      maxY = std::max(maxY, p.y());
+    }
+    {
+      LTRACE("scan");
+      LSTAT_TIME(counters, kScan);
+      for (size_t i = 0; i < instancePoints.size(); i += 2)
+      {
+        LEdgeToDots(columnBuffer, instancePoints[i], instancePoints[i + 1], clipBounds);
+      }
+      LSTAT(counters.edges += instancePoints.size() / 2);
+    }
+    int top = CLAMP(GRoundToInt(minY), clipBounds.top(), clipBounds.bottom());
+    int bottom = CLAMP(GRoundToInt(maxY), clipBounds.top(), clipBounds.bottom());
+    paintBuffer(top, bottom, brush);
   }
 
   template <class T>
   void quadLerp(std::vector<T> &data, const T &a, const T &b, const T &c, const T &d, int num, float step)
   {
+    data.clear();
     float y = 0;
     for (int i = 0; i < num; ++i, y += step)
     {
@@ -276,5 +1174,15 @@ private:
 
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap &device)
 {
-  return std::unique_ptr<GCanvas>(new MyCanvas(device));
+  return std::unique_ptr<GCanvas>(new MyCanvas(device, device.height()));
+}
+
+std::unique_ptr<LCanvas> LCreateCanvas(const GBitmap &device)
+{
+  return std::unique_ptr<LCanvas>(new MyCanvas(device, device.height()));
+}
+
+std::unique_ptr<LCanvas> LCreateStripCanvas(const GBitmap &strip, int deviceHeight)
+{
+  return std::unique_ptr<LCanvas>(new MyCanvas(strip, deviceHeight));
 }
\ No newline at end of file
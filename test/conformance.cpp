@@ -0,0 +1,1359 @@
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GPath.h"
+#include "GShader.h"
+#include "LAsyncCanvas.h"
+#include "LBitmapPool.h"
+#include "LCanvas.h"
+#include "LCommands.h"
+#include "LCoverage.h"
+#include "LCull.h"
+#include "LDamage.h"
+#include "LEncode.h"
+#include "LFrameLoop.h"
+#include "LPainter.h"
+#include "LPicture.h"
+#include "LStripRenderer.h"
+#include "LTexture.h"
+#include "LThreadPool.h"
+#include "LTileRenderer.h"
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Conformance harness: renders every case in the corpus through the reference MyCanvas and
+// through every optimized mode, and compares the pixels. Each mode has a per-channel tolerance
+// (0 means bit-exact). On a mismatch the expected, actual and diff images are written to
+// build/check as PPM.
+//
+//   conformance [filter]    only run case/mode pairs whose name contains filter
+
+static const char *kOutDir = "build/check";
+
+struct Case
+{
+  std::string name;
+  int width;
+  int height;
+  std::function<void(GCanvas *)> draw;
+};
+
+// A case recorded as the frame to check, and an earlier frame with some of its ops missing for
+// modes that carry state from one frame to the next.
+struct Frames
+{
+  LPicture previous;
+  LPicture current;
+};
+
+struct Mode
+{
+  std::string name;
+  // Largest allowed difference in any channel of any pixel.
+  int tolerance;
+  // If set, the mode draws frames.previous before frames.current and is compared against the
+  // reference drawing both.
+  bool afterPrevious;
+  // Render the case into device, which starts out transparent.
+  std::function<void(const Case &, const Frames &, const GBitmap &)> render;
+};
+
+// The canvas every mode is compared against: plain in-order drawing, with none of the blend
+// mode reductions opacity tracking makes.
+static std::unique_ptr<LCanvas> referenceCanvas(const GBitmap &device)
+{
+  std::unique_ptr<LCanvas> canvas = LCreateCanvas(device);
+  canvas->setOpacityTracking(false);
+  return canvas;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Corpus
+
+static std::vector<Case> makeCases()
+{
+  std::vector<Case> cases;
+
+  auto dense = std::make_shared<Scene>(512, 12, 16, 1);
+  cases.push_back({"scene/dense", 512, 512, [dense](GCanvas *c)
+                   { dense->draw(c); }});
+  auto odd = std::make_shared<Scene>(300, 6, 5, 2);
+  cases.push_back({"scene/odd-size", 300, 217, [odd](GCanvas *c)
+                   { odd->draw(c); }});
+  auto spiky = std::make_shared<Scene>(256, 4, 64, 3);
+  cases.push_back({"scene/64-edges", 256, 256, [spiky](GCanvas *c)
+                   { spiky->draw(c); }});
+
+  cases.push_back({"clips", 320, 320, [](GCanvas *c)
+                   {
+                     c->clear({1, 1, 1, 1});
+                     c->save();
+                     c->clipRect(GRect::MakeLTRB(20.3f, 10.7f, 290.5f, 300.2f));
+                     c->fillRect(GRect::MakeWH(320, 320), {0.2f, 0.4f, 0.8f, 1});
+                     c->save();
+                     GPath circle;
+                     circle.addCircle({160, 160}, 120);
+                     c->clipPath(circle);
+                     c->drawPaint(GPaint({1, 0.5f, 0, 0.7f}));
+                     c->save();
+                     c->translate(160, 160);
+                     c->rotate(0.4f);
+                     c->clipRect(GRect::MakeXYWH(-100, -40, 200, 80));
+                     c->fillRect(GRect::MakeXYWH(-150, -150, 300, 300), {0, 0.8f, 0.3f, 0.8f});
+                     c->restore();
+                     c->restore();
+                     GPath tri;
+                     tri.moveTo(0, 320).lineTo(160, 0).lineTo(320, 320);
+                     c->drawPath(tri, GPaint({0.5f, 0, 0.5f, 0.3f}));
+                     c->restore();
+                     c->clipRect(GRect::MakeXYWH(400, 400, 10, 10));
+                     c->drawPaint(GPaint({1, 0, 0, 1}));
+                   }});
+
+  // Rects that round out well past their unrounded corners once magnified, across tile edges.
+  cases.push_back({"scaled-rounded-rects", 200, 160, [](GCanvas *c)
+                   {
+                     c->clear({1, 1, 1, 1});
+                     c->scale(10, 10);
+                     c->fillRect(GRect::MakeLTRB(0.6f, 0.6f, 1.5f, 1.5f), {0.8f, 0.1f, 0.1f, 1});
+                     c->fillRect(GRect::MakeLTRB(5.5f, 0.7f, 6.4f, 3.5f), {0.1f, 0.6f, 0.2f, 0.7f});
+                     c->fillRect(GRect::MakeLTRB(3.6f, 5.6f, 7.5f, 6.5f), {0.1f, 0.2f, 0.8f, 1});
+                     c->fillRect(GRect::MakeLTRB(11.5f, 8.5f, 13.49f, 12.5f), {0.9f, 0.6f, 0.1f, 0.8f});
+                   }});
+
+  cases.push_back({"clipped-clear", 256, 256, [](GCanvas *c)
+                   {
+                     c->save();
+                     c->clipRect(GRect::MakeXYWH(32, 32, 192, 192));
+                     c->clear({0.3f, 0.3f, 0.3f, 1});
+                     c->restore();
+                     for (int i = 0; i < 12; ++i)
+                       c->fillRect(GRect::MakeXYWH(i * 20.0f, i * 18.0f, 60, 50), {1, i / 12.0f, 0, 0.6f});
+                   }});
+
+  cases.push_back({"blend-modes", 384, 288, [](GCanvas *c)
+                   {
+                     for (int i = 0; i < 12; ++i)
+                     {
+                       float x = (i % 4) * 96.0f;
+                       float y = (i / 4) * 96.0f;
+                       c->fillRect(GRect::MakeXYWH(x, y, 96, 48), {0.1f, 0.6f, 0.9f, 1});
+                       c->fillRect(GRect::MakeXYWH(x, y + 48, 96, 48), {0.9f, 0.3f, 0.1f, 0.5f});
+                       for (int k = 0; k < 3; ++k)
+                       {
+                         GPath dot;
+                         dot.addCircle({x + 24 + k * 24.0f, y + 48}, 22);
+                         GPaint paint({1.0f - k * 0.3f, 0.8f, k * 0.4f, k == 0 ? 1 : 0.6f - k * 0.2f});
+                         paint.setBlendMode((GBlendMode)i);
+                         c->drawPath(dot, paint);
+                       }
+                     }
+                   }});
+
+  GColor stops[] = {{1, 0, 0, 1}, {1, 1, 0, 0.8f}, {0, 1, 0, 0.4f}, {0, 0, 1, 1}, {1, 1, 1, 1}};
+  std::shared_ptr<GShader> gradients[] = {
+      GCreateLinearGradient({40, 0}, {100, 40}, stops, 1),
+      GCreateLinearGradient({40, 0}, {100, 40}, stops, 2),
+      GCreateLinearGradient({40, 0}, {100, 40}, stops, 5, GShader::kRepeat),
+      GCreateLinearGradient({40, 0}, {100, 40}, stops, 5, GShader::kMirror),
+  };
+  auto texture = std::make_shared<GBitmap>();
+  texture->alloc(16, 16);
+  for (int y = 0; y < 16; ++y)
+    for (int x = 0; x < 16; ++x)
+      *texture->getAddr(x, y) = (x + y) % 2 ? GPixel_PackARGB(255, 200, 20, 20) : GPixel_PackARGB(128, 0, 64, 128);
+  std::shared_ptr<GShader> bitmaps[] = {
+      GCreateBitmapShader(*texture, GMatrix::Scale(4, 3)),
+      GCreateBitmapShader(*texture, GMatrix::Rotate(0.5f), GShader::kRepeat),
+      GCreateBitmapShader(*texture, GMatrix::Scale(2.5f, 2.5f), GShader::kMirror),
+  };
+  cases.push_back({"shaders", 400, 300, [gradients, bitmaps, texture](GCanvas *c)
+                   {
+                     c->clear({0.5f, 0.5f, 0.5f, 1});
+                     for (int i = 0; i < 4; ++i)
+                     {
+                       c->save();
+                       c->translate(i * 100.0f, 0);
+                       c->drawRect(GRect::MakeWH(100, 140), GPaint(gradients[i].get()));
+                       c->restore();
+                     }
+                     for (int i = 0; i < 3; ++i)
+                     {
+                       c->save();
+                       c->translate(20 + i * 130.0f, 160);
+                       c->rotate(0.2f * i);
+                       c->drawRect(GRect::MakeWH(110, 120), GPaint(bitmaps[i].get()));
+                       c->restore();
+                     }
+                   }});
+
+  cases.push_back({"meshes", 320, 320, [bitmaps](GCanvas *c)
+                   {
+                     c->clear({1, 1, 1, 1});
+                     GPoint quad[4] = {{10, 20}, {150, 5}, {140, 150}, {25, 130}};
+                     GColor colors[4] = {{1, 0, 0, 1}, {0, 1, 0, 0.5f}, {0, 0, 1, 1}, {1, 1, 0, 0.8f}};
+                     GPoint texs[4] = {{0, 0}, {16, 0}, {16, 16}, {0, 16}};
+                     GPaint textured(bitmaps[1].get());
+                     for (int level = 0; level < 4; ++level)
+                     {
+                       c->save();
+                       c->translate((level % 2) * 160.0f, (level / 2) * 160.0f);
+                       c->drawQuad(quad, colors, nullptr, level, GPaint());
+                       c->drawQuad(quad, level % 2 ? colors : nullptr, texs, level * 2, textured);
+                       c->restore();
+                     }
+                     GPoint verts[] = {{160, 160}, {300, 170}, {170, 300}, {20, 310}, {300, 300}};
+                     int indices[] = {0, 1, 2, 0, 2, 3, 1, 4, 2};
+                     GColor vcolors[] = {{1, 0, 1, 0.6f}, {0, 1, 1, 0.6f}, {1, 1, 0, 0.6f}, {0, 0, 0, 1}, {1, 1, 1, 0.2f}};
+                     c->drawMesh(verts, vcolors, nullptr, 3, indices, GPaint());
+                   }});
+
+  cases.push_back({"paths", 256, 256, [](GCanvas *c)
+                   {
+                     c->clear({0, 0, 0, 1});
+                     GPath curves;
+                     curves.moveTo(20, 200).quadTo(128, -80, 236, 200).cubicTo(180, 260, 60, 120, 20, 200);
+                     c->drawPath(curves, GPaint({0.9f, 0.7f, 0.1f, 1}));
+                     GPath offCanvas;
+                     offCanvas.moveTo(-1000, -50).lineTo(5000, 120).lineTo(-300, 2000);
+                     c->drawPath(offCanvas, GPaint({0.2f, 0.3f, 1, 0.5f}));
+                     GPath sliver;
+                     sliver.moveTo(10, 10).lineTo(246, 11).lineTo(246, 11.4f);
+                     c->drawPath(sliver, GPaint({1, 1, 1, 1}));
+                     GPath holes;
+                     holes.addCircle({128, 128}, 60).addCircle({128, 128}, 30, GPath::kCCW_Direction);
+                     holes.addCircle({100, 100}, 20);
+                     c->drawPath(holes, GPaint({0, 1, 0.5f, 0.7f}));
+                     GPoint poly[] = {{200, 20}, {250, 60}, {230, 120}, {170, 90}};
+                     c->drawConvexPolygon(poly, 4, GPaint({1, 0, 0, 0.5f}));
+                   }});
+
+  cases.push_back({"path-instances", 320, 240, [gradients](GCanvas *c)
+                   {
+                     c->clear({1, 1, 1, 1});
+                     GPath marker;
+                     marker.addCircle({0, 0}, 6);
+                     marker.moveTo(-3, -9).lineTo(9, 3).lineTo(-9, 3);
+                     // Whole and quarter pixel offsets, so many instances share a stamp.
+                     std::vector<GMatrix> matrices;
+                     std::vector<GColor> colors;
+                     for (int i = 0; i < 300; ++i)
+                     {
+                       float s = 0.5f + (i % 5) * 0.5f;
+                       GMatrix m = GMatrix::Translate((i * 37) % 330 - 5 + (i % 4) * 0.25f, (i * 53) % 250 - 5 + (i % 2) * 0.5f) * GMatrix::Scale(s, s);
+                       matrices.push_back(i % 7 ? m : m * GMatrix::Rotate(i * 0.3f));
+                       colors.push_back({i % 3 / 2.0f, i % 5 / 4.0f, 1 - i % 7 / 6.0f, 0.4f + (i % 4) * 0.2f});
+                     }
+                     c->save();
+                     c->clipRect(GRect::MakeLTRB(8.5f, 6.2f, 300.7f, 230.4f));
+                     c->drawPathInstances(marker, matrices.data(), colors.data(), matrices.size(), GPaint());
+                     c->rotate(0.1f);
+                     c->scale(1.5f, 1.5f);
+                     c->drawPathInstances(marker, matrices.data(), nullptr, 40, GPaint(gradients[1].get()));
+                     c->restore();
+                     // Too large to stamp, and filled directly.
+                     GMatrix large[] = {GMatrix::Translate(160, 120) * GMatrix::Scale(150, 90), GMatrix::Translate(40.5f, 200) * GMatrix::Scale(3, 3)};
+                     c->drawPathInstances(marker, large, nullptr, 2, GPaint({0.1f, 0.6f, 0.3f, 0.25f}));
+                   }});
+
+  // A paint that alone would draw nothing (transparent kSrcOver, and kDstIn with opaque
+  // colors), whose instance colors do draw: culling must not drop it as a no-op.
+  cases.push_back({"path-instances-colors", 200, 160, [](GCanvas *c)
+                   {
+                     c->clear({0.9f, 0.9f, 0.8f, 1});
+                     GPath marker;
+                     marker.addRect(GRect::MakeLTRB(-6, -6, 6, 6));
+                     marker.addCircle({0, 0}, 4, GPath::kCCW_Direction);
+                     std::vector<GMatrix> matrices;
+                     std::vector<GColor> colors;
+                     for (int i = 0; i < 60; ++i)
+                     {
+                       matrices.push_back(GMatrix::Translate(12 + (i % 10) * 19.5f, 12 + (i / 10) * 24.25f));
+                       colors.push_back({i % 3 / 2.0f, i % 4 / 3.0f, 1 - i % 5 / 4.0f, 1});
+                     }
+                     c->drawPathInstances(marker, matrices.data(), colors.data(), 30, GPaint({0, 0, 0, 0}));
+                     GPaint dstIn({1, 1, 1, 1});
+                     dstIn.setBlendMode(GBlendMode::kDstIn);
+                     std::vector<GColor> faded(30, GColor{0.2f, 0.4f, 0.6f, 0.5f});
+                     c->drawPathInstances(marker, matrices.data() + 30, faded.data(), 30, dstIn);
+                   }});
+
+  cases.push_back({"hairlines", 300, 200, [gradients](GCanvas *c)
+                   {
+                     c->clear({1, 1, 1, 1});
+                     // Grid lines on and between pixel centers, through a clip.
+                     std::vector<GPoint> grid;
+                     for (int i = 0; i <= 12; ++i)
+                     {
+                       grid.push_back({i * 25.0f + (i % 2) * 0.5f, -10});
+                       grid.push_back({i * 25.0f + (i % 2) * 0.5f, 210});
+                       grid.push_back({-10, i * 16.0f + 0.25f});
+                       grid.push_back({310, i * 16.0f + 0.25f});
+                     }
+                     c->save();
+                     c->clipRect(GRect::MakeLTRB(10.5f, 5.5f, 290.5f, 190.5f));
+                     c->drawLines(grid.data(), grid.size(), GPaint({0.6f, 0.6f, 0.6f, 0.5f}));
+                     c->restore();
+                     // Chart series: steep and shallow segments, translucent where they cross.
+                     std::vector<GPoint> series;
+                     for (int i = 0; i <= 60; ++i)
+                     {
+                       series.push_back({i * 5.0f - 2, 100 + 80 * std::sin(i * 0.37f) * std::cos(i * 0.11f)});
+                     }
+                     c->drawPolyline(series.data(), series.size(), GPaint({0.8f, 0.1f, 0.1f, 0.7f}));
+                     c->save();
+                     c->translate(60, -20);
+                     c->rotate(0.3f);
+                     c->scale(0.9f, 0.6f);
+                     c->drawPolyline(series.data(), 40, GPaint(gradients[2].get()));
+                     c->restore();
+                     GPath circle;
+                     circle.addCircle({150, 100}, 70);
+                     c->save();
+                     c->clipPath(circle);
+                     for (int i = 0; i < 40; ++i)
+                     {
+                       GPoint spoke[] = {{150, 100}, {150 + 200 * std::cos(i * 0.157f), 100 + 200 * std::sin(i * 0.157f)}};
+                       c->drawLines(spoke, 2, GPaint({0, 0, 0.6f, 1}));
+                     }
+                     c->restore();
+                     GPoint far[] = {{-1e9f, -1e9f}, {1e9f, 1e9f}, {5, 195}, {5, 195}, {0, 199.5f}};
+                     c->drawPolyline(far, 5, GPaint({0, 0.5f, 0, 1}));
+                   }});
+
+  auto opaqueTexture = std::make_shared<GBitmap>();
+  opaqueTexture->alloc(8, 8);
+  for (int y = 0; y < 8; ++y)
+    for (int x = 0; x < 8; ++x)
+      *opaqueTexture->getAddr(x, y) = GPixel_PackARGB(255, x * 32, y * 32, 90);
+  opaqueTexture->setIsOpaque(GBitmap::kCompute_IsOpaque);
+  std::shared_ptr<GShader> opaqueImage(GCreateBitmapShader(*opaqueTexture, GMatrix::Scale(5, 5), GShader::kRepeat));
+  cases.push_back({"opacity", 384, 240, [opaqueImage, opaqueTexture](GCanvas *c)
+                   {
+                     // Cleared on the left, opaque on the right, with edges off the 32 pixel cells
+                     // the canvas tracks opacity in, then every mode drawn over both.
+                     c->clear({0, 0, 0, 0});
+                     c->fillRect(GRect::MakeLTRB(187, 0, 384, 240), {0.2f, 0.7f, 0.4f, 1});
+                     c->fillRect(GRect::MakeLTRB(100, 180, 300, 190), {0.9f, 0.1f, 0.1f, 0.5f});
+                     for (int i = 0; i < 12; ++i)
+                     {
+                       GPaint image(opaqueImage.get());
+                       image.setBlendMode((GBlendMode)i);
+                       c->drawRect(GRect::MakeXYWH(13 + i * 3.0f, 5 + i * 14.0f, 330, 6), image);
+                       GPaint color({0.3f, 0.3f, 1, i % 2 ? 1 : 0.6f});
+                       color.setBlendMode((GBlendMode)i);
+                       GPath dot;
+                       dot.addCircle({40 + i * 28.0f, 200}, 20);
+                       c->drawPath(dot, color);
+                     }
+                     c->save();
+                     GPath hole;
+                     hole.addCircle({192, 120}, 50);
+                     c->clipPath(hole);
+                     c->clear({0, 0, 0, 0});
+                     c->restore();
+                     c->drawPaint(GPaint({1, 1, 1, 0.25f}));
+                   }});
+
+  auto layers = std::make_shared<std::vector<std::unique_ptr<GShader>>>();
+  for (int i = 0; i < 40; ++i)
+  {
+    GColor c0 = {(i % 7) / 7.0f, 0.5f, (i % 3) / 3.0f, 1};
+    GColor c1 = {0.2f, (i % 5) / 5.0f, 0.8f, 1};
+    layers->push_back(GCreateLinearGradient({0, 0}, {30.0f + i, 50}, c0, c1, GShader::kMirror));
+  }
+  cases.push_back({"overdraw", 256, 256, [layers](GCanvas *c)
+                   {
+                     c->clear({1, 1, 1, 1});
+                     for (int i = 0; i < 40; ++i)
+                     {
+                       float x = (i * 37) % 256;
+                       float y = (i * 91) % 256;
+                       GPath path;
+                       path.addCircle({x, y}, 30 + (i % 4) * 15);
+                       c->drawPath(path, GPaint((*layers)[i].get()));
+                       if (i % 5 == 0)
+                         c->fillRect(GRect::MakeXYWH(y, x, 60, 40), {0, 0, 0, 0.3f});
+                       if (i % 9 == 0)
+                         c->fillRect(GRect::MakeXYWH(x, y, 90, 30), {1, 1, 0, 1});
+                     }
+                   }});
+
+  return cases;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Modes
+
+static std::vector<Mode> makeModes()
+{
+  std::vector<Mode> modes;
+
+  modes.push_back({"picture", 0, false, [](const Case &, const Frames &frames, const GBitmap &device)
+                   { frames.current.playback(LCreateCanvas(device).get()); }});
+
+  for (int threads : {1, 4})
+  {
+    for (int tile : {64, 17})
+    {
+      modes.push_back({"tiled/" + std::to_string(threads) + "x" + std::to_string(tile), 0, false,
+                       [threads, tile](const Case &, const Frames &frames, const GBitmap &device)
+                       {
+                         LTileRenderer renderer(device, tile, threads);
+                         renderer.render(frames.current);
+                       }});
+    }
+  }
+
+  // Band-parallel drawing on one canvas, with and without coverage routing the writes.
+  auto bandPool = std::make_shared<LThreadPool>(4);
+  modes.push_back({"banded/4", 0, false, [bandPool](const Case &, const Frames &frames, const GBitmap &device)
+                   {
+                     std::unique_ptr<LCanvas> canvas = LCreateCanvas(device);
+                     canvas->setThreadPool(bandPool.get());
+                     frames.current.playback(canvas.get());
+                   }});
+  modes.push_back({"front-to-back/banded/4", 0, false, [bandPool](const Case &c, const Frames &frames, const GBitmap &device)
+                   {
+                     std::unique_ptr<LCanvas> canvas = LCreateCanvas(device);
+                     canvas->setThreadPool(bandPool.get());
+                     LCoverage coverage;
+                     LDrawFrontToBack(frames.current, canvas.get(), &coverage, c.height);
+                   }});
+
+  modes.push_back({"incremental", 0, true, [](const Case &, const Frames &frames, const GBitmap &device)
+                   {
+                     LIncrementalRenderer renderer(device);
+                     renderer.render(frames.previous);
+                     renderer.render(frames.current);
+                   }});
+
+  modes.push_back({"front-to-back", 0, false, [](const Case &c, const Frames &frames, const GBitmap &device)
+                   {
+                     LCoverage coverage;
+                     LDrawFrontToBack(frames.current, LCreateCanvas(device).get(), &coverage, c.height);
+                   }});
+
+  modes.push_back({"culled", 0, false, [](const Case &c, const Frames &frames, const GBitmap &device)
+                   {
+                     LPicture culled = frames.current;
+                     LCullOccluded(&culled, GIRect::MakeWH(c.width, c.height));
+                     culled.playback(LCreateCanvas(device).get());
+                   }});
+
+  // Streamed in strips an odd number of rows tall, so shapes, clips and shaders straddle them.
+  modes.push_back({"strips/37", 0, false, [](const Case &c, const Frames &frames, const GBitmap &device)
+                   {
+                     LStripRenderer renderer(c.width, c.height, 37);
+                     renderer.render(frames.current, [&](const GBitmap &rows, int top)
+                                     {
+                                       for (int y = 0; y < rows.height(); ++y)
+                                       {
+                                         memcpy(device.getAddr(0, top + y), rows.getAddr(0, y), c.width * sizeof(GPixel));
+                                       }
+                                     });
+                   }});
+
+  // On the async workers, flushed in three pieces that each draw over the last.
+  auto asyncRenderer = std::make_shared<LAsyncRenderer>(4);
+  modes.push_back({"async/4", 0, false, [asyncRenderer](const Case &, const Frames &frames, const GBitmap &device)
+                   {
+                     LAsyncCanvas canvas(asyncRenderer.get(), device);
+                     size_t count = frames.current.ops.size();
+                     for (size_t i = 0; i < count; ++i)
+                     {
+                       frames.current.ops[i].playback(&canvas);
+                       if (i == count / 3 || i == 2 * count / 3)
+                         canvas.flush();
+                     }
+                     canvas.flush().wait();
+                   }});
+
+  // A few frames through the double-buffered loop, so the one compared was drawn into a buffer
+  // that already held an earlier frame, on the loop's thread.
+  modes.push_back({"frame-loop", 0, false, [](const Case &c, const Frames &frames, const GBitmap &device)
+                   {
+                     LFrameLoop loop(c.width, c.height, [&frames](LCanvas *canvas, int)
+                                     {
+                                       canvas->clear({0, 0, 0, 0});
+                                       frames.current.playback(canvas);
+                                     });
+                     const GBitmap *frame = nullptr;
+                     for (int i = 0; i < 3; ++i)
+                     {
+                       frame = &loop.nextFrame();
+                       loop.startFrame();
+                     }
+                     for (int y = 0; y < c.height; ++y)
+                     {
+                       memcpy(device.getAddr(0, y), frame->getAddr(0, y), c.width * sizeof(GPixel));
+                     }
+                   }});
+
+  // Encoded into a command batch and decoded again, the path calls from JS take. A batch the
+  // runner stops short on draws only part of the case and fails the compare.
+  modes.push_back({"commands", 0, false, [](const Case &c, const Frames &, const GBitmap &device)
+                   {
+                     LCommandWriter writer;
+                     c.draw(&writer);
+                     LCommandRunner runner;
+                     runner.shaders = writer.shaders;
+                     runner.run(writer.words.data(), (int)writer.words.size(), LCreateCanvas(device).get());
+                   }});
+
+  return modes;
+}
+
+// ---------------------------------------------------------------------------------------------
+
+static void writePPM(const std::string &path, const GBitmap &bitmap)
+{
+  LWriteImage(path.c_str(), bitmap, LImageFormat::kPPM);
+}
+
+static int channelDiff(GPixel a, GPixel b)
+{
+  int d = std::abs(GPixel_GetA(a) - GPixel_GetA(b));
+  d = std::max(d, std::abs(GPixel_GetR(a) - GPixel_GetR(b)));
+  d = std::max(d, std::abs(GPixel_GetG(a) - GPixel_GetG(b)));
+  return std::max(d, std::abs(GPixel_GetB(a) - GPixel_GetB(b)));
+}
+
+// Compare actual to expected, writing the images and a diff (differing pixels in red over a
+// dimmed copy of expected) if any pixel is off by more than tolerance.
+static bool compare(const std::string &name, const GBitmap &expected, const GBitmap &actual, int tolerance)
+{
+  GBitmap diff;
+  diff.alloc(expected.width(), expected.height());
+  long long bad = 0;
+  int worst = 0;
+  for (int y = 0; y < expected.height(); ++y)
+  {
+    for (int x = 0; x < expected.width(); ++x)
+    {
+      GPixel e = *expected.getAddr(x, y);
+      int d = channelDiff(e, *actual.getAddr(x, y));
+      worst = std::max(worst, d);
+      bad += d > tolerance;
+      *diff.getAddr(x, y) = d > tolerance ? GPixel_PackARGB(255, 255, 0, 0)
+                                          : GPixel_PackARGB(255, GPixel_GetR(e) / 4, GPixel_GetG(e) / 4, GPixel_GetB(e) / 4);
+    }
+  }
+
+  bool ok = bad == 0;
+  if (ok)
+  {
+    printf("ok    %-36s max diff %d\n", name.c_str(), worst);
+  }
+  else
+  {
+    std::string base = std::string(kOutDir) + "/" + name;
+    std::replace(base.begin() + strlen(kOutDir) + 1, base.end(), '/', '-');
+    writePPM(base + "-expected.ppm", expected);
+    writePPM(base + "-actual.ppm", actual);
+    writePPM(base + "-diff.ppm", diff);
+    printf("FAIL  %-36s %lld pixels differ, max diff %d (tolerance %d), see %s-diff.ppm\n", name.c_str(), bad,
+           worst, tolerance, base.c_str());
+  }
+  free(diff.pixels());
+  return ok;
+}
+
+// The row painters (vector kernels where the build has them) against blending each pixel with
+// the scalar Painter. Rows are an odd length so the tail loops run too.
+static int checkRowPainters(const char *filter, int *runs)
+{
+  const int width = 255;
+  const int height = 256;
+  int failures = 0;
+  for (int mode = 0; mode < LStats::kBlendModeCount; ++mode)
+  {
+    std::string name = std::string("kernels/paintRow/") + LBlendModeName(mode);
+    if (filter && name.find(filter) == std::string::npos)
+      continue;
+    GBitmap expected;
+    GBitmap actual;
+    expected.alloc(width, height);
+    actual.alloc(width, height);
+    std::vector<GPixel> src(width);
+    Painter painter = modeToPainter((GBlendMode)mode);
+    RowPainter rowPainter = modeToRowPainter((GBlendMode)mode);
+    for (int y = 0; y < height; ++y)
+    {
+      for (int x = 0; x < width; ++x)
+      {
+        int sa = (x * 7 + y) & 0xFF;
+        int da = y;
+        src[x] = GPixel_PackARGB(sa, sa * x / 255, sa / 2, sa * (255 - x) / 255);
+        GPixel dst = GPixel_PackARGB(da, da * (x & 0xF) / 15, da / 3, da);
+        *expected.getAddr(x, y) = painter(src[x], dst);
+        *actual.getAddr(x, y) = dst;
+      }
+      rowPainter(src.data(), actual.getAddr(0, y), width);
+    }
+    failures += !compare(name, expected, actual, 0);
+    *runs += 1;
+    free(expected.pixels());
+    free(actual.pixels());
+  }
+  return failures;
+}
+
+// Malformed batches stop at the opcode of the bad command, after issuing what came before it.
+static int checkCommandErrors(const char *filter, int *runs)
+{
+  const uint32_t one = LFloatWord(1);
+  struct Batch
+  {
+    const char *name;
+    std::vector<uint32_t> words;
+    int expected;
+  };
+  const Batch batches[] = {
+      {"valid", {kCmdSave, kCmdDrawRect, one, one, one, one, kCmdRestore}, 7},
+      {"restore-first", {kCmdRestore, kCmdSave}, 0},
+      {"unmatched-restore", {kCmdSave, kCmdRestore, kCmdRestore}, 2},
+      {"unknown-opcode", {kCmdSave, kCmdCount}, 1},
+      {"truncated", {kCmdSave, kCmdDrawRect, one, one}, 1},
+      {"blend-mode", {kCmdSetBlendMode, 12}, 0},
+      {"shader", {kCmdSetShader, 0}, 0},
+      {"line-without-move", {kCmdPathReset, kCmdLineTo, one, one}, 1},
+      {"direction", {kCmdAddRect, one, one, one, one, 2}, 0},
+      {"polygon-count", {kCmdDrawConvexPolygon, 0x40000000, one, one}, 0},
+      {"mesh-index", {kCmdDrawMesh, 1, 3, 0, one, one, one, one, one, one, 0, 1, 3}, 0},
+      {"quad-level", {kCmdDrawQuad, 0xFFFFFFFF, 0, one, one, one, one, one, one, one, one}, 0},
+  };
+  int failures = 0;
+  for (const Batch &batch : batches)
+  {
+    std::string name = std::string("commands/errors/") + batch.name;
+    if (filter && name.find(filter) == std::string::npos)
+      continue;
+    GBitmap device;
+    device.alloc(4, 4);
+    LCommandRunner runner;
+    int stopped = runner.run(batch.words.data(), (int)batch.words.size(), LCreateCanvas(device).get());
+    if (stopped == batch.expected)
+    {
+      printf("ok    %-36s stopped at %d\n", name.c_str(), stopped);
+    }
+    else
+    {
+      printf("FAIL  %-36s stopped at %d, expected %d\n", name.c_str(), stopped, batch.expected);
+      failures += 1;
+    }
+    *runs += 1;
+    free(device.pixels());
+  }
+  return failures;
+}
+
+// A batch that leaves a save, concat and clip open, whether it ends or stops at a bad command,
+// must hand the canvas back unclipped.
+static int checkCommandUnwind(const char *filter, int *runs)
+{
+  const uint32_t zero = LFloatWord(0);
+  const uint32_t one = LFloatWord(1);
+  const uint32_t two = LFloatWord(2);
+  struct Batch
+  {
+    const char *name;
+    std::vector<uint32_t> words;
+  };
+  const Batch batches[] = {
+      {"open", {kCmdSave, kCmdConcat, two, zero, zero, zero, two, zero, kCmdSave, kCmdClipRect, zero, zero, one, one}},
+      {"malformed", {kCmdSave, kCmdClipRect, zero, zero, one, one, kCmdCount}},
+  };
+  int failures = 0;
+  for (const Batch &batch : batches)
+  {
+    std::string name = std::string("commands/unwind/") + batch.name;
+    if (filter && name.find(filter) == std::string::npos)
+      continue;
+    GBitmap expected;
+    expected.alloc(4, 4);
+    referenceCanvas(expected)->drawPaint(GPaint({1, 1, 0, 0}));
+    GBitmap actual;
+    actual.alloc(4, 4);
+    {
+      auto canvas = LCreateCanvas(actual);
+      LCommandRunner runner;
+      runner.run(batch.words.data(), (int)batch.words.size(), canvas.get());
+      canvas->drawPaint(GPaint({1, 1, 0, 0}));
+    }
+    failures += !compare(name, expected, actual, 0);
+    *runs += 1;
+    free(expected.pixels());
+    free(actual.pixels());
+  }
+  return failures;
+}
+
+// LUnpremulToRGBA against the division it replaces, for every alpha and every channel value a
+// premultiplied pixel of that alpha can have, through both the vector and the scalar loops.
+static int checkUnpremul(const char *filter, int *runs)
+{
+  const std::string name = "unpremul";
+  if (filter && name.find(filter) == std::string::npos)
+    return 0;
+  std::vector<GPixel> pixels;
+  std::vector<uint8_t> expected;
+  for (int a = 0; a < 256; ++a)
+  {
+    for (int c = 0; c <= a; ++c)
+    {
+      pixels.push_back(GPixel_PackARGB(a, c, a - c, c / 2));
+      for (int v : {c, a - c, c / 2})
+      {
+        expected.push_back(a == 0 ? 0 : (v * 255 + a / 2) / a);
+      }
+      expected.push_back(a);
+    }
+  }
+  std::vector<uint8_t> actual(expected.size());
+  // An odd count leaves the last pixels to the scalar loop.
+  LUnpremulToRGBA(pixels.data(), (int)pixels.size(), actual.data());
+  size_t bad = 0;
+  for (size_t i = 0; i < expected.size(); ++i)
+  {
+    bad += actual[i] != expected[i];
+  }
+  *runs += 1;
+  printf("%s  %-36s %zu of %zu channels differ\n", bad ? "FAIL" : "ok  ", name.c_str(), bad, expected.size());
+  return bad ? 1 : 0;
+}
+
+// A bitmap shader made while its bitmap happens to be opaque, drawn after the pixels change (a
+// render target reused as a texture), must blend the new pixels rather than copy them.
+static int checkShaderOpacity(const char *filter, int *runs)
+{
+  const std::string name = "shader/rewritten-pixels";
+  if (filter && name.find(filter) == std::string::npos)
+    return 0;
+  GBitmap source;
+  source.alloc(8, 8);
+  std::unique_ptr<GCanvas> target = GCreateCanvas(source);
+  target->clear({0, 0, 1, 1});
+  std::unique_ptr<GShader> shader = GCreateBitmapShader(source, GMatrix());
+  target->clear({1, 0, 0, 0.5f});
+
+  GBitmap expected;
+  GBitmap actual;
+  expected.alloc(8, 8);
+  actual.alloc(8, 8);
+  GCreateCanvas(expected)->clear({0, 1, 0, 1});
+  GCreateCanvas(expected)->fillRect(GRect::MakeWH(8, 8), {1, 0, 0, 0.5f});
+  std::unique_ptr<GCanvas> canvas = GCreateCanvas(actual);
+  canvas->clear({0, 1, 0, 1});
+  canvas->drawPaint(GPaint(shader.get()));
+  *runs += 1;
+  bool ok = compare(name, expected, actual, 0);
+  free(source.pixels());
+  free(expected.pixels());
+  free(actual.pixels());
+  return ok ? 0 : 1;
+}
+
+// Just enough of a decoder for what LImageEncoder writes, to check it round trips: QOI, and PNG
+// with stored or fixed-Huffman deflate blocks and the None and Sub filters.
+class Inflater
+{
+public:
+  Inflater(const std::vector<uint8_t> &in) : in(in) {}
+
+  bool run(std::vector<uint8_t> *out)
+  {
+    static const int kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const int kDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const int kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    pos = 2; // zlib header
+    for (bool final = false; !final;)
+    {
+      final = bits(1);
+      int type = bits(2);
+      if (type == 0)
+      {
+        if (bit)
+        {
+          bit = 0;
+          ++pos;
+        }
+        if (pos + 4 > in.size())
+          return false;
+        size_t len = in[pos] | in[pos + 1] << 8;
+        pos += 4;
+        if (pos + len > in.size())
+          return false;
+        out->insert(out->end(), in.begin() + pos, in.begin() + pos + len);
+        pos += len;
+        continue;
+      }
+      if (type != 1)
+        return false;
+      for (;;)
+      {
+        int symbol = literal();
+        if (symbol < 256)
+        {
+          out->push_back(symbol);
+          continue;
+        }
+        if (symbol == 256)
+          break;
+        if (symbol > 285 || pos >= in.size())
+          return false;
+        int len = kLengthBase[symbol - 257] + bits(kLengthExtra[symbol - 257]);
+        int code = reversed(5);
+        if (code > 29)
+          return false;
+        size_t dist = kDistBase[code] + bits(kDistExtra[code]);
+        if (dist > out->size())
+          return false;
+        for (int i = 0; i < len; ++i)
+        {
+          out->push_back((*out)[out->size() - dist]);
+        }
+      }
+    }
+    return true;
+  }
+
+private:
+  const std::vector<uint8_t> &in;
+  size_t pos = 0;
+  int bit = 0;
+
+  int bits(int count)
+  {
+    int value = 0;
+    for (int i = 0; i < count && pos < in.size(); ++i)
+    {
+      value |= (in[pos] >> bit & 1) << i;
+      if (++bit == 8)
+      {
+        bit = 0;
+        ++pos;
+      }
+    }
+    return value;
+  }
+
+  int reversed(int count)
+  {
+    int value = 0;
+    for (int i = 0; i < count; ++i)
+    {
+      value = value << 1 | bits(1);
+    }
+    return value;
+  }
+
+  int literal()
+  {
+    int code = reversed(7);
+    if (code < 0x18)
+      return 256 + code;
+    code = code << 1 | bits(1);
+    if (code < 0xC0)
+      return code - 0x30;
+    if (code < 0xC8)
+      return 280 + code - 0xC0;
+    return 144 + (code << 1 | bits(1)) - 0x190;
+  }
+};
+
+static uint32_t readBE32(const uint8_t *p)
+{
+  return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static bool decodePNG(const std::vector<uint8_t> &file, int width, int height, std::vector<uint8_t> *rgba)
+{
+  std::vector<uint8_t> zlib;
+  for (size_t i = 8; i + 12 <= file.size();)
+  {
+    uint32_t size = readBE32(&file[i]);
+    if (0 == memcmp(&file[i + 4], "IHDR", 4) && (readBE32(&file[i + 8]) != (uint32_t)width || readBE32(&file[i + 12]) != (uint32_t)height))
+      return false;
+    if (0 == memcmp(&file[i + 4], "IDAT", 4))
+      zlib.insert(zlib.end(), file.begin() + i + 8, file.begin() + i + 8 + size);
+    i += 12 + size;
+  }
+  std::vector<uint8_t> filtered;
+  const size_t stride = width * 4 + 1;
+  if (!Inflater(zlib).run(&filtered) || filtered.size() != stride * height)
+    return false;
+  for (int y = 0; y < height; ++y)
+  {
+    const uint8_t *row = &filtered[y * stride];
+    if (row[0] > 1)
+      return false;
+    for (int i = 0; i < width * 4; ++i)
+    {
+      rgba->push_back(row[1 + i] + (row[0] == 1 && i >= 4 ? (*rgba)[rgba->size() - 4] : 0));
+    }
+  }
+  return true;
+}
+
+static bool decodeQOI(const std::vector<uint8_t> &file, int width, int height, std::vector<uint8_t> *rgba)
+{
+  if (file.size() < 22 || 0 != memcmp(file.data(), "qoif", 4) || readBE32(&file[4]) != (uint32_t)width || readBE32(&file[8]) != (uint32_t)height)
+    return false;
+  uint8_t px[4] = {0, 0, 0, 255};
+  uint8_t index[64][4] = {};
+  size_t i = 14;
+  const size_t end = file.size() - 8;
+  while (rgba->size() < (size_t)width * height * 4 && i < end)
+  {
+    int op = file[i++];
+    int run = 1;
+    if (op == 0xFE || op == 0xFF)
+    {
+      memcpy(px, &file[i], op == 0xFE ? 3 : 4);
+      i += op == 0xFE ? 3 : 4;
+    }
+    else if (op >> 6 == 0)
+    {
+      memcpy(px, index[op], 4);
+    }
+    else if (op >> 6 == 1)
+    {
+      px[0] += (op >> 4 & 3) - 2;
+      px[1] += (op >> 2 & 3) - 2;
+      px[2] += (op & 3) - 2;
+    }
+    else if (op >> 6 == 2)
+    {
+      int dg = (op & 63) - 32;
+      px[0] += dg + (file[i] >> 4) - 8;
+      px[1] += dg;
+      px[2] += dg + (file[i] & 15) - 8;
+      ++i;
+    }
+    else
+    {
+      run = (op & 63) + 1;
+    }
+    memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+    for (int k = 0; k < run; ++k)
+    {
+      rgba->insert(rgba->end(), px, px + 4);
+    }
+  }
+  return i == end && 0 == memcmp(&file[end], "\0\0\0\0\0\0\0\1", 8);
+}
+
+// Encode expected in every format, streamed in strips, and check what decodes matches it.
+static int checkEncoders(const Case &c, const GBitmap &expected, const char *filter, int *runs)
+{
+  struct Format
+  {
+    const char *name;
+    LImageFormat format;
+  };
+  const Format formats[] = {{"ppm", LImageFormat::kPPM}, {"pam", LImageFormat::kPAM}, {"qoi", LImageFormat::kQOI}, {"png-store", LImageFormat::kPNGStore}, {"png-fast", LImageFormat::kPNGFast}};
+  std::vector<uint8_t> rgba(c.width * c.height * 4);
+  std::vector<uint8_t> rgb;
+  for (int y = 0; y < c.height; ++y)
+  {
+    LUnpremulToRGBA(expected.getAddr(0, y), c.width, &rgba[y * c.width * 4]);
+    for (int x = 0; x < c.width; ++x)
+    {
+      GPixel p = *expected.getAddr(x, y);
+      rgb.insert(rgb.end(), {(uint8_t)GPixel_GetR(p), (uint8_t)GPixel_GetG(p), (uint8_t)GPixel_GetB(p)});
+    }
+  }
+  int failures = 0;
+  for (const Format &format : formats)
+  {
+    std::string name = c.name + "/encode/" + format.name;
+    if (filter && name.find(filter) == std::string::npos)
+      continue;
+    std::vector<uint8_t> file;
+    std::unique_ptr<LImageEncoder> encoder = LCreateImageEncoder(format.format, c.width, c.height, [&file](const uint8_t *bytes, size_t size)
+                                                                 { file.insert(file.end(), bytes, bytes + size); });
+    for (int top = 0; top < c.height; top += 37)
+    {
+      encoder->writeRows(GBitmap(c.width, std::min(37, c.height - top), expected.rowBytes(), expected.getAddr(0, top), false));
+    }
+    bool ok = encoder->finish();
+    std::vector<uint8_t> decoded;
+    std::string header;
+    switch (format.format)
+    {
+    case LImageFormat::kPPM:
+      header = "P6\n" + std::to_string(c.width) + " " + std::to_string(c.height) + "\n255\n";
+      ok = ok && file.size() == header.size() + rgb.size() && 0 == memcmp(file.data(), header.data(), header.size()) &&
+           0 == memcmp(&file[header.size()], rgb.data(), rgb.size());
+      break;
+    case LImageFormat::kPAM:
+      header = "P7\nWIDTH " + std::to_string(c.width) + "\nHEIGHT " + std::to_string(c.height) + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+      ok = ok && file.size() == header.size() + rgba.size() && 0 == memcmp(file.data(), header.data(), header.size()) &&
+           0 == memcmp(&file[header.size()], rgba.data(), rgba.size());
+      break;
+    case LImageFormat::kQOI:
+      ok = ok && decodeQOI(file, c.width, c.height, &decoded) && decoded == rgba;
+      break;
+    default:
+      ok = ok && decodePNG(file, c.width, c.height, &decoded) && decoded == rgba;
+      break;
+    }
+    printf("%s  %-36s %zu bytes\n", ok ? "ok  " : "FAIL", name.c_str(), file.size());
+    failures += !ok;
+    *runs += 1;
+  }
+  return failures;
+}
+
+// Textures written to the container and mapped back must draw exactly as the bitmaps they
+// came from, opacity flag included; damaged files must be refused.
+static int checkTextures(const char *filter, int *runs)
+{
+  int failures = 0;
+  for (bool opaque : {true, false})
+  {
+    std::string name = std::string("texture/") + (opaque ? "opaque" : "translucent");
+    if (filter && name.find(filter) == std::string::npos)
+      continue;
+    GBitmap source;
+    source.alloc(37, 21);
+    for (int y = 0; y < source.height(); ++y)
+    {
+      for (int x = 0; x < source.width(); ++x)
+      {
+        int a = opaque || y < 20 ? 255 : 128;
+        *source.getAddr(x, y) = GPixel_PackARGB(a, x * 6 * a / 255, y * 12 * a / 255, (x ^ y) * 7 % 256 * a / 255);
+      }
+    }
+    const std::string path = std::string(kOutDir) + "/" + (opaque ? "opaque" : "translucent") + ".ltex";
+    std::unique_ptr<LMappedTexture> texture = LWriteTexture(path.c_str(), source) ? LMapTexture(path.c_str()) : nullptr;
+    bool ok = texture && texture->bitmap().isOpaque() == opaque;
+
+    GBitmap expected;
+    GBitmap actual;
+    expected.alloc(96, 80);
+    actual.alloc(96, 80);
+    GMatrix local = GMatrix::Translate(48, 40) * GMatrix::Rotate(0.6f) * GMatrix::Scale(1.5f, 1.5f);
+    std::unique_ptr<GShader> reference = GCreateBitmapShader(source, local, GShader::kRepeat);
+    GPaint paint;
+    paint.setShader(reference.get());
+    GCreateCanvas(expected)->drawPaint(paint);
+    if (ok)
+    {
+      std::unique_ptr<GShader> shader = GCreateBitmapShader(texture->bitmap(), local, GShader::kRepeat);
+      paint.setShader(shader.get());
+      GCreateCanvas(actual)->drawPaint(paint);
+      ok = compare(name, expected, actual, 0);
+    }
+    else
+    {
+      printf("FAIL  %-36s did not map back\n", name.c_str());
+    }
+    failures += !ok;
+    *runs += 1;
+    free(source.pixels());
+    free(expected.pixels());
+    free(actual.pixels());
+  }
+
+  struct Damage
+  {
+    const char *name;
+    size_t offset; // where to overwrite or, with truncate, the new size
+    bool truncate;
+  };
+  const Damage damages[] = {{"missing", 0, false}, {"magic", 0, false}, {"version", 4, false}, {"row-bytes", 16, false}, {"truncated", 64 + 3 * 64, true}};
+  for (const Damage &damage : damages)
+  {
+    std::string name = std::string("texture/reject/") + damage.name;
+    if (filter && name.find(filter) == std::string::npos)
+      continue;
+    GBitmap source;
+    source.alloc(5, 5);
+    const std::string path = std::string(kOutDir) + "/damaged.ltex";
+    LWriteTexture(path.c_str(), source);
+    if (0 == strcmp(damage.name, "missing"))
+    {
+      remove(path.c_str());
+    }
+    else if (damage.truncate)
+    {
+      truncate(path.c_str(), damage.offset);
+    }
+    else
+    {
+      FILE *f = fopen(path.c_str(), "r+b");
+      fseek(f, damage.offset, SEEK_SET);
+      fputc(0x7F, f);
+      fclose(f);
+    }
+    bool rejected = LMapTexture(path.c_str()) == nullptr;
+    printf("%s  %-36s %s\n", rejected ? "ok  " : "FAIL", name.c_str(), rejected ? "refused" : "mapped anyway");
+    failures += !rejected;
+    *runs += 1;
+    free(source.pixels());
+  }
+  return failures;
+}
+
+// Every texture layout must shade exactly like the row-major bitmap, for odd and power-of-two
+// sizes, each tile mode, and rotations that walk the texture every way.
+static int checkTextureLayouts(const char *filter, int *runs)
+{
+  struct Layout
+  {
+    const char *name;
+    LTextureLayout layout;
+  };
+  const Layout layouts[] = {{"blocked4x4", LTextureLayout::kBlocked4x4}, {"blocked8x8", LTextureLayout::kBlocked8x8}, {"morton", LTextureLayout::kMorton}};
+  struct Size
+  {
+    int width;
+    int height;
+  };
+  const Size sizes[] = {{37, 21}, {64, 16}, {5, 70}};
+  int failures = 0;
+  for (const Layout &layout : layouts)
+  {
+    for (Size size : sizes)
+    {
+      std::string name = std::string("texture/layout/") + layout.name + "/" + std::to_string(size.width) + "x" + std::to_string(size.height);
+      if (filter && name.find(filter) == std::string::npos)
+        continue;
+      GBitmap texture;
+      texture.alloc(size.width, size.height);
+      for (int y = 0; y < size.height; ++y)
+      {
+        for (int x = 0; x < size.width; ++x)
+        {
+          int a = (x + y) % 3 ? 255 : 96;
+          *texture.getAddr(x, y) = GPixel_PackARGB(a, x * 7 % 256 * a / 255, y * 11 % 256 * a / 255, (x * y) % 256 * a / 255);
+        }
+      }
+      GBitmap expected;
+      GBitmap actual;
+      expected.alloc(64, 48);
+      actual.alloc(64, 48);
+      int worst = 0;
+      for (GShader::TileMode mode : {GShader::kClamp, GShader::kRepeat, GShader::kMirror})
+      {
+        for (float angle : {0.0f, 0.785398f, 1.570796f, 2.5f})
+        {
+          GMatrix local = GMatrix::Translate(32, 24) * GMatrix::Rotate(angle) * GMatrix::Scale(0.7f, 1.3f);
+          std::unique_ptr<GShader> rowMajor = LCreateBitmapShader(texture, local, mode, LTextureLayout::kRowMajor);
+          std::unique_ptr<GShader> reordered = LCreateBitmapShader(texture, local, mode, layout.layout);
+          GPaint paint;
+          paint.setShader(rowMajor.get());
+          GCreateCanvas(expected)->drawPaint(paint);
+          paint.setShader(reordered.get());
+          GCreateCanvas(actual)->drawPaint(paint);
+          for (int y = 0; y < expected.height(); ++y)
+          {
+            for (int x = 0; x < expected.width(); ++x)
+            {
+              worst = std::max(worst, channelDiff(*expected.getAddr(x, y), *actual.getAddr(x, y)));
+            }
+          }
+        }
+      }
+      printf("%s  %-36s max diff %d\n", worst ? "FAIL" : "ok  ", name.c_str(), worst);
+      failures += worst != 0;
+      *runs += 1;
+      free(texture.pixels());
+      free(expected.pixels());
+      free(actual.pixels());
+    }
+  }
+  return failures;
+}
+
+// drawPathInstances against the plain save/concat/drawPath loop GCanvas defines it as. Edges
+// are placed from their slope and intercept, which shifting can round differently, so the
+// paths are straight lines whose every edge spans a power of two (or nothing) in x and y under
+// every matrix: then all of it is exact in float, and stamping shifted coverage must agree
+// with transforming the path itself to the bit.
+static int checkPathInstances(const char *filter, int *runs)
+{
+  std::string name = "path-instances/vs-drawPath";
+  if (filter && name.find(filter) == std::string::npos)
+    return 0;
+  GPath crown;
+  crown.moveTo(-8, -8).lineTo(-4, 0).lineTo(0, -8).lineTo(4, 0).lineTo(8, -8).lineTo(8, 8).lineTo(-8, 8);
+  crown.moveTo(0, 0).lineTo(16, 8).lineTo(0, 8);
+  std::vector<GMatrix> matrices;
+  std::vector<GColor> colors;
+  for (int i = 0; i < 400; ++i)
+  {
+    float tx = (i * 29) % 260 - 10 + (i % 3) * 0.25f;
+    float ty = (i * 41) % 200 - 10 + (i % 5) * 0.125f;
+    switch (i % 4)
+    {
+    case 0:
+      matrices.push_back(GMatrix::Translate(tx, ty));
+      break;
+    case 1:
+      matrices.push_back(GMatrix(1.5f, 0, tx, 0, 1.5f, ty));
+      break;
+    case 2:
+      matrices.push_back(GMatrix(0, -1, tx, 1, 0, ty));
+      break;
+    default:
+      matrices.push_back(GMatrix(1, 0.25f, tx, 0, 2, ty));
+      break;
+    }
+    colors.push_back({(i % 4) / 3.0f, (i % 9) / 8.0f, 0.5f, 0.3f + (i % 3) * 0.35f});
+  }
+  matrices.push_back(GMatrix(128, 0, 120, 0, 64, 90));
+  colors.push_back({0, 0, 1, 0.2f});
+
+  GBitmap expected;
+  GBitmap actual;
+  expected.alloc(240, 180);
+  actual.alloc(240, 180);
+  auto draw = [&](GCanvas *c, bool instanced)
+  {
+    c->clear({1, 1, 1, 1});
+    c->clipRect(GRect::MakeLTRB(4, 6, 236, 170));
+    c->translate(3, 2);
+    if (instanced)
+      c->drawPathInstances(crown, matrices.data(), colors.data(), matrices.size(), GPaint());
+    else
+      c->GCanvas::drawPathInstances(crown, matrices.data(), colors.data(), matrices.size(), GPaint());
+  };
+  draw(referenceCanvas(expected).get(), false);
+  draw(referenceCanvas(actual).get(), true);
+  bool ok = compare(name, expected, actual, 0);
+  *runs += 1;
+  free(expected.pixels());
+  free(actual.pixels());
+  return !ok;
+}
+
+// Hairlines touch exactly the pixels their definition in GCanvas names.
+static int checkHairlines(const char *filter, int *runs)
+{
+  struct Line
+  {
+    const char *name;
+    GPoint a;
+    GPoint b;
+    // The pixels expected, as (x, y) pairs.
+    std::vector<int> pixels;
+  };
+  const Line lines[] = {
+      {"horizontal", {2.3f, 3.9f}, {6.7f, 3.9f}, {2, 3, 3, 3, 4, 3, 5, 3, 6, 3}},
+      {"vertical", {1.5f, 6.5f}, {1.5f, 2.5f}, {1, 3, 1, 4, 1, 5, 1, 6}},
+      {"diagonal", {1, 1}, {5, 5}, {1, 1, 2, 2, 3, 3, 4, 4}},
+      {"shallow", {0, 0}, {8, 2}, {0, 0, 1, 0, 2, 0, 3, 0, 4, 1, 5, 1, 6, 1, 7, 1}},
+      {"steep", {6, 0}, {4, 8}, {5, 0, 5, 1, 5, 2, 5, 3, 4, 4, 4, 5, 4, 6, 4, 7}},
+      {"point", {3, 3}, {3, 3}, {}},
+  };
+  int failures = 0;
+  for (const Line &line : lines)
+  {
+    std::string name = std::string("hairlines/pixels/") + line.name;
+    if (filter && name.find(filter) == std::string::npos)
+      continue;
+    GBitmap device;
+    device.alloc(10, 10);
+    const GPoint points[] = {line.a, line.b};
+    GCreateCanvas(device)->drawLines(points, 2, GPaint({1, 1, 1, 1}));
+    std::vector<int> touched;
+    for (int y = 0; y < 10; ++y)
+    {
+      for (int x = 0; x < 10; ++x)
+      {
+        if (*device.getAddr(x, y))
+          touched.insert(touched.end(), {x, y});
+      }
+    }
+    std::vector<int> expected = line.pixels;
+    auto byRow = [](std::vector<int> &pairs)
+    {
+      std::vector<std::pair<int, int>> sorted;
+      for (size_t i = 0; i < pairs.size(); i += 2)
+        sorted.push_back({pairs[i + 1], pairs[i]});
+      std::sort(sorted.begin(), sorted.end());
+      return sorted;
+    };
+    bool ok = byRow(touched) == byRow(expected);
+    printf("%s  %-36s %d pixels\n", ok ? "ok  " : "FAIL", name.c_str(), (int)touched.size() / 2);
+    failures += !ok;
+    *runs += 1;
+    free(device.pixels());
+  }
+  return failures;
+}
+
+int main(int argc, char **argv)
+{
+  const char *filter = argc > 1 ? argv[1] : nullptr;
+  mkdir("build", 0755);
+  mkdir(kOutDir, 0755);
+
+  std::vector<Case> cases = makeCases();
+  std::vector<Mode> modes = makeModes();
+  int runs = 0;
+  int failures = checkRowPainters(filter, &runs);
+  failures += checkCommandErrors(filter, &runs);
+  failures += checkCommandUnwind(filter, &runs);
+  failures += checkUnpremul(filter, &runs);
+  failures += checkShaderOpacity(filter, &runs);
+  failures += checkTextures(filter, &runs);
+  failures += checkTextureLayouts(filter, &runs);
+  failures += checkPathInstances(filter, &runs);
+  failures += checkHairlines(filter, &runs);
+  for (const Case &c : cases)
+  {
+    Frames frames;
+    LRecorder recorder(&frames.current);
+    c.draw(&recorder);
+    frames.previous = frames.current;
+    for (size_t i = frames.previous.ops.size(); i-- > 1;)
+    {
+      if (i % 3 == 0)
+        frames.previous.ops.erase(frames.previous.ops.begin() + i);
+    }
+
+    GBitmap expected;
+    expected.alloc(c.width, c.height);
+    c.draw(referenceCanvas(expected).get());
+    GBitmap expectedAfterPrevious;
+    expectedAfterPrevious.alloc(c.width, c.height);
+    {
+      auto canvas = referenceCanvas(expectedAfterPrevious);
+      frames.previous.playback(canvas.get());
+      c.draw(canvas.get());
+    }
+
+    for (const Mode &mode : modes)
+    {
+      std::string name = c.name + "/" + mode.name;
+      if (filter && name.find(filter) == std::string::npos)
+        continue;
+      // Pooled bitmaps have padded rows, so every mode is also checked against a rowBytes
+      // wider than the image.
+      LPooledBitmap actual = LDefaultBitmapPool().acquire(c.width, c.height);
+      mode.render(c, frames, actual.bitmap());
+      failures += !compare(name, mode.afterPrevious ? expectedAfterPrevious : expected, actual.bitmap(), mode.tolerance);
+      runs += 1;
+    }
+    failures += checkEncoders(c, expected, filter, &runs);
+    free(expected.pixels());
+    free(expectedAfterPrevious.pixels());
+  }
+
+  printf("%d of %d passed\n", runs - failures, runs);
+  return failures == 0 ? 0 : 1;
+}
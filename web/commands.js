@@ -0,0 +1,247 @@
+// Encodes canvas calls into the command format of src/include/LCommands.h, straight into wasm
+// memory, and hands a frame of them over with one runCommands call. The page draws the batch in
+// every frame from the next one on, until it is given another:
+//
+//   const commands = new CommandBuffer(Module);
+//   commands.setColor(1, 0, 0, 1).drawRect(0, 0, 64, 64);
+//   commands.flush();
+
+// Opcodes, in the order of LCommand.
+const Cmd = {
+  save: 0,
+  restore: 1,
+  concat: 2,
+  clipRect: 3,
+  clipPath: 4,
+  setColor: 5,
+  setBlendMode: 6,
+  setShader: 7,
+  pathReset: 8,
+  moveTo: 9,
+  lineTo: 10,
+  quadTo: 11,
+  cubicTo: 12,
+  addRect: 13,
+  addCircle: 14,
+  drawPaint: 15,
+  drawRect: 16,
+  drawPath: 17,
+  drawConvexPolygon: 18,
+  drawMesh: 19,
+  drawQuad: 20,
+  drawPathInstances: 21,
+  drawLines: 22,
+  drawPolyline: 23,
+};
+
+const kNoShader = 0xffffffff;
+const kHasColors = 1;
+const kHasTexs = 2;
+
+class CommandBuffer {
+  constructor(module, initialWords = 4096) {
+    this.module = module;
+    this.count = 0;
+    this.reserve(initialWords);
+  }
+
+  // Makes room for words more words, taking fresh views whenever the buffer moves or wasm
+  // memory grows under the old ones.
+  reserve(words) {
+    const needed = this.count + words;
+    if (!this.u32 || needed > this.capacity || this.u32.buffer !== this.module.HEAPU32.buffer) {
+      const capacity = Math.max(needed, 2 * (this.capacity || 0));
+      const address = this.module.commandBuffer(capacity);
+      const buffer = this.module.HEAPU32.buffer;
+      this.capacity = capacity;
+      this.u32 = new Uint32Array(buffer, address, capacity);
+      this.f32 = new Float32Array(buffer, address, capacity);
+    }
+  }
+
+  op(code, words) {
+    this.reserve(1 + words);
+    this.u32[this.count++] = code;
+    return this;
+  }
+
+  u(value) {
+    this.u32[this.count++] = value;
+  }
+
+  f(value) {
+    this.f32[this.count++] = value;
+  }
+
+  floats(values) {
+    this.f32.set(values, this.count);
+    this.count += values.length;
+  }
+
+  // Hands over everything written since the last flush, replacing the previous batch.
+  flush() {
+    this.module.runCommands(this.count);
+    this.lastCount = this.count;
+    this.count = 0;
+  }
+
+  // False if the last frame drawn stopped short of the end of its batch on a malformed command.
+  // A flushed batch is first drawn in the frame after next.
+  complete() {
+    return this.module.commandsIssued() === this.lastCount;
+  }
+
+  save() {
+    return this.op(Cmd.save, 0);
+  }
+
+  restore() {
+    return this.op(Cmd.restore, 0);
+  }
+
+  // The matrix [sx kx tx; ky sy ty].
+  concat(sx, kx, tx, ky, sy, ty) {
+    this.op(Cmd.concat, 6).floats([sx, kx, tx, ky, sy, ty]);
+    return this;
+  }
+
+  clipRect(left, top, right, bottom) {
+    this.op(Cmd.clipRect, 4).floats([left, top, right, bottom]);
+    return this;
+  }
+
+  clipPath() {
+    return this.op(Cmd.clipPath, 0);
+  }
+
+  setColor(r, g, b, a) {
+    this.op(Cmd.setColor, 4).floats([r, g, b, a]);
+    return this;
+  }
+
+  setBlendMode(mode) {
+    this.op(Cmd.setBlendMode, 1).u(mode);
+    return this;
+  }
+
+  // An index returned by Module.addLinearGradient, or null for none.
+  setShader(index) {
+    this.op(Cmd.setShader, 1).u(index === null ? kNoShader : index);
+    return this;
+  }
+
+  pathReset() {
+    return this.op(Cmd.pathReset, 0);
+  }
+
+  moveTo(x, y) {
+    this.op(Cmd.moveTo, 2).floats([x, y]);
+    return this;
+  }
+
+  lineTo(x, y) {
+    this.op(Cmd.lineTo, 2).floats([x, y]);
+    return this;
+  }
+
+  quadTo(x1, y1, x2, y2) {
+    this.op(Cmd.quadTo, 4).floats([x1, y1, x2, y2]);
+    return this;
+  }
+
+  cubicTo(x1, y1, x2, y2, x3, y3) {
+    this.op(Cmd.cubicTo, 6).floats([x1, y1, x2, y2, x3, y3]);
+    return this;
+  }
+
+  // counterClockwise selects GPath::kCCW_Direction.
+  addRect(left, top, right, bottom, counterClockwise = false) {
+    this.op(Cmd.addRect, 5).floats([left, top, right, bottom]);
+    this.u(counterClockwise ? 1 : 0);
+    return this;
+  }
+
+  addCircle(cx, cy, radius, counterClockwise = false) {
+    this.op(Cmd.addCircle, 4).floats([cx, cy, radius]);
+    this.u(counterClockwise ? 1 : 0);
+    return this;
+  }
+
+  drawPaint() {
+    return this.op(Cmd.drawPaint, 0);
+  }
+
+  drawRect(left, top, right, bottom) {
+    this.op(Cmd.drawRect, 4).floats([left, top, right, bottom]);
+    return this;
+  }
+
+  drawPath() {
+    return this.op(Cmd.drawPath, 0);
+  }
+
+  // points is [x0, y0, x1, y1, ...].
+  drawConvexPolygon(points) {
+    this.op(Cmd.drawConvexPolygon, 1 + points.length).u(points.length / 2);
+    this.floats(points);
+    return this;
+  }
+
+  // verts and texs hold two floats per vertex, colors four, indices three per triangle; colors
+  // and texs may be null.
+  drawMesh(verts, colors, texs, indices) {
+    const words = 3 + verts.length + (colors ? colors.length : 0) + (texs ? texs.length : 0) + indices.length;
+    this.op(Cmd.drawMesh, words);
+    this.u(indices.length / 3);
+    this.u(verts.length / 2);
+    this.u((colors ? kHasColors : 0) | (texs ? kHasTexs : 0));
+    this.floats(verts);
+    if (colors) this.floats(colors);
+    if (texs) this.floats(texs);
+    this.u32.set(indices, this.count);
+    this.count += indices.length;
+    return this;
+  }
+
+  // verts holds the four corners as eight floats, colors sixteen and texs eight; either may be
+  // null.
+  drawQuad(verts, colors, texs, level) {
+    this.op(Cmd.drawQuad, 2 + 8 + (colors ? 16 : 0) + (texs ? 8 : 0));
+    this.u(level);
+    this.u((colors ? kHasColors : 0) | (texs ? kHasTexs : 0));
+    this.floats(verts);
+    if (colors) this.floats(colors);
+    if (texs) this.floats(texs);
+    return this;
+  }
+
+  // Hairlines between each pair of points; points is [x0, y0, x1, y1, ...].
+  drawLines(points) {
+    this.op(Cmd.drawLines, 1 + points.length).u(points.length / 2);
+    this.floats(points);
+    return this;
+  }
+
+  // Hairlines joining the points in order.
+  drawPolyline(points) {
+    this.op(Cmd.drawPolyline, 1 + points.length).u(points.length / 2);
+    this.floats(points);
+    return this;
+  }
+
+  // Fills the current path once per instance. matrices holds six floats per instance, in
+  // concat's order, and colors four per instance or is null for the paint's color.
+  drawPathInstances(matrices, colors) {
+    const count = matrices.length / 6;
+    this.op(Cmd.drawPathInstances, 2 + matrices.length + (colors ? colors.length : 0));
+    this.u(count);
+    this.u(colors ? kHasColors : 0);
+    this.floats(matrices);
+    if (colors) this.floats(colors);
+    return this;
+  }
+}
+
+if (typeof module === 'object' && module.exports) {
+  module.exports = { Cmd, CommandBuffer };
+}
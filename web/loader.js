@@ -0,0 +1,28 @@
+// Loads the SIMD128 build of the canvas where the engine supports it and the scalar build
+// otherwise. Both builds define the same Module; the page only needs <canvas id="canvas">.
+//
+//   <script src="loader.js"></script>              from the build directory (make wasm-variants)
+
+// The smallest module using a SIMD128 instruction: one function returning
+// i8x16.popcnt(i8x16.splat(0)). Engines without SIMD reject it.
+const kSimdProbe = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+]);
+
+function simdSupported() {
+  return typeof WebAssembly === 'object' && WebAssembly.validate(kSimdProbe);
+}
+
+// The script for this engine, relative to the build directory.
+function canvasScript() {
+  return simdSupported() ? 'simd/index.js' : 'index.js';
+}
+
+if (typeof module === 'object' && module.exports) {
+  module.exports = { simdSupported, canvasScript };
+} else {
+  const script = document.createElement('script');
+  script.src = canvasScript();
+  script.async = true;
+  document.body.appendChild(script);
+}